@@ -0,0 +1,51 @@
+/*!\file bakeheight.c
+ *
+ * \brief précalcul d'un monde : génération d'une heightMap par
+ * heightGen et écriture au format de tuiles de tilefile.h, que
+ * l'application projette ensuite en mémoire au démarrage.
+ *
+ * Usage : bakeheight fichier [côté [tuile [graine [brut]]]], par défaut
+ * 4097 échantillons, tuiles de 256, graine 2017 et tuiles compressées
+ * (brut non nul pour s'en passer).
+ *
+ * \author Farès BELHADJ, amsi@ai.univ-paris8.fr
+ * \date October 14 2026
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <SDL.h>
+#include "heightgen.h"
+#include "tilefile.h"
+
+int main(int argc, char ** argv) {
+  int n = argc > 2 ? atoi(argv[2]) : 4097, tile = argc > 3 ? atoi(argv[3]) : 256, tx, tz;
+  unsigned int seed = argc > 4 ? (unsigned int)atoi(argv[4]) : 2017;
+  int flags = argc > 5 && atoi(argv[5]) ? 0 : TILEFILE_COMPRESSED;
+  double f = 1000.0 / SDL_GetPerformanceFrequency();
+  Uint64 t0, t1, t2;
+  size_t bytes = 0;
+  GLfloat * data;
+  tilefile_t * tf;
+  if(argc < 2 || n < 2 || tile < 1) {
+    fprintf(stderr, "usage : %s fichier [côté [tuile [graine [brut]]]]\n", argv[0]);
+    return 1;
+  }
+  t0 = SDL_GetPerformanceCounter();
+  data = heightGen(n, n, 0.5f, seed, 0);
+  t1 = SDL_GetPerformanceCounter();
+  if(!tilefileBake(argv[1], data, n, n, tile, flags))
+    return 1;
+  t2 = SDL_GetPerformanceCounter();
+  free(data);
+  if(!(tf = tilefileOpen(argv[1])))
+    return 1;
+  for(tz = 0; tz < tf->ntz; tz++)
+    for(tx = 0; tx < tf->ntx; tx++)
+      bytes += tilefileTileSize(tf, tz, tx);
+  printf("%s : %d x %d échantillons (graine %u), %d x %d tuiles de %d, génération %.1f ms, écriture %.1f ms\n",
+         argv[1], n, n, seed, tf->ntx, tf->ntz, tile, (t1 - t0) * f, (t2 - t1) * f);
+  printf("altitudes : %.2f Mo, soit %.2f octets par échantillon (%.2f en flottants)\n",
+         bytes / (1024.0 * 1024.0), bytes / ((double)n * n), (double)sizeof *data);
+  tilefileClose(tf);
+  return 0;
+}
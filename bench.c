@@ -0,0 +1,128 @@
+/*!\file bench.c
+ *
+ * \brief chemins de caméra et statistiques du banc d'essai du rendu,
+ * cf. bench.h.
+ *
+ * \author Farès BELHADJ, amsi@ai.univ-paris8.fr
+ * \date October 14 2026
+ */
+#include "bench.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <assert.h>
+
+/*!\brief lecture du chemin du fichier path ; NULL s'il est illisible
+ * ou compte moins de deux images clés */
+extern campath_t * campathLoad(const char * path) {
+  FILE * f = fopen(path, "r");
+  char line[256];
+  int size = 16;
+  campath_t * c;
+  GLfloat * k;
+  if(!f)
+    return NULL;
+  c = malloc(sizeof *c);
+  assert(c);
+  c->nkeys = 0;
+  c->keys = malloc(size * CAMPATH_KEY * sizeof *c->keys);
+  assert(c->keys);
+  while(fgets(line, sizeof line, f)) {
+    if(c->nkeys == size) {
+      c->keys = realloc(c->keys, (size *= 2) * CAMPATH_KEY * sizeof *c->keys);
+      assert(c->keys);
+    }
+    k = &c->keys[c->nkeys * CAMPATH_KEY];
+    if(line[0] != '#' && sscanf(line, "%f %f %f %f", &k[0], &k[1], &k[2], &k[3]) == CAMPATH_KEY)
+      c->nkeys++;
+  }
+  fclose(f);
+  if(c->nkeys < 2) {
+    campathFree(c);
+    return NULL;
+  }
+  return c;
+}
+
+/*!\brief tour complet, de nkeys images clés, d'un cercle de rayon
+ * radius centré sur l'origine, la caméra regardant devant elle avec le
+ * tangage pitch */
+extern campath_t * campathCircle(GLfloat radius, GLfloat pitch, int nkeys) {
+  int i;
+  GLfloat a, * k;
+  campath_t * c = malloc(sizeof *c);
+  assert(c && nkeys >= 2);
+  c->nkeys = nkeys;
+  c->keys = malloc(nkeys * CAMPATH_KEY * sizeof *c->keys);
+  assert(c->keys);
+  for(i = 0; i < nkeys; i++) {
+    a = 2.0f * M_PI * i / (nkeys - 1);
+    k = &c->keys[i * CAMPATH_KEY];
+    k[0] = radius * sinf(a);
+    k[1] = radius * cosf(a);
+    /* direction de visée (-sin theta, -cos theta) tangente au cercle */
+    k[2] = a - 0.5f * M_PI;
+    k[3] = pitch;
+  }
+  return c;
+}
+
+/*!\brief image clé au paramètre u de [0, 1] (0 : première, 1 :
+ * dernière), chaque segment couvrant 1 / (nkeys - 1) de u quelle que
+ * soit sa longueur ; extrémités prolongées par symétrie */
+extern void campathEval(const campath_t * c, GLfloat u, GLfloat key[CAMPATH_KEY]) {
+  int i, j, n = c->nkeys - 1;
+  GLfloat t, t2, t3, p[4];
+  u = u < 0.0f ? 0.0f : (u > 1.0f ? 1.0f : u);
+  i = (int)(u * n);
+  i = i < n ? i : n - 1;
+  t = u * n - i;
+  t2 = t * t;
+  t3 = t2 * t;
+  for(j = 0; j < CAMPATH_KEY; j++) {
+    p[1] = c->keys[i * CAMPATH_KEY + j];
+    p[2] = c->keys[(i + 1) * CAMPATH_KEY + j];
+    p[0] = i > 0 ? c->keys[(i - 1) * CAMPATH_KEY + j] : 2.0f * p[1] - p[2];
+    p[3] = i + 2 <= n ? c->keys[(i + 2) * CAMPATH_KEY + j] : 2.0f * p[2] - p[1];
+    key[j] = 0.5f * (2.0f * p[1] + (p[2] - p[0]) * t + (2.0f * p[0] - 5.0f * p[1] + 4.0f * p[2] - p[3]) * t2 +
+                     (3.0f * p[1] - p[0] - 3.0f * p[2] + p[3]) * t3);
+  }
+}
+
+/*!\brief ajoute l'image clé à la fin du fichier path ; retourne 0 en
+ * cas d'échec */
+extern int campathAppend(const char * path, const GLfloat key[CAMPATH_KEY]) {
+  FILE * f = fopen(path, "a");
+  if(!f)
+    return 0;
+  fprintf(f, "%.4f %.4f %.4f %.4f\n", key[0], key[1], key[2], key[3]);
+  return fclose(f) == 0;
+}
+
+extern void campathFree(campath_t * c) {
+  free(c->keys);
+  free(c);
+}
+
+static int compare(const void * a, const void * b) {
+  GLdouble x = *(const GLdouble *)a, y = *(const GLdouble *)b;
+  return x < y ? -1 : (x > y);
+}
+
+/*!\brief moyenne, extrêmes et percentiles (rang le plus proche) des n
+ * durées de times, trié au passage */
+extern void benchStats(GLdouble * times, int n, bstats_t * s) {
+  int i;
+  s->n = n;
+  s->avg = s->min = s->p50 = s->p99 = s->max = 0.0;
+  if(n <= 0)
+    return;
+  qsort(times, n, sizeof *times, compare);
+  for(i = 0; i < n; i++)
+    s->avg += times[i];
+  s->avg /= n;
+  s->min = times[0];
+  s->max = times[n - 1];
+  s->p50 = times[(int)ceil(0.50 * n) - 1];
+  s->p99 = times[(int)ceil(0.99 * n) - 1];
+}
@@ -0,0 +1,56 @@
+/*!\file bench.h
+ *
+ * \brief outils du banc d'essai du rendu (benchrender, window.c compilé
+ * avec -DBENCHMARK) : chemins de caméra et statistiques des durées de
+ * frames.
+ *
+ * Un chemin est une suite d'images clés (x, z, theta, pitch) de la
+ * caméra de window.c, parcourue par une spline de Catmull-Rom uniforme
+ * passant par chacune : le paramètre avance d'autant entre deux images
+ * clés successives quelle que soit leur distance, la caméra accélérant
+ * donc sur les segments longs et ralentissant sur les courts. Il se lit
+ * dans un fichier texte, une image clé par ligne ('#' pour les
+ * commentaires), tel que l'écrit campathAppend (touche k de
+ * l'application interactive), ou se génère (campathCircle).
+ *
+ * \author Farès BELHADJ, amsi@ai.univ-paris8.fr
+ * \date October 14 2026
+ */
+#ifndef _BENCH_H
+#define _BENCH_H
+
+#include <GL4D/gl4dummies.h>
+
+/*!\brief composantes d'une image clé */
+#define CAMPATH_KEY 4
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  typedef struct campath_t campath_t;
+  /*!\brief chemin de caméra */
+  struct campath_t {
+    int nkeys;
+    GLfloat * keys; /* nkeys x (x, z, theta, pitch) */
+  };
+
+  typedef struct bstats_t bstats_t;
+  /*!\brief statistiques de durées (ms) */
+  struct bstats_t {
+    int n;
+    GLdouble avg, min, p50, p99, max;
+  };
+
+  extern campath_t * campathLoad(const char * path);
+  extern campath_t * campathCircle(GLfloat radius, GLfloat pitch, int nkeys);
+  extern void        campathEval(const campath_t * c, GLfloat u, GLfloat key[CAMPATH_KEY]);
+  extern int         campathAppend(const char * path, const GLfloat key[CAMPATH_KEY]);
+  extern void        campathFree(campath_t * c);
+  extern void        benchStats(GLdouble * times, int n, bstats_t * s);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
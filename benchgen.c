@@ -0,0 +1,70 @@
+/*!\file benchgen.c
+ *
+ * \brief mesure des temps de génération de heightMap :
+ * gl4dmTriangleEdge (référence) contre heightGen, séquentiel et
+ * multithreadé, pour des côtés 2^k + 1 croissants.
+ *
+ * Usage : benchgen [côté maximal [nombre de threads]], par défaut 8193
+ * et tous les cœurs.
+ *
+ * \author Farès BELHADJ, amsi@ai.univ-paris8.fr
+ * \date October 14 2026
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <GL4D/gl4dm.h>
+#include <SDL.h>
+#include "heightgen.h"
+
+/*!\brief nombre de mesures par configuration, la meilleure est retenue */
+#define RUNS 3
+
+static Uint64 _t0 = 0;
+
+static void tic(void) {
+  _t0 = SDL_GetPerformanceCounter();
+}
+
+/*!\brief millisecondes écoulées depuis le dernier tic */
+static double toc(void) {
+  return (SDL_GetPerformanceCounter() - _t0) * 1000.0 / SDL_GetPerformanceFrequency();
+}
+
+/*!\brief meilleur temps (ms) de RUNS générations de côté n ; nthreads
+ * < 0 pour gl4dmTriangleEdge. Le dernier résultat est laissé dans
+ * *last (à libérer). */
+static double best(int n, int nthreads, GLfloat ** last) {
+  int r;
+  double t, tmin = 1e30;
+  for(r = 0; r < RUNS; r++) {
+    if(*last)
+      free(*last);
+    tic();
+    *last = nthreads < 0 ? gl4dmTriangleEdge(n, n, 0.5f) : heightGen(n, n, 0.5f, 1, nthreads);
+    t = toc();
+    tmin = t < tmin ? t : tmin;
+  }
+  return tmin;
+}
+
+int main(int argc, char ** argv) {
+  int n, nmax = argc > 1 ? atoi(argv[1]) : 8193, nthreads = argc > 2 ? atoi(argv[2]) : 0;
+  double tref, tseq, tpar;
+  GLfloat * ref = NULL, * seq = NULL, * par = NULL;
+  if(nthreads <= 0)
+    nthreads = SDL_GetCPUCount();
+  srand(1);
+  printf("%8s %14s %14s %14s %10s %10s\n", "cote", "TriangleEdge", "heightGen x1", "heightGen", "gain", "identique");
+  for(n = 257; n <= nmax; n = 2 * n - 1) {
+    tref = best(n, -1, &ref);
+    tseq = best(n, 1, &seq);
+    tpar = best(n, nthreads, &par);
+    /* le résultat ne doit dépendre que de la graine */
+    printf("%8d %11.1f ms %11.1f ms %8.1f ms/%-2d %9.1fx %10s\n", n, tref, tseq, tpar, nthreads,
+           tref / tpar, memcmp(seq, par, n * (size_t)n * sizeof *seq) ? "non" : "oui");
+    free(ref); free(seq); free(par);
+    ref = seq = par = NULL;
+  }
+  return 0;
+}
@@ -0,0 +1,181 @@
+/*!\file clipmap.c
+ *
+ * \brief clipmap de texture toroïdal, cf. clipmap.h.
+ *
+ * \author Farès BELHADJ, amsi@ai.univ-paris8.fr
+ * \date October 14 2026
+ */
+#include "clipmap.h"
+#include "program.h"
+#include "resources.h"
+#include <stdlib.h>
+#include <math.h>
+#include <assert.h>
+
+/*!\brief contenu de l'uniform buffer, disposition std140 du bloc
+ * clipmap */
+typedef struct clipblock_t clipblock_t;
+struct clipblock_t {
+  GLint origin[CLIPMAP_LEVELS][4];
+  GLfloat params[4];
+};
+
+static GLuint arrayTexture(const clipmap_t * c, int unit) {
+  GLuint id;
+  glGenTextures(1, &id);
+  glActiveTexture(GL_TEXTURE0 + unit);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, id);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+  glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, c->size, c->size, CLIPMAP_LEVELS, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+  resTrack(RES_TEXTURE, id, RES_SHADING, 4 * (size_t)c->size * c->size * CLIPMAP_LEVELS);
+  /* liée une fois pour toutes à son unité réservée */
+  glActiveTexture(GL_TEXTURE0);
+  return id;
+}
+
+/*!\brief clipmap de fenêtres size x size (puissance de 2), de scale
+ * texels par échantillon au niveau 0, sur une heightMap de samples
+ * intervalles ; fill produit les texels. Les fenêtres sont remplies au
+ * premier clipmapUpdate. */
+extern clipmap_t * clipmapNew(int size, int scale, const int samples[2], clipfill_t fill, void * arg) {
+  clipmap_t * c = malloc(sizeof *c);
+  int l;
+  assert(c && size > 0 && !(size & (size - 1)) && scale > 0);
+  c->size = size;
+  c->scale = scale;
+  c->samples[0] = samples[0];
+  c->samples[1] = samples[1];
+  for(l = 0; l < CLIPMAP_LEVELS; l++) {
+    c->origin[l][0] = c->origin[l][1] = 0;
+    c->valid[l] = 0;
+  }
+  c->fill = fill;
+  c->arg = arg;
+  c->uploaded = 0;
+  c->scratch = malloc(2 * size * size * 4);
+  assert(c->scratch);
+  c->albedo = arrayTexture(c, CLIPMAP_ALBEDO_UNIT);
+  c->normal = arrayTexture(c, CLIPMAP_NORMAL_UNIT);
+  glGenBuffers(1, &c->ubo);
+  glBindBuffer(GL_UNIFORM_BUFFER, c->ubo);
+  glBufferData(GL_UNIFORM_BUFFER, sizeof(clipblock_t), NULL, GL_DYNAMIC_DRAW);
+  resTrack(RES_BUFFER, c->ubo, RES_SHADING, sizeof(clipblock_t));
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+  glBindBufferBase(GL_UNIFORM_BUFFER, PROGRAM_CLIPMAP_BINDING, c->ubo);
+  return c;
+}
+
+/*!\brief production et transfert des texels [x0, x0 + w[ x [z0, z0 +
+ * h[ du niveau l, découpés aux bords du rangement toroïdal */
+static void fillRect(clipmap_t * c, int l, int x0, int z0, int w, int h) {
+  int x, z, nx, nz, m = c->size - 1;
+  GLubyte * albedo = c->scratch, * normal = c->scratch + c->size * c->size * 4;
+  if(w <= 0 || h <= 0)
+    return;
+  for(z = z0; z < z0 + h; z += nz) {
+    nz = c->size - (z & m);
+    nz = nz < z0 + h - z ? nz : z0 + h - z;
+    for(x = x0; x < x0 + w; x += nx) {
+      nx = c->size - (x & m);
+      nx = nx < x0 + w - x ? nx : x0 + w - x;
+      c->fill(c->arg, l, x, z, nx, nz, albedo, normal);
+      glActiveTexture(GL_TEXTURE0 + CLIPMAP_ALBEDO_UNIT);
+      glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, x & m, z & m, l, nx, nz, 1, GL_RGBA, GL_UNSIGNED_BYTE, albedo);
+      glActiveTexture(GL_TEXTURE0 + CLIPMAP_NORMAL_UNIT);
+      glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, x & m, z & m, l, nx, nz, 1, GL_RGBA, GL_UNSIGNED_BYTE, normal);
+    }
+  }
+  glActiveTexture(GL_TEXTURE0);
+  c->uploaded += w * h;
+}
+
+static void uploadBlock(const clipmap_t * c) {
+  clipblock_t b;
+  int l;
+  for(l = 0; l < CLIPMAP_LEVELS; l++) {
+    b.origin[l][0] = c->origin[l][0];
+    b.origin[l][1] = c->origin[l][1];
+    b.origin[l][2] = b.origin[l][3] = 0;
+  }
+  b.params[0] = c->size;
+  b.params[1] = c->scale;
+  b.params[2] = c->samples[0];
+  b.params[3] = c->samples[1];
+  glBindBuffer(GL_UNIFORM_BUFFER, c->ubo);
+  glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof b, &b);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+/*!\brief fenêtres centrées sur (x, z), en échantillons de la
+ * heightMap : chaque niveau déplacé ne produit que ses colonnes puis
+ * ses lignes découvertes, un niveau invalide ou trop déplacé est
+ * rempli en entier */
+extern void clipmapUpdate(clipmap_t * c, GLfloat x, GLfloat z) {
+  int l, ox, oz, dx, dz, kx, n = c->size, moved = 0;
+  int * o;
+  for(l = 0; l < CLIPMAP_LEVELS; l++) {
+    GLfloat k = c->scale / (GLfloat)(1 << l);
+    o = c->origin[l];
+    ox = (int)floorf(x * k) - n / 2;
+    oz = (int)floorf(z * k) - n / 2;
+    dx = ox - o[0];
+    dz = oz - o[1];
+    if(c->valid[l] && !dx && !dz)
+      continue;
+    moved = 1;
+    if(!c->valid[l] || abs(dx) >= n || abs(dz) >= n) {
+      fillRect(c, l, ox, oz, n, n);
+      c->valid[l] = 1;
+    } else {
+      /* colonnes découvertes sur toute la hauteur de la nouvelle
+       * fenêtre, puis lignes découvertes sur les colonnes conservées */
+      fillRect(c, l, dx > 0 ? o[0] + n : ox, oz, abs(dx), n);
+      kx = ox > o[0] ? ox : o[0];
+      fillRect(c, l, kx, dz > 0 ? o[1] + n : oz, n - abs(dx), abs(dz));
+    }
+    o[0] = ox;
+    o[1] = oz;
+  }
+  if(moved)
+    uploadBlock(c);
+}
+
+/*!\brief contenu à refaire en entier au prochain clipmapUpdate
+ * (données remplacées ou déplacées) */
+extern void clipmapInvalidate(clipmap_t * c) {
+  int l;
+  for(l = 0; l < CLIPMAP_LEVELS; l++)
+    c->valid[l] = 0;
+}
+
+/*!\brief reproduction immédiate des texels qui dépendent des
+ * échantillons [x0, x1] x [z0, z1] (bornes incluses) : un échantillon
+ * de plus pour l'interpolation et un texel de part et d'autre pour les
+ * pentes */
+extern void clipmapDirty(clipmap_t * c, int x0, int z0, int x1, int z1) {
+  int l, a[2], b[2], i;
+  const int r[2][2] = {{x0, x1}, {z0, z1}};
+  for(l = 0; l < CLIPMAP_LEVELS; l++) {
+    GLfloat k = c->scale / (GLfloat)(1 << l);
+    if(!c->valid[l])
+      continue;
+    for(i = 0; i < 2; i++) {
+      a[i] = (int)floorf((r[i][0] - 1) * k) - 2;
+      b[i] = (int)floorf((r[i][1] + 1) * k) + 2;
+      a[i] = a[i] > c->origin[l][i] ? a[i] : c->origin[l][i];
+      b[i] = b[i] < c->origin[l][i] + c->size ? b[i] : c->origin[l][i] + c->size;
+    }
+    fillRect(c, l, a[0], a[1], b[0] - a[0], b[1] - a[1]);
+  }
+}
+
+extern void clipmapDelete(clipmap_t * c) {
+  resDeleteTextures(1, &c->albedo);
+  resDeleteTextures(1, &c->normal);
+  resDeleteBuffers(1, &c->ubo);
+  free(c->scratch);
+  free(c);
+}
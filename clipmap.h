@@ -0,0 +1,80 @@
+/*!\file clipmap.h
+ *
+ * \brief clipmap de texture : données d'éclairage du terrain (couleur
+ * du matériau, normale) à une résolution décroissante autour de la
+ * caméra, en mémoire vidéo fixe quelle que soit la taille du monde.
+ *
+ * Le niveau l est une fenêtre de size x size texels de côté 2^l /
+ * scale échantillons de la heightMap, centrée sur la caméra ; toutes
+ * les fenêtres tiennent dans deux textures 2D array (un niveau par
+ * couche) adressées de façon toroïdale (GL_REPEAT) : le texel d'indice
+ * (i, j) du niveau l est rangé en (i mod size, j mod size). Quand la
+ * caméra se déplace, seules les lignes et colonnes découvertes sont
+ * produites (par la fonction fill de l'appelant) et transférées ; le
+ * transfert suit donc la vitesse de la caméra, pas la taille du monde.
+ *
+ * Les origines des fenêtres sont publiées dans un uniform buffer
+ * std140 lié au point PROGRAM_CLIPMAP_BINDING ; côté GLSL (cf.
+ * basic.fs, variante CLIPMAP) :
+ * \code
+ * layout(std140) uniform clipmap {
+ *   ivec4 clipOrigin[CLIPMAP_LEVELS]; // xy : origine en texels du niveau
+ *   vec4 clipParams;                  // size, scale, échantillons (w - 1, h - 1)
+ * };
+ * \endcode
+ * Un fragment lit le niveau le plus fin dont la fenêtre le contient et
+ * dont les texels ne sont pas plus petits que son empreinte à l'écran,
+ * en fondu vers le niveau suivant au bord de la fenêtre.
+ *
+ * \author Farès BELHADJ, amsi@ai.univ-paris8.fr
+ * \date October 14 2026
+ */
+#ifndef _CLIPMAP_H
+#define _CLIPMAP_H
+
+#include <GL4D/gl4dummies.h>
+
+/*!\brief nombre de niveaux (taille du tableau de l'uniform buffer) */
+#define CLIPMAP_LEVELS 6
+/*!\brief unités de texture réservées aux couleurs et aux normales */
+#define CLIPMAP_ALBEDO_UNIT 10
+#define CLIPMAP_NORMAL_UNIT 11
+/*!\brief defines de la variante CLIPMAP de basic.fs (même nombre de
+ * niveaux que CLIPMAP_LEVELS) */
+#define CLIPMAP_DEFINES "CLIPMAP CLIPMAP_LEVELS=6"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  /*!\brief production des texels [x0, x0 + w[ x [z0, z0 + h[ (indices
+   * du niveau level) : couleur et normale RGBA8, ligne par ligne */
+  typedef void (*clipfill_t)(void * arg, int level, int x0, int z0, int w, int h, GLubyte * albedo, GLubyte * normal);
+
+  typedef struct clipmap_t clipmap_t;
+  /*!\brief clipmap : fenêtres, textures et production */
+  struct clipmap_t {
+    int size;                 /* côté d'une fenêtre (texels, puissance de 2) */
+    int scale;                /* texels du niveau 0 par échantillon */
+    int samples[2];           /* intervalles de la heightMap (w - 1, h - 1) */
+    int origin[CLIPMAP_LEVELS][2]; /* origine de chaque fenêtre, indices du niveau */
+    int valid[CLIPMAP_LEVELS];     /* contenu de la fenêtre à jour */
+    GLuint albedo, normal;    /* textures 2D array */
+    GLuint ubo;
+    clipfill_t fill;
+    void * arg;
+    GLubyte * scratch;        /* texels produits avant transfert */
+    int uploaded;             /* texels produits et transférés, remis à 0 par l'appelant */
+  };
+
+  extern clipmap_t * clipmapNew(int size, int scale, const int samples[2], clipfill_t fill, void * arg);
+  extern void        clipmapUpdate(clipmap_t * c, GLfloat x, GLfloat z);
+  extern void        clipmapInvalidate(clipmap_t * c);
+  extern void        clipmapDirty(clipmap_t * c, int x0, int z0, int x1, int z1);
+  extern void        clipmapDelete(clipmap_t * c);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
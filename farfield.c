@@ -0,0 +1,222 @@
+/*!\file farfield.c
+ *
+ * \brief champ lointain rendu dans un cube de textures, cf.
+ * farfield.h.
+ *
+ * \author Farès BELHADJ, amsi@ai.univ-paris8.fr
+ * \date October 14 2026
+ */
+#include "farfield.h"
+#include "program.h"
+#include "variant.h"
+#include "vmath.h"
+#include "resources.h"
+#include <GL4D/gl4dg.h>
+#include <string.h>
+
+/*!\brief côté (texels) d'une face */
+static int _size = 0;
+/*!\brief cible de capture et sa profondeur, partagée par les faces */
+static GLuint _fbo = 0, _depth = 0;
+/*!\brief deux jeux de cubes, couleur (RGBA8) et distance (R32F) : le
+ * jeu affiché _front et celui en cours de capture */
+static GLuint _color[2] = {0, 0}, _dist[2] = {0, 0};
+static int _front = 0;
+/*!\brief point de capture de chaque jeu (monde) */
+static GLfloat _eye[2][3];
+/*!\brief le jeu affiché vaut-il ? prochaine face à capturer dans
+ * l'autre jeu, -1 hors capture ; terrain changé depuis le début de la
+ * dernière capture */
+static int _valid = 0, _face = -1, _stale = 1;
+/*!\brief captures terminées */
+static int _captures = 0;
+/*!\brief programme d'affichage, géométrie plein écran */
+static program_t _prog;
+static GLint _eyeLoc = -1;
+static GLuint _quad = 0;
+
+/*!\brief texture cube de côté _size au format internal */
+static GLuint cubeNew(GLenum internal, GLenum format, GLenum type, GLenum filter, size_t texel) {
+  GLuint id;
+  int k;
+  glGenTextures(1, &id);
+  glBindTexture(GL_TEXTURE_CUBE_MAP, id);
+  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, filter);
+  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, filter);
+  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+  for(k = 0; k < FARFIELD_FACES; k++)
+    glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + k, 0, internal, _size, _size, 0, format, type, NULL);
+  glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+  resTrack(RES_TEXTURE, id, RES_SHADING, FARFIELD_FACES * texel * _size * _size);
+  return id;
+}
+
+/*!\brief cubes de faces size x size, cible de capture et programme
+ * d'affichage */
+extern void farFieldInit(int size) {
+  static const GLenum buffers[2] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+  GLint fb;
+  int k;
+  if(_fbo)
+    return;
+  _size = size;
+  for(k = 0; k < 2; k++) {
+    /* la couleur est filtrée aux silhouettes ; une distance interpolée
+     * entre terrain et fond ne correspond à aucun point */
+    _color[k] = cubeNew(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, GL_LINEAR, 4);
+    _dist[k] = cubeNew(GL_R32F, GL_RED, GL_FLOAT, GL_NEAREST, 4);
+  }
+  glGenTextures(1, &_depth);
+  glBindTexture(GL_TEXTURE_2D, _depth);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, _size, _size, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, NULL);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  resTrack(RES_TEXTURE, _depth, RES_SHADING, 4 * (size_t)_size * _size);
+  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &fb);
+  glGenFramebuffers(1, &_fbo);
+  glBindFramebuffer(GL_FRAMEBUFFER, _fbo);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, _depth, 0);
+  glDrawBuffers(2, buffers);
+  glBindFramebuffer(GL_FRAMEBUFFER, fb);
+  /* filtrage à travers les arêtes du cube */
+  glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+  programInit(&_prog, variantProgram("", "<vs>shaders/farfield.vs", "<fs>shaders/farfield.fs", NULL));
+  programSampler(&_prog, "farColor", FARFIELD_COLOR_UNIT);
+  programSampler(&_prog, "farDistance", FARFIELD_DISTANCE_UNIT);
+  _eyeLoc = glGetUniformLocation(_prog.id, "captureEye");
+  glUseProgram(0);
+  _quad = gl4dgGenQuadf();
+  resTrackGeometry(_quad, RES_SHADING);
+  _valid = 0;
+  _face = -1;
+  _stale = 1;
+}
+
+/*!\brief capture de la face k du jeu set (cible liée), plan lointain
+ * far ; verticales des faces selon la convention des textures cube
+ * (t vers le bas) */
+static void farFace(int set, int k, GLfloat far, farscene_t scene, void * arg) {
+  static const GLfloat dirs[FARFIELD_FACES][3] = {
+    {1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1}
+  };
+  static const GLfloat ups[FARFIELD_FACES][3] = {
+    {0, -1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1}, {0, -1, 0}, {0, -1, 0}
+  };
+  static const GLfloat zero[4] = {0, 0, 0, 0};
+  GLfloat c[3], view[16], proj[16];
+  int i;
+  for(i = 0; i < 3; i++)
+    c[i] = _eye[set][i] + dirs[k][i];
+  mat4LookAt(view, _eye[set], c, ups[k]);
+  mat4Frustum(proj, -1.0f, 1.0f, -1.0f, 1.0f, 1.0f, far);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + k, _color[set], 0);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_CUBE_MAP_POSITIVE_X + k, _dist[set], 0);
+  /* alpha et distance nuls : pas de terrain, le fond reste visible */
+  glClearBufferfv(GL_COLOR, 0, zero);
+  glClearBufferfv(GL_COLOR, 1, zero);
+  glClear(GL_DEPTH_BUFFER_BIT);
+  /* 90 degrés : 2 unités à distance 1 couvrent _size pixels */
+  scene(arg, _eye[set], view, proj, 0.5f * _size);
+}
+
+/*!\brief suite de la capture en cours, ou nouvelle capture depuis eye
+ * si l'œil est à plus de threshold (monde) du point de capture affiché
+ * ou si le terrain a changé ; plan lointain far. Appelée par le thread
+ * GL hors du dessin de la frame. Retourne le nombre de faces
+ * rendues. */
+extern int farFieldUpdate(const GLfloat eye[3], GLfloat threshold, GLfloat far, farscene_t scene, void * arg) {
+  int back = 1 - _front, n = 0;
+  GLint fb, vp[4];
+  GLboolean blend;
+  if(!_fbo)
+    return 0;
+  if(_face < 0) {
+    GLfloat dx = eye[0] - _eye[_front][0], dy = eye[1] - _eye[_front][1], dz = eye[2] - _eye[_front][2];
+    if(_valid && !_stale && dx * dx + dy * dy + dz * dz <= threshold * threshold)
+      return 0;
+    memcpy(_eye[back], eye, sizeof _eye[back]);
+    _stale = 0;
+    _face = 0;
+  }
+  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &fb);
+  glGetIntegerv(GL_VIEWPORT, vp);
+  blend = glIsEnabled(GL_BLEND);
+  glBindFramebuffer(GL_FRAMEBUFFER, _fbo);
+  glViewport(0, 0, _size, _size);
+  /* terrain opaque, et pas de mélange sur la cible de distance */
+  glDisable(GL_BLEND);
+  /* étalée sur les frames tant qu'un jeu valable reste affiché */
+  do {
+    farFace(back, _face++, far, scene, arg);
+    n++;
+  } while(_face < FARFIELD_FACES && !_valid);
+  glBindFramebuffer(GL_FRAMEBUFFER, fb);
+  glViewport(vp[0], vp[1], vp[2], vp[3]);
+  if(blend)
+    glEnable(GL_BLEND);
+  if(_face == FARFIELD_FACES) {
+    _front = back;
+    _valid = 1;
+    _face = -1;
+    _captures++;
+  }
+  return n;
+}
+
+/*!\brief le terrain a changé : nouvelle capture à la prochaine mise à
+ * jour ; si discard, le jeu affiché ne vaut plus rien (terrain remplacé
+ * ou déplacé) et la capture en cours est abandonnée */
+extern void farFieldInvalidate(int discard) {
+  _stale = 1;
+  if(discard) {
+    _valid = 0;
+    _face = -1;
+  }
+}
+
+extern int farFieldValid(void) {
+  return _valid;
+}
+
+/*!\brief dessin du jeu affiché sur tout l'écran, profondeur écrite
+ * quel que soit le test ; le bloc frame doit être celui de la frame
+ * dessinée */
+extern void farFieldDraw(void) {
+  GLint func;
+  if(!_valid)
+    return;
+  glGetIntegerv(GL_DEPTH_FUNC, &func);
+  glDepthFunc(GL_ALWAYS);
+  glUseProgram(_prog.id);
+  glUniform3fv(_eyeLoc, 1, _eye[_front]);
+  glActiveTexture(GL_TEXTURE0 + FARFIELD_COLOR_UNIT);
+  glBindTexture(GL_TEXTURE_CUBE_MAP, _color[_front]);
+  glActiveTexture(GL_TEXTURE0 + FARFIELD_DISTANCE_UNIT);
+  glBindTexture(GL_TEXTURE_CUBE_MAP, _dist[_front]);
+  glActiveTexture(GL_TEXTURE0);
+  gl4dgDraw(_quad);
+  glDepthFunc(func);
+}
+
+extern int farFieldCaptures(void) {
+  return _captures;
+}
+
+extern void farFieldFree(void) {
+  if(!_fbo)
+    return;
+  glDeleteFramebuffers(1, &_fbo);
+  _fbo = 0;
+  resDeleteTextures(2, _color);
+  resDeleteTextures(2, _dist);
+  resDeleteTextures(1, &_depth);
+  _color[0] = _color[1] = _dist[0] = _dist[1] = _depth = 0;
+  resUntrackGeometry(_quad);
+  gl4dgDelete(_quad);
+  _quad = 0;
+  _valid = 0;
+  _face = -1;
+}
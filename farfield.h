@@ -0,0 +1,63 @@
+/*!\file farfield.h
+ *
+ * \brief champ lointain : au-delà d'une distance donnée, le terrain est
+ * rendu depuis un point de capture dans un cube de textures (couleur et
+ * distance au point de capture) puis redessiné à chaque frame en un
+ * seul draw plein écran ; seul le champ proche garde sa géométrie.
+ *
+ * - Capture : l'appelant fournit le dessin d'une face (farscene_t),
+ *   vue et projection à 90 degrés, et écarte lui-même les fragments du
+ *   champ proche (variante FAR_FIELD de basic.fs, qui écrit aussi la
+ *   distance en sortie 1). Le cube n'a pas d'orientation privilégiée :
+ *   tourner la caméra ne demande aucune capture.
+ * - Mise à jour : une capture est lancée dès que l'œil s'éloigne du
+ *   point de capture de plus d'un seuil, ou que le terrain a changé.
+ *   Elle se fait dans un second cube, une face par frame, puis les deux
+ *   cubes sont échangés : le coût est étalé sur FARFIELD_FACES frames.
+ *   Sans cube affiché valable (démarrage, terrain remplacé ou déplacé),
+ *   les six faces sont rendues d'un coup.
+ * - Affichage : chaque pixel lit le cube selon sa direction de vue et
+ *   écrit la profondeur du point capturé, vu de l'œil courant ; l'eau
+ *   et le champ proche se testent contre lui normalement. Les texels
+ *   sans terrain (distance nulle) laissent voir le fond.
+ *
+ * \author Farès BELHADJ, amsi@ai.univ-paris8.fr
+ * \date October 14 2026
+ */
+#ifndef _FARFIELD_H
+#define _FARFIELD_H
+
+#include <GL4D/gl4dummies.h>
+
+/*!\brief unités de texture du cube affiché : couleur et distance */
+#define FARFIELD_COLOR_UNIT 12
+#define FARFIELD_DISTANCE_UNIT 13
+/*!\brief faces du cube */
+#define FARFIELD_FACES 6
+/*!\brief défines de la variante de basic.fs qui capture le champ
+ * lointain (uniform farNear : distance du champ proche) */
+#define FARFIELD_DEFINES "FAR_FIELD"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  /*!\brief dessin d'une face depuis le point de capture eye : matrices
+   * de vue et de projection (rangées par lignes), pixels couverts par
+   * une unité à distance 1 */
+  typedef void (*farscene_t)(void * arg, const GLfloat eye[3], const GLfloat * view, const GLfloat * projection,
+                             GLfloat kscreen);
+
+  extern void farFieldInit(int size);
+  extern int  farFieldUpdate(const GLfloat eye[3], GLfloat threshold, GLfloat far, farscene_t scene, void * arg);
+  extern void farFieldInvalidate(int discard);
+  extern int  farFieldValid(void);
+  extern void farFieldDraw(void);
+  extern int  farFieldCaptures(void);
+  extern void farFieldFree(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,287 @@
+/*!\file gpucull.c
+ *
+ * \brief choix des nœuds de terrain sur GPU, cf. gpucull.h.
+ *
+ * \author Farès BELHADJ, amsi@ai.univ-paris8.fr
+ * \date October 14 2026
+ */
+#include "gpucull.h"
+#include "variant.h"
+#include "resources.h"
+#include <string.h>
+#include <stdlib.h>
+#include <assert.h>
+
+/*!\brief nœud tel que lu par shaders/cull.cs (std430) */
+typedef struct gnode_t gnode_t;
+struct gnode_t {
+  GLfloat bmin[4];          /* boîte, erreur */
+  GLfloat bmax[4];          /* boîte, erreur du parent */
+  GLint tile[4];            /* origine (x0, z0), pas et parent */
+};
+
+/*!\brief programme de choix d'un mode de terrain et emplacements de
+ * ses uniformes */
+typedef struct cprog_t cprog_t;
+struct cprog_t {
+  GLuint id;
+  GLint nnodes, nindices, nvertices, eye, kscreen, tau, planes, frustum, previous, viewport, occlusion;
+};
+
+/*!\brief extensions présentes */
+static int _supported = 0;
+/*!\brief programmes de choix : grille partagée (0) et maillages (1) */
+static cprog_t _cull[2];
+/*!\brief programmes de la pyramide : depuis la profondeur puis d'un
+ * niveau au suivant */
+static GLuint _hizFromDepthPId = 0, _hizPId = 0;
+/*!\brief nœuds et commandes de dessin indirect */
+static GLuint _nodeBuffer = 0, _commands = 0;
+/*!\brief nœuds du buffer : terrain, révision et nombre ; 0 nœud s'il
+ * est à refaire */
+static const terrain_t * _terrain = NULL;
+static unsigned int _revision = 0;
+static int _nnodes = 0;
+/*!\brief profondeur copiée de la fenêtre (w x h), pyramide Hi-Z
+ * (w / 2 x h / 2 au niveau 0) et son nombre de niveaux */
+static GLuint _depthTex = 0, _hizTex = 0;
+static int _w = 0, _h = 0, _levels = 0;
+/*!\brief vue-projection du dernier gpuCullRun et celle de la pyramide ;
+ * la pyramide décrit-elle la vue précédente ? */
+static GLfloat _vp[16], _previous[16];
+static int _hizValid = 0;
+
+/*!\brief l'extension name est-elle disponible ? */
+static int hasExtension(const char * name) {
+  GLint i, n = 0;
+  glGetIntegerv(GL_NUM_EXTENSIONS, &n);
+  for(i = 0; i < n; i++)
+    if(!strcmp((const char *)glGetStringi(GL_EXTENSIONS, i), name))
+      return 1;
+  return 0;
+}
+
+static void cullProgram(cprog_t * p, const char * defines) {
+  p->id = variantProgram(defines, "<cs>shaders/cull.cs", NULL);
+  p->nnodes = glGetUniformLocation(p->id, "nnodes");
+  p->nindices = glGetUniformLocation(p->id, "nindices");
+  p->nvertices = glGetUniformLocation(p->id, "nvertices");
+  p->eye = glGetUniformLocation(p->id, "eye");
+  p->kscreen = glGetUniformLocation(p->id, "kscreen");
+  p->tau = glGetUniformLocation(p->id, "tau");
+  p->planes = glGetUniformLocation(p->id, "planes");
+  p->frustum = glGetUniformLocation(p->id, "frustum");
+  p->previous = glGetUniformLocation(p->id, "previous");
+  p->viewport = glGetUniformLocation(p->id, "viewport");
+  p->occlusion = glGetUniformLocation(p->id, "occlusion");
+  glUseProgram(p->id);
+  glUniform1i(glGetUniformLocation(p->id, "hiz"), GPUCULL_HIZ_UNIT);
+}
+
+/*!\brief création des programmes et buffers si le pilote dispose des
+ * passes de calcul, des shader storage buffers, du dessin indirect
+ * multiple et des images ; retourne 0 sinon */
+extern int gpuCullInit(void) {
+  if(_supported)
+    return 1;
+  if(!hasExtension("GL_ARB_compute_shader") || !hasExtension("GL_ARB_shader_storage_buffer_object") ||
+     !hasExtension("GL_ARB_multi_draw_indirect") || !hasExtension("GL_ARB_shader_image_load_store"))
+    return 0;
+  cullProgram(&_cull[0], "GRID");
+  cullProgram(&_cull[1], "");
+  _hizFromDepthPId = variantProgram("FROM_DEPTH", "<cs>shaders/hiz.cs", NULL);
+  glUseProgram(_hizFromDepthPId);
+  glUniform1i(glGetUniformLocation(_hizFromDepthPId, "depth"), GPUCULL_HIZ_UNIT);
+  glUniform1i(glGetUniformLocation(_hizFromDepthPId, "dst"), 0);
+  _hizPId = variantProgram("", "<cs>shaders/hiz.cs", NULL);
+  glUseProgram(_hizPId);
+  glUniform1i(glGetUniformLocation(_hizPId, "dst"), 0);
+  glUniform1i(glGetUniformLocation(_hizPId, "src"), 1);
+  glUseProgram(0);
+  glGenBuffers(1, &_nodeBuffer);
+  glGenBuffers(1, &_commands);
+  return _supported = 1;
+}
+
+/*!\brief nœuds à renvoyer et pyramide sans valeur (terrain remplacé ou
+ * déplacé, fenêtre redimensionnée) */
+extern void gpuCullInvalidate(void) {
+  _nnodes = 0;
+  _hizValid = 0;
+}
+
+/*!\brief copie des nœuds de t, avec l'indice de leur parent */
+static void uploadNodes(const terrain_t * t) {
+  int i, c;
+  gnode_t * g = malloc(t->nnodes * sizeof *g);
+  assert(g);
+  for(i = 0; i < t->nnodes; i++) {
+    const tnode_t * n = &t->nodes[i];
+    memcpy(g[i].bmin, n->bmin, sizeof n->bmin);
+    memcpy(g[i].bmax, n->bmax, sizeof n->bmax);
+    g[i].bmin[3] = n->error;
+    g[i].bmax[3] = n->perror;
+    g[i].tile[0] = n->x0;
+    g[i].tile[1] = n->z0;
+    g[i].tile[2] = 1 << n->level;
+    if(!i)
+      g[i].tile[3] = -1;
+    for(c = 0; c < 4; c++)
+      if(n->children[c] >= 0)
+        g[n->children[c]].tile[3] = i;
+  }
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, _nodeBuffer);
+  glBufferData(GL_SHADER_STORAGE_BUFFER, t->nnodes * sizeof *g, g, GL_STATIC_DRAW);
+  resTrack(RES_BUFFER, _nodeBuffer, RES_CULL, t->nnodes * sizeof *g);
+  if(t->nnodes != _nnodes) {
+    /* une commande par nœud en TERRAIN_MESHES, une en TERRAIN_GRID */
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, _commands);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, t->nnodes * 5 * sizeof(GLuint), NULL, GL_DYNAMIC_DRAW);
+    resTrack(RES_BUFFER, _commands, RES_CULL, t->nnodes * 5 * sizeof(GLuint));
+  }
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+  free(g);
+  _terrain = t;
+  _revision = t->revision;
+  _nnodes = t->nnodes;
+}
+
+/*!\brief choix des nœuds de t vus de eye (mêmes paramètres que
+ * terrainSelect, tau donné) et écriture des commandes pour
+ * terrainDrawIndirect, dont le buffer est retourné ; en TERRAIN_GRID,
+ * les instances sont écrites dans l'instance buffer de t. Laisse le
+ * programme 0 actif. */
+extern GLuint gpuCullRun(terrain_t * t, const GLfloat eye[3], GLfloat kscreen, GLfloat tau, const GLfloat * viewProjection) {
+  int p, i;
+  GLfloat planes[6][4];
+  const GLfloat * m = viewProjection;
+  const cprog_t * c = &_cull[t->mode == TERRAIN_GRID ? 0 : 1];
+  assert(_supported);
+  if(t != _terrain || t->revision != _revision || t->nnodes != _nnodes)
+    uploadNodes(t);
+  for(p = 0; p < 6; p++)
+    for(i = 0; i < 4; i++)
+      planes[p][i] = m[12 + i] + ((p & 1) ? -1.0f : 1.0f) * m[4 * (p >> 1) + i];
+  memcpy(_vp, m, sizeof _vp);
+  glUseProgram(c->id);
+  glUniform1i(c->nnodes, t->nnodes);
+  glUniform1i(c->nindices, t->nindices);
+  glUniform1i(c->nvertices, t->nvertices);
+  glUniform3fv(c->eye, 1, eye);
+  glUniform1f(c->kscreen, kscreen);
+  glUniform1f(c->tau, tau);
+  glUniform4fv(c->planes, 6, &planes[0][0]);
+  glUniform1i(c->frustum, (t->culling & TERRAIN_CULL_FRUSTUM) != 0);
+  glUniform1i(c->occlusion, (t->culling & TERRAIN_CULL_OCCLUSION) && _hizValid);
+  if(_hizValid) {
+    glUniformMatrix4fv(c->previous, 1, GL_TRUE, _previous);
+    glUniform2i(c->viewport, _w, _h);
+    glActiveTexture(GL_TEXTURE0 + GPUCULL_HIZ_UNIT);
+    glBindTexture(GL_TEXTURE_2D, _hizTex);
+    glActiveTexture(GL_TEXTURE0);
+  }
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, _nodeBuffer);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, _commands);
+  if(t->mode == TERRAIN_GRID) {
+    /* commande unique sans instance, puis instances ajoutées par le
+     * shader dans l'instance buffer réalloué (orphelinage) */
+    GLuint cmd[5] = {t->nindices, 0, 0, 0, 0};
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof cmd, cmd);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, t->ibuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, t->nnodes * TERRAIN_INSTANCE_SIZE * sizeof(GLfloat), NULL, GL_STREAM_DRAW);
+    resTrack(RES_BUFFER, t->ibuffer, RES_TERRAIN, t->nnodes * TERRAIN_INSTANCE_SIZE * sizeof(GLfloat));
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, t->ibuffer);
+  }
+  glDispatchCompute((t->nnodes + 63) / 64, 1, 1);
+  glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+  for(i = 0; i < 3; i++)
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, i, 0);
+  if(_hizValid) {
+    glActiveTexture(GL_TEXTURE0 + GPUCULL_HIZ_UNIT);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE0);
+  }
+  glUseProgram(0);
+  return _commands;
+}
+
+/*!\brief (ré)allocation de la profondeur et de la pyramide pour une
+ * fenêtre w x h */
+static void hizTextures(int w, int h) {
+  int l, lw = w > 1 ? w >> 1 : 1, lh = h > 1 ? h >> 1 : 1;
+  size_t bytes = 0;
+  resDeleteTextures(1, &_depthTex);
+  resDeleteTextures(1, &_hizTex);
+  glGenTextures(1, &_depthTex);
+  glBindTexture(GL_TEXTURE_2D, _depthTex);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, w, h, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, NULL);
+  /* 24 bits stockés sur 32 */
+  resTrack(RES_TEXTURE, _depthTex, RES_CULL, 4 * (size_t)w * h);
+  glGenTextures(1, &_hizTex);
+  glBindTexture(GL_TEXTURE_2D, _hizTex);
+  for(l = 0; ; l++) {
+    glTexImage2D(GL_TEXTURE_2D, l, GL_R32F, lw, lh, 0, GL_RED, GL_FLOAT, NULL);
+    bytes += 4 * (size_t)lw * lh;
+    if(lw == 1 && lh == 1)
+      break;
+    lw = lw > 1 ? lw >> 1 : 1;
+    lh = lh > 1 ? lh >> 1 : 1;
+  }
+  _levels = l + 1;
+  resTrack(RES_TEXTURE, _hizTex, RES_CULL, bytes);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, l);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  _w = w;
+  _h = h;
+}
+
+/*!\brief pyramide Hi-Z de la profondeur du framebuffer de lecture (w x
+ * h), une fois le terrain dessiné et avant l'eau, translucide, pour le
+ * gpuCullRun suivant. Laisse le programme 0 actif. */
+extern void gpuCullDepth(int w, int h) {
+  int l;
+  if(!_supported)
+    return;
+  if(w != _w || h != _h)
+    hizTextures(w, h);
+  glActiveTexture(GL_TEXTURE0 + GPUCULL_HIZ_UNIT);
+  glBindTexture(GL_TEXTURE_2D, _depthTex);
+  glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, w, h);
+  glUseProgram(_hizFromDepthPId);
+  glBindImageTexture(0, _hizTex, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+  l = w > 1 ? w >> 1 : 1;
+  glDispatchCompute((l + 7) / 8, ((h > 1 ? h >> 1 : 1) + 7) / 8, 1);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glActiveTexture(GL_TEXTURE0);
+  glUseProgram(_hizPId);
+  for(l = 1; l < _levels; l++) {
+    int lw = (w >> (l + 1)) > 1 ? w >> (l + 1) : 1, lh = (h >> (l + 1)) > 1 ? h >> (l + 1) : 1;
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    glBindImageTexture(1, _hizTex, l - 1, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+    glBindImageTexture(0, _hizTex, l, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+    glDispatchCompute((lw + 7) / 8, (lh + 7) / 8, 1);
+  }
+  glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+  glBindImageTexture(0, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+  glBindImageTexture(1, 0, 0, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+  glUseProgram(0);
+  memcpy(_previous, _vp, sizeof _previous);
+  _hizValid = 1;
+}
+
+extern void gpuCullFree(void) {
+  if(!_supported)
+    return;
+  resDeleteBuffers(1, &_nodeBuffer);
+  resDeleteBuffers(1, &_commands);
+  resDeleteTextures(1, &_depthTex);
+  resDeleteTextures(1, &_hizTex);
+  _nodeBuffer = _commands = _depthTex = _hizTex = 0;
+  _w = _h = _levels = _nnodes = 0;
+  _terrain = NULL;
+  _hizValid = _supported = 0;
+}
@@ -0,0 +1,53 @@
+/*!\file gpucull.h
+ *
+ * \brief choix des nœuds de terrain sur GPU : une passe de calcul
+ * teste chaque nœud (frustum, occlusion), choisit son niveau de détail
+ * et écrit les commandes de dessin indirect lues par
+ * terrainDrawIndirect. Le coût CPU ne dépend plus du nombre de nœuds
+ * et les instances (TERRAIN_GRID) ne transitent plus par le CPU.
+ *
+ * - Niveau de détail : un nœud est retenu si son erreur projetée est
+ *   acceptable (ou s'il est du niveau le plus fin) et que celle de son
+ *   parent ne l'est pas. Les erreurs étant monotones et la boîte d'un
+ *   parent contenant celles de ses enfants, c'est la coupe du parcours
+ *   de terrainSelect, calculée nœud par nœud sans parcours.
+ * - Frustum (TERRAIN_CULL_FRUSTUM) : mêmes plans que terrainSelect.
+ * - Occlusion (TERRAIN_CULL_OCCLUSION) : en lieu de l'horizon, la boîte
+ *   projetée par la vue de la frame précédente est comparée à une
+ *   pyramide Hi-Z (maxima de profondeur) de la profondeur du terrain
+ *   de cette frame, construite par gpuCullDepth. Une zone découverte
+ *   d'une frame à l'autre peut manquer pendant une frame.
+ *
+ * En TERRAIN_MESHES, la commande i est celle du nœud i (nulle s'il est
+ * écarté) ; en TERRAIN_GRID, les nœuds retenus s'ajoutent, dans un
+ * ordre quelconque (l'ordre d'avant en arrière de terrainSelect est
+ * perdu), aux instances d'une commande unique. Ni statistiques ni
+ * régulation du budget de triangles : rien n'est relu.
+ *
+ * \author Farès BELHADJ, amsi@ai.univ-paris8.fr
+ * \date October 14 2026
+ */
+#ifndef _GPUCULL_H
+#define _GPUCULL_H
+
+#include "terrain.h"
+
+/*!\brief unité de texture de la pyramide Hi-Z (et de la profondeur
+ * pendant sa construction) */
+#define GPUCULL_HIZ_UNIT 9
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  extern int    gpuCullInit(void);
+  extern void   gpuCullInvalidate(void);
+  extern GLuint gpuCullRun(terrain_t * t, const GLfloat eye[3], GLfloat kscreen, GLfloat tau, const GLfloat * viewProjection);
+  extern void   gpuCullDepth(int w, int h);
+  extern void   gpuCullFree(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
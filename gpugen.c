@@ -0,0 +1,316 @@
+/*!\file gpugen.c
+ *
+ * \brief génération de heightMap et de normales sur GPU, cf.
+ * gpugen.h. Nécessite que initNoiseTextures ait été appelée.
+ *
+ * \author Farès BELHADJ, amsi@ai.univ-paris8.fr
+ * \date October 14 2026
+ */
+#include "gpugen.h"
+#include "noise.h"
+#include "variant.h"
+#include "resources.h"
+#include <stdio.h>
+#include <GL4D/gl4du.h>
+#include <GL4D/gl4dg.h>
+#include <string.h>
+#include <assert.h>
+
+/*!\brief nombre de périodes du bruit de base sur la largeur du terrain */
+#define GPUGEN_FREQUENCY 4.0f
+
+/*!\brief dimensions de la heightMap produite */
+static int _w = 0, _h = 0;
+/*!\brief nombre d'octaves du bruit de _genPId */
+static int _octaves = 0;
+/*!\brief framebuffer et quad plein écran des passes */
+static GLuint _fbo = 0, _quad = 0;
+/*!\brief programmes GLSL : altitudes (fBm) et normales */
+static GLuint _genPId = 0, _normalPId = 0;
+/*!\brief emplacements des uniformes de _genPId */
+static GLint _offsetLoc = -1, _reductionLoc = -1;
+/*!\brief textures produites : altitudes et normales */
+static GLuint _heightTexId = 0, _normalTexId = 0;
+/*!\brief requêtes de mesure de la durée GPU de chaque passe */
+static GLuint _queries[2] = {0, 0};
+/*!\brief durées (ms) des deux passes de la dernière génération relue */
+static GLdouble _ms[2] = {0.0, 0.0};
+/*!\brief relecture asynchrone des altitudes : pixel pack buffer et
+ * barrière posée derrière la copie, 0 sans relecture en cours */
+static GLuint _pbo = 0;
+static GLsync _fence = 0;
+
+typedef struct glstate_t glstate_t;
+/*!\brief état GL modifié par les passes, restauré à leur sortie */
+struct glstate_t {
+  GLint vp[4], scissor[4], pId, pm[2], fb;
+  GLboolean depth, blend, scissorTest;
+};
+
+/*!\brief texture _w x _h, de texel octets par texel */
+static GLuint genTexture(GLint internalFormat, GLenum format, GLenum type, int texel) {
+  GLuint id;
+  glGenTextures(1, &id);
+  glBindTexture(GL_TEXTURE_2D, id);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, _w, _h, 0, format, type, NULL);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  resTrack(RES_TEXTURE, id, RES_GEN, texel * (size_t)_w * _h);
+  return id;
+}
+
+/*!\brief décalage dans le domaine du bruit (dans [0, 256[) obtenu par
+ * hachage de la graine */
+static void seedOffset(unsigned int seed, GLfloat offset[2]) {
+  int i;
+  unsigned int h;
+  for(i = 0; i < 2; i++) {
+    h = (seed + i) * 0x9E3779B1u;
+    h ^= h >> 16; h *= 0x7FEB352Du;
+    h ^= h >> 15; h *= 0x846CA68Bu;
+    h ^= h >> 16;
+    offset[i] = (h >> 8) * (256.0f / 16777216.0f);
+  }
+}
+
+/*!\brief (re)prend _genPId avec le backend de bruit courant et
+ * résout ses uniformes ; laisse _genPId actif */
+static void genProgram(void) {
+  char defines[32];
+  /* boucle d'octaves de longueur fixe, déroulable à la compilation */
+  snprintf(defines, sizeof defines, "OCTAVES=%d", _octaves);
+  _genPId = noiseProgram(defines, "<vs>shaders/water.vs", "<fs>shaders/terraingen.fs");
+  _offsetLoc = glGetUniformLocation(_genPId, "offset");
+  _reductionLoc = glGetUniformLocation(_genPId, "reduction");
+  glUniform1f(glGetUniformLocation(_genPId, "frequency"), GPUGEN_FREQUENCY);
+  glUniform2f(glGetUniformLocation(_genPId, "size"), _w - 1.0f, _h - 1.0f);
+}
+
+/*!\brief framebuffer, quad et programme de la passe de normales,
+ * créés au premier besoin : gpuGenNormals sert aussi sans génération */
+static void shared(void) {
+  if(_fbo)
+    return;
+  _normalPId = variantProgram("", "<vs>shaders/water.vs", "<fs>shaders/terrainnormal.fs", NULL);
+  glUseProgram(_normalPId);
+  glUniform1i(glGetUniformLocation(_normalPId, "height"), 0);
+  glUseProgram(0);
+  _quad = gl4dgGenQuadf();
+  resTrackGeometry(_quad, RES_GEN);
+  glGenFramebuffers(1, &_fbo);
+}
+
+/*!\brief création des programmes, textures et framebuffer pour des
+ * heightMaps de la taille de hm */
+extern void gpuGenInit(const heightmap_t * hm) {
+  GLfloat n = (GLfloat)(hm->w > hm->h ? hm->w : hm->h) - 1.0f;
+  if(_genPId)
+    return;
+  shared();
+  _w = hm->w;
+  _h = hm->h;
+  /* octaves jusqu'à une période d'environ deux échantillons */
+  for(_octaves = 1; GPUGEN_FREQUENCY * (1 << _octaves) <= n / 2.0f; _octaves++);
+  genProgram();
+  glUseProgram(0);
+  _heightTexId = genTexture(GL_R32F, GL_RED, GL_FLOAT, 4);
+  _normalTexId = genTexture(GL_RGB10_A2, GL_RGBA, GL_UNSIGNED_INT_2_10_10_10_REV, 4);
+  glGenQueries(2, _queries);
+}
+
+/*!\brief reprend le programme de génération avec le backend de bruit
+ * courant (cf. setNoiseBackend) */
+extern void gpuGenRebuild(void) {
+  if(!_genPId)
+    return;
+  genProgram();
+  glUseProgram(0);
+}
+
+/*!\brief sauvegarde de l'état GL dans s puis état des passes :
+ * framebuffer _fbo, sans profondeur ni mélange, polygones pleins */
+static void passBegin(glstate_t * s) {
+  glGetIntegerv(GL_VIEWPORT, s->vp);
+  glGetIntegerv(GL_SCISSOR_BOX, s->scissor);
+  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &s->fb);
+  glGetIntegerv(GL_CURRENT_PROGRAM, &s->pId);
+  glGetIntegerv(GL_POLYGON_MODE, s->pm);
+  s->depth = glIsEnabled(GL_DEPTH_TEST);
+  s->blend = glIsEnabled(GL_BLEND);
+  s->scissorTest = glIsEnabled(GL_SCISSOR_TEST);
+  glDisable(GL_DEPTH_TEST);
+  glDisable(GL_BLEND);
+  glDisable(GL_SCISSOR_TEST);
+  glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+  glBindFramebuffer(GL_FRAMEBUFFER, _fbo);
+}
+
+static void passEnd(const glstate_t * s) {
+  glBindFramebuffer(GL_FRAMEBUFFER, s->fb);
+  glViewport(s->vp[0], s->vp[1], s->vp[2], s->vp[3]);
+  glScissor(s->scissor[0], s->scissor[1], s->scissor[2], s->scissor[3]);
+  glPolygonMode(GL_FRONT_AND_BACK, s->pm[0]);
+  if(s->depth) glEnable(GL_DEPTH_TEST);
+  if(s->blend) glEnable(GL_BLEND);
+  if(s->scissorTest) glEnable(GL_SCISSOR_TEST);
+  glUseProgram(s->pId);
+}
+
+/*!\brief passe de normales de heightTex vers normalTex (w x h), limitée
+ * aux texels [rect[0], rect[2]] x [rect[1], rect[3]] si rect est non
+ * nul ; _fbo doit être lié */
+static void normalPass(GLuint heightTex, GLuint normalTex, int w, int h, const int * rect) {
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, normalTex, 0);
+  glViewport(0, 0, w, h);
+  if(rect) {
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(rect[0], rect[1], rect[2] - rect[0] + 1, rect[3] - rect[1] + 1);
+  }
+  glUseProgram(_normalPId);
+  glBindTexture(GL_TEXTURE_2D, heightTex);
+  gl4dgDraw(_quad);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  if(rect)
+    glDisable(GL_SCISSOR_TEST);
+}
+
+/*!\brief génère altitudes et normales pour la graine seed ; reduction
+ * est le rapport d'amplitude entre deux octaves successives. N'attend
+ * pas le GPU : les durées des passes sont relevées par gpuGenReadEnd.
+ * L'état GL modifié est restauré. */
+extern void gpuGen(unsigned int seed, GLfloat reduction) {
+  glstate_t s;
+  GLfloat offset[2];
+  assert(_genPId);
+  passBegin(&s);
+  /* passe 1 : altitudes */
+  glBeginQuery(GL_TIME_ELAPSED, _queries[0]);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _heightTexId, 0);
+  glViewport(0, 0, _w, _h);
+  glUseProgram(_genPId);
+  seedOffset(seed, offset);
+  glUniform2fv(_offsetLoc, 1, offset);
+  glUniform1f(_reductionLoc, reduction);
+  gl4dgDraw(_quad);
+  glEndQuery(GL_TIME_ELAPSED);
+  /* passe 2 : normales */
+  glBeginQuery(GL_TIME_ELAPSED, _queries[1]);
+  normalPass(_heightTexId, _normalTexId, _w, _h, NULL);
+  glEndQuery(GL_TIME_ELAPSED);
+  passEnd(&s);
+}
+
+/*!\brief normales (modèle, encodées dans [0, 1], GL_RGB10_A2) de la
+ * texture d'altitudes heightTex (GL_R32F, w x h) écrites dans
+ * normalTex, en entier ou, si rect est non nul, sur les seuls texels
+ * [rect[0], rect[2]] x [rect[1], rect[3]] (colonnes, lignes incluses).
+ * L'état GL modifié est restauré. */
+extern void gpuGenNormals(GLuint heightTex, GLuint normalTex, int w, int h, const int * rect) {
+  glstate_t s;
+  shared();
+  passBegin(&s);
+  normalPass(heightTex, normalTex, w, h, rect);
+  passEnd(&s);
+}
+
+extern GLuint gpuGenHeightTexture(void) {
+  return _heightTexId;
+}
+
+extern GLuint gpuGenNormalTexture(void) {
+  return _normalTexId;
+}
+
+/*!\brief lance la relecture des altitudes de la dernière génération
+ * dans un pixel pack buffer, sans attendre ; une relecture encore en
+ * cours est remplacée */
+extern void gpuGenReadBegin(void) {
+  GLsizeiptr size = _w * (GLsizeiptr)_h * sizeof(GLfloat);
+  assert(_genPId);
+  if(!_pbo) {
+    glGenBuffers(1, &_pbo);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, _pbo);
+    glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+    resTrack(RES_BUFFER, _pbo, RES_GEN, size);
+  } else
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, _pbo);
+  if(_fence)
+    glDeleteSync(_fence);
+  glPixelStorei(GL_PACK_ALIGNMENT, 4);
+  glBindTexture(GL_TEXTURE_2D, _heightTexId);
+  glGetTexImage(GL_TEXTURE_2D, 0, GL_RED, GL_FLOAT, (GLvoid *)0);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  _fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  glFlush();
+}
+
+/*!\brief fin de la relecture lancée par gpuGenReadBegin : si la copie
+ * est terminée, ou une fois terminée si wait est non nul, altitudes
+ * copiées dans hm->data (w x h flottants, ligne i de la heightMap =
+ * ligne i de la texture) et durées des passes relevées. Retourne 0 sans
+ * relecture en cours ou si elle n'est pas terminée. */
+extern int gpuGenReadEnd(heightmap_t * hm, int wait) {
+  GLsizeiptr size = _w * (GLsizeiptr)_h * sizeof(GLfloat);
+  const GLfloat * src;
+  GLuint64 ns;
+  GLenum status;
+  int i;
+  if(!_fence)
+    return 0;
+  do
+    status = glClientWaitSync(_fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? 1000000000 : 0);
+  while(wait && status == GL_TIMEOUT_EXPIRED);
+  if(status == GL_TIMEOUT_EXPIRED)
+    return 0;
+  glDeleteSync(_fence);
+  _fence = 0;
+  assert(hm->w == _w && hm->h == _h && hm->data);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, _pbo);
+  src = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+  assert(src);
+  memcpy(hm->data, src, size);
+  glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  /* passes antérieures à la barrière : résultats disponibles */
+  for(i = 0; i < 2; i++) {
+    glGetQueryObjectui64v(_queries[i], GL_QUERY_RESULT, &ns);
+    _ms[i] = ns / 1.0e6;
+  }
+  return 1;
+}
+
+/*!\brief durées GPU (ms) des passes d'altitudes et de normales de la
+ * dernière génération relue */
+extern void gpuGenTimes(GLdouble * height, GLdouble * normal) {
+  *height = _ms[0];
+  *normal = _ms[1];
+}
+
+extern void gpuGenFree(void) {
+  if(_fence) {
+    glDeleteSync(_fence);
+    _fence = 0;
+  }
+  resDeleteBuffers(1, &_pbo);
+  _pbo = 0;
+  if(_genPId) {
+    glDeleteQueries(2, _queries);
+    _genPId = 0;
+  }
+  if(_fbo) {
+    glDeleteFramebuffers(1, &_fbo);
+    _fbo = 0;
+  }
+  resDeleteTextures(1, &_heightTexId);
+  resDeleteTextures(1, &_normalTexId);
+  _heightTexId = _normalTexId = 0;
+  if(_quad) {
+    resUntrackGeometry(_quad);
+    gl4dgDelete(_quad);
+    _quad = 0;
+  }
+}
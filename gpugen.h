@@ -0,0 +1,45 @@
+/*!\file gpugen.h
+ *
+ * \brief génération de heightMap sur GPU, en deux passes de rendu :
+ * les altitudes, un fBm de bruit simplex (du backend courant de
+ * noise.h), dans une texture GL_R32F, puis leurs normales (modèle,
+ * encodées dans [0, 1]) dans une texture GL_RGB10_A2. La passe de
+ * normales sert aussi au terrain pour ses propres altitudes
+ * (gpuGenNormals).
+ *
+ * En mode TERRAIN_GRID le terrain copie les deux textures de GPU à GPU
+ * (terrainRefreshTextures). Les altitudes ne sont relues que pour la
+ * heightMap CPU (pyramide min/max, quadtree, picking, altitude de la
+ * caméra), de façon asynchrone : gpuGenReadBegin les copie dans un
+ * pixel pack buffer et pose une barrière, gpuGenReadEnd les recopie
+ * une fois la barrière passée. Les durées GPU des passes, mesurées par
+ * requêtes GL_TIME_ELAPSED, sont relevées à ce moment.
+ *
+ * \author Farès BELHADJ, amsi@ai.univ-paris8.fr
+ * \date October 14 2026
+ */
+#ifndef _GPUGEN_H
+#define _GPUGEN_H
+
+#include "heightmap.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  extern void     gpuGenInit(const heightmap_t * hm);
+  extern void     gpuGenRebuild(void);
+  extern void     gpuGen(unsigned int seed, GLfloat reduction);
+  extern void     gpuGenNormals(GLuint heightTex, GLuint normalTex, int w, int h, const int * rect);
+  extern GLuint   gpuGenHeightTexture(void);
+  extern GLuint   gpuGenNormalTexture(void);
+  extern void     gpuGenReadBegin(void);
+  extern int      gpuGenReadEnd(heightmap_t * hm, int wait);
+  extern void     gpuGenTimes(GLdouble * height, GLdouble * normal);
+  extern void     gpuGenFree(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
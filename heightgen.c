@@ -0,0 +1,215 @@
+/*!\file heightgen.c
+ *
+ * \brief génération de heightMap par diamond-square multithreadée,
+ * cf. heightgen.h.
+ *
+ * La grille de travail est carrée, de côté n = 2^k + 1 couvrant w x h ;
+ * le résultat en est le coin supérieur gauche. Les boucles internes
+ * (une ligne d'un niveau) sont sans branchement ni dépendance entre
+ * itérations afin d'être vectorisées par le compilateur (-O3), hachage
+ * compris.
+ *
+ * \author Farès BELHADJ, amsi@ai.univ-paris8.fr
+ * \date October 14 2026
+ */
+#include "heightgen.h"
+#include <SDL.h>
+#include <float.h>
+#include <assert.h>
+
+/*!\brief nombre maximal de threads d'une passe */
+#define HEIGHTGEN_MAX_THREADS 64
+/*!\brief nombre de sommets en deçà duquel une passe reste séquentielle */
+#define HEIGHTGEN_MIN_WORK (1 << 14)
+
+typedef struct pass_t pass_t;
+typedef struct slice_t slice_t;
+
+/*!\brief une passe : traitement indépendant de nrows lignes */
+struct pass_t {
+  void (*row)(const pass_t * p, slice_t * s, int k);
+  GLfloat * d;
+  int n, step, half;
+  GLfloat amp;
+  unsigned int seed;
+  /* normalisation et recadrage du résultat */
+  GLfloat * out;
+  int w;
+  GLfloat vmin, scale;
+};
+
+/*!\brief part d'une passe confiée à un thread : lignes [k0, k1[ et
+ * extrema rencontrés */
+struct slice_t {
+  const pass_t * p;
+  int k0, k1;
+  GLfloat vmin, vmax;
+};
+
+/*!\brief déplacement pseudo-aléatoire dans [-1, 1[ du sommet (x, y),
+ * fonction de la seule graine (hachage entier à la lowbias32) */
+static inline GLfloat rnd(unsigned int seed, unsigned int x, unsigned int y) {
+  unsigned int h = seed ^ (x * 0x9E3779B1u) ^ (y * 0x85EBCA77u);
+  h ^= h >> 16; h *= 0x7FEB352Du;
+  h ^= h >> 15; h *= 0x846CA68Bu;
+  h ^= h >> 16;
+  return (GLfloat)(h >> 8) * (2.0f / 16777216.0f) - 1.0f;
+}
+
+/*!\brief étape diamond, ligne y = half + k step : centre de chaque
+ * carré = moyenne de ses 4 coins + déplacement */
+static void diamondRow(const pass_t * p, slice_t * s, int k) {
+  int i, n = p->n, half = p->half, step = p->step, m = (n - 1) / step;
+  int y = half + k * step;
+  const GLfloat * up = p->d + (y - half) * n, * down = p->d + (y + half) * n;
+  GLfloat * row = p->d + y * n;
+  (void)s;
+  for(i = 0; i < m; i++) {
+    int x = half + i * step;
+    row[x] = 0.25f * (up[x - half] + up[x + half] + down[x - half] + down[x + half]) +
+      p->amp * rnd(p->seed, x, y);
+  }
+}
+
+/*!\brief étape square, ligne y = k half : milieu de chaque arête =
+ * moyenne de ses voisins (3 sur les bords, 4 sinon) + déplacement */
+static void squareRow(const pass_t * p, slice_t * s, int k) {
+  int i, n = p->n, half = p->half, step = p->step, m = (n - 1) / step;
+  int y = k * half;
+  GLfloat * row = p->d + y * n;
+  const GLfloat * up, * down;
+  (void)s;
+  if(y == 0 || y == n - 1) {
+    /* lignes du bord : arêtes horizontales, un seul voisin vertical */
+    const GLfloat * o = y ? row - half * n : row + half * n;
+    for(i = 0; i < m; i++) {
+      int x = half + i * step;
+      row[x] = (row[x - half] + row[x + half] + o[x]) * (1.0f / 3.0f) + p->amp * rnd(p->seed, x, y);
+    }
+    return;
+  }
+  up = row - half * n;
+  down = row + half * n;
+  if(k & 1) {
+    /* ligne médiane des carrés : arêtes verticales, x = 0, step, ..., n - 1 */
+    row[0] = (up[0] + down[0] + row[half]) * (1.0f / 3.0f) + p->amp * rnd(p->seed, 0, y);
+    for(i = 1; i < m; i++) {
+      int x = i * step;
+      row[x] = 0.25f * (up[x] + down[x] + row[x - half] + row[x + half]) + p->amp * rnd(p->seed, x, y);
+    }
+    row[n - 1] = (up[n - 1] + down[n - 1] + row[n - 1 - half]) * (1.0f / 3.0f) + p->amp * rnd(p->seed, n - 1, y);
+  } else {
+    /* ligne des coins : arêtes horizontales, x = half, half + step, ... */
+    for(i = 0; i < m; i++) {
+      int x = half + i * step;
+      row[x] = 0.25f * (up[x] + down[x] + row[x - half] + row[x + half]) + p->amp * rnd(p->seed, x, y);
+    }
+  }
+}
+
+/*!\brief extrema de la ligne k de la zone recadrée */
+static void boundsRow(const pass_t * p, slice_t * s, int k) {
+  int x;
+  const GLfloat * row = p->d + k * p->n;
+  GLfloat vmin = s->vmin, vmax = s->vmax;
+  for(x = 0; x < p->w; x++) {
+    vmin = row[x] < vmin ? row[x] : vmin;
+    vmax = row[x] > vmax ? row[x] : vmax;
+  }
+  s->vmin = vmin;
+  s->vmax = vmax;
+}
+
+/*!\brief normalisation dans [0, 1] et recopie de la ligne k dans le
+ * résultat (éventuellement en place) */
+static void normalizeRow(const pass_t * p, slice_t * s, int k) {
+  int x;
+  const GLfloat * row = p->d + k * p->n;
+  GLfloat * out = p->out + k * p->w;
+  (void)s;
+  for(x = 0; x < p->w; x++)
+    out[x] = (row[x] - p->vmin) * p->scale;
+}
+
+static int sliceRun(void * data) {
+  int k;
+  slice_t * s = data;
+  for(k = s->k0; k < s->k1; k++)
+    s->p->row(s->p, s, k);
+  return 0;
+}
+
+/*!\brief exécute la passe p sur nrows lignes de width sommets en les
+ * répartissant sur nthreads threads ; s reçoit les parts (au plus
+ * HEIGHTGEN_MAX_THREADS), retourne le nombre de parts utilisées */
+static int runPass(const pass_t * p, slice_t * s, int nrows, int width, int nthreads) {
+  int i;
+  SDL_Thread * th[HEIGHTGEN_MAX_THREADS];
+  if((long)nrows * width < HEIGHTGEN_MIN_WORK)
+    nthreads = 1;
+  if(nthreads > nrows)
+    nthreads = nrows;
+  for(i = 0; i < nthreads; i++) {
+    s[i].p = p;
+    s[i].k0 = (int)((long)nrows * i / nthreads);
+    s[i].k1 = (int)((long)nrows * (i + 1) / nthreads);
+    s[i].vmin = FLT_MAX;
+    s[i].vmax = -FLT_MAX;
+  }
+  for(i = 1; i < nthreads; i++)
+    if(!(th[i] = SDL_CreateThread(sliceRun, "heightgen", &s[i])))
+      sliceRun(&s[i]);
+  sliceRun(&s[0]);
+  for(i = 1; i < nthreads; i++)
+    if(th[i])
+      SDL_WaitThread(th[i], NULL);
+  return nthreads;
+}
+
+extern GLfloat * heightGen(int w, int h, GLfloat reduction, unsigned int seed, int nthreads) {
+  int i, n, ns;
+  GLfloat vmin, vmax;
+  slice_t s[HEIGHTGEN_MAX_THREADS];
+  pass_t p;
+  assert(w > 1 && h > 1);
+  if(nthreads <= 0)
+    nthreads = SDL_GetCPUCount();
+  if(nthreads > HEIGHTGEN_MAX_THREADS)
+    nthreads = HEIGHTGEN_MAX_THREADS;
+  for(n = 2; n + 1 < w || n + 1 < h; n <<= 1);
+  n++;
+  p.d = malloc(n * (size_t)n * sizeof *p.d); assert(p.d);
+  p.n = n;
+  p.seed = seed;
+  p.d[0] = rnd(seed, 0, 0);
+  p.d[n - 1] = rnd(seed, n - 1, 0);
+  p.d[(n - 1) * n] = rnd(seed, 0, n - 1);
+  p.d[n * n - 1] = rnd(seed, n - 1, n - 1);
+  for(p.step = n - 1, p.amp = reduction; p.step > 1; p.step >>= 1, p.amp *= reduction) {
+    p.half = p.step >> 1;
+    p.row = diamondRow;
+    runPass(&p, s, (n - 1) / p.step, (n - 1) / p.step, nthreads);
+    p.row = squareRow;
+    runPass(&p, s, (n - 1) / p.half + 1, (n - 1) / p.step + 1, nthreads);
+  }
+  /* normalisation dans [0, 1] de la zone w x h retenue */
+  p.w = w;
+  p.row = boundsRow;
+  ns = runPass(&p, s, h, w, nthreads);
+  for(i = 0, vmin = FLT_MAX, vmax = -FLT_MAX; i < ns; i++) {
+    vmin = s[i].vmin < vmin ? s[i].vmin : vmin;
+    vmax = s[i].vmax > vmax ? s[i].vmax : vmax;
+  }
+  p.vmin = vmin;
+  p.scale = vmax > vmin ? 1.0f / (vmax - vmin) : 0.0f;
+  /* en place : la ligne k du résultat ne recouvre que des lignes <= k
+   * de la grille, déjà lues si les lignes sont traitées dans l'ordre */
+  p.out = p.d;
+  p.row = normalizeRow;
+  runPass(&p, s, h, w, w == n ? nthreads : 1);
+  if(w != n || h != n) {
+    p.d = realloc(p.d, w * (size_t)h * sizeof *p.d);
+    assert(p.d);
+  }
+  return p.d;
+}
@@ -0,0 +1,35 @@
+/*!\file heightgen.h
+ *
+ * \brief génération de heightMap par déplacement du point milieu
+ * (diamond-square), multithreadée et reproductible.
+ *
+ * Chaque niveau de subdivision (étape diamond puis étape square) est
+ * réparti par paquets de lignes sur plusieurs threads. Le déplacement
+ * aléatoire d'un sommet est un hachage de (graine, x, y) et non un
+ * tirage séquentiel : le résultat ne dépend que de la graine, ni du
+ * nombre de threads ni de l'ordre d'exécution.
+ *
+ * \author Farès BELHADJ, amsi@ai.univ-paris8.fr
+ * \date October 14 2026
+ */
+#ifndef _HEIGHTGEN_H
+#define _HEIGHTGEN_H
+
+#include <GL4D/gl4dummies.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  /*!\brief génère et retourne (à libérer par free) une heightMap de
+   * w x h altitudes normalisées dans [0, 1] ; l'amplitude des
+   * déplacements est multipliée par reduction à chaque niveau (même
+   * sens que pour gl4dmTriangleEdge). nthreads <= 0 utilise tous les
+   * cœurs disponibles. */
+  extern GLfloat * heightGen(int w, int h, GLfloat reduction, unsigned int seed, int nthreads);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,128 @@
+/*!\file heightmap.c
+ *
+ * \brief requêtes d'altitude et de normale sur une heightMap, cf.
+ * heightmap.h.
+ *
+ * Le calcul d'un point est sans branchement (sélections arithmétiques
+ * du triangle, du bord et de l'extérieur de la carte) et les normales
+ * sont écrites en tableaux séparés nx, ny, nz : les deux boucles de
+ * heightmapQuery (altitudes seules, altitudes et normales) sont ainsi
+ * vectorisées en SSE par le compilateur avec les options du Makefile
+ * (-O3, -fno-math-errno pour sqrtf), les lectures de la heightMap
+ * devenant des chargements scalaires regroupés, ou des gathers là où le
+ * jeu d'instructions en dispose.
+ *
+ * \author Farès BELHADJ, amsi@ai.univ-paris8.fr
+ * \date October 14 2026
+ */
+#include "heightmap.h"
+#include <math.h>
+
+/*!\brief copie locale des champs de la heightMap : le compilateur les
+ * sait ainsi invariants dans les boucles, malgré les écritures des
+ * résultats */
+typedef struct hmview_t hmview_t;
+struct hmview_t {
+  const GLfloat * data;
+  int w, h;
+  GLfloat scale_xz, scale_y;
+};
+
+/*!\brief altitude (monde) et, si onx est non nul, normale (monde)
+ * (*onx, *ony, *onz) de la surface en (x, z) (monde) ; 0 et (0, 1, 0)
+ * hors de la carte */
+static inline GLfloat query(const hmview_t * hm, GLfloat x, GLfloat z,
+                            GLfloat * onx, GLfloat * ony, GLfloat * onz) {
+  const GLfloat * d = hm->data;
+  int w = hm->w, i, j, k;
+  GLfloat u, v, uc, vc, in, lower, fx, fz, h00, h01, h10, h11, hx, hz, ha, hb, nx, nz, l;
+  /* position en échantillons : colonne u, ligne v */
+  u = (x / hm->scale_xz + 1.0f) * 0.5f * (w - 1);
+  v = (1.0f - z / hm->scale_xz) * 0.5f * (hm->h - 1);
+  in = (GLfloat)((u >= 0.0f) & (v >= 0.0f) & (u <= w - 1) & (v <= hm->h - 1));
+  /* quad contenant le point, le dernier pour les bords max */
+  uc = u < 0.0f ? 0.0f : u; uc = uc > w - 2 ? w - 2 : uc;
+  vc = v < 0.0f ? 0.0f : v; vc = vc > hm->h - 2 ? hm->h - 2 : vc;
+  j = (int)uc;
+  i = (int)vc;
+  fx = u - j;
+  fz = v - i;
+  k = i * w + j;
+  /* triangle (i, j), (i, j + 1), (i + 1, j) ou son opposé : les deux
+   * sont évalués puis mélangés par lower (0 ou 1), les branches
+   * empêchant la vectorisation */
+  h00 = d[k]; h01 = d[k + 1]; h10 = d[k + w]; h11 = d[k + w + 1];
+  lower = (GLfloat)(fx + fz <= 1.0f);
+  ha = h00 + fx * (h01 - h00) + fz * (h10 - h00);
+  hb = h11 - (1.0f - fx) * (h11 - h10) - (1.0f - fz) * (h11 - h01);
+  if(onx) {
+    hx = (h11 - h10) + lower * ((h01 - h00) - (h11 - h10));
+    hz = (h11 - h01) + lower * ((h10 - h00) - (h11 - h01));
+    /* (-dy/dx, 1, -dy/dz), z décroissant quand la ligne croît */
+    nx = -in * hx * hm->scale_y * (w - 1) / hm->scale_xz;
+    nz =  in * hz * hm->scale_y * (hm->h - 1) / hm->scale_xz;
+    l = 1.0f / sqrtf(nx * nx + 1.0f + nz * nz);
+    *onx = nx * l;
+    *ony = l;
+    *onz = nz * l;
+  }
+  return in * (2.0f * (hb + lower * (ha - hb)) - 1.0f) * hm->scale_y;
+}
+
+static inline hmview_t view(const heightmap_t * hm) {
+  hmview_t v = { hm->data, hm->w, hm->h, hm->scale_xz, hm->scale_y };
+  return v;
+}
+
+extern GLfloat heightmapAltitude(const heightmap_t * hm, GLfloat x, GLfloat z) {
+  hmview_t v = view(hm);
+  return query(&v, x, z, NULL, NULL, NULL);
+}
+
+/*!\brief altitudes y[k] et, si nx est non nul, normales (nx[k],
+ * ny[k], nz[k]) des n points (x[k], z[k]) (monde). Les normales sont
+ * rendues en tableaux séparés : des écritures entrelacées (x, y, z)
+ * empêchent la vectorisation de la boucle sans AVX2. */
+extern void heightmapQuery(const heightmap_t * hm, int n, const GLfloat * restrict x, const GLfloat * restrict z,
+                           GLfloat * restrict y, GLfloat * restrict nx, GLfloat * restrict ny, GLfloat * restrict nz) {
+  int k;
+  const hmview_t v = view(hm);
+  if(nx)
+    for(k = 0; k < n; k++)
+      y[k] = query(&v, x[k], z[k], &nx[k], &ny[k], &nz[k]);
+  else
+    for(k = 0; k < n; k++)
+      y[k] = query(&v, x[k], z[k], NULL, NULL, NULL);
+}
+
+/*!\brief déformation de la carte autour de (x, z) (monde) : chaque
+ * échantillon à distance d < radius (monde) est élevé (amount > 0) ou
+ * creusé (amount < 0) de amount (1 - (d / radius)^2)^2 (monde), borné à
+ * [0, 1]. Le rectangle des échantillons modifiés, colonnes x0, x1 et
+ * lignes z0, z1 incluses, est écrit dans rect ; retourne 0 si
+ * l'empreinte ne touche pas la carte. Coût proportionnel à l'empreinte. */
+extern int heightmapBrush(heightmap_t * hm, GLfloat x, GLfloat z, GLfloat radius, GLfloat amount, int rect[4]) {
+  int i, j, x0, z0, x1, z1, w = hm->w;
+  GLfloat u, v, ru, rv, du, dv, d, f, k = amount / (2.0f * hm->scale_y);
+  /* centre et rayons en échantillons : colonne u, ligne v */
+  u = (x / hm->scale_xz + 1.0f) * 0.5f * (w - 1);
+  v = (1.0f - z / hm->scale_xz) * 0.5f * (hm->h - 1);
+  ru = radius / hm->scale_xz * 0.5f * (w - 1);
+  rv = radius / hm->scale_xz * 0.5f * (hm->h - 1);
+  x0 = (int)ceilf(u - ru); x0 = x0 < 0 ? 0 : x0;
+  z0 = (int)ceilf(v - rv); z0 = z0 < 0 ? 0 : z0;
+  x1 = (int)floorf(u + ru); x1 = x1 > w - 1 ? w - 1 : x1;
+  z1 = (int)floorf(v + rv); z1 = z1 > hm->h - 1 ? hm->h - 1 : z1;
+  if(ru <= 0.0f || rv <= 0.0f || x0 > x1 || z0 > z1)
+    return 0;
+  for(i = z0; i <= z1; i++)
+    for(j = x0; j <= x1; j++) {
+      du = (j - u) / ru; dv = (i - v) / rv;
+      if((d = du * du + dv * dv) >= 1.0f)
+        continue;
+      f = hm->data[i * w + j] + k * (1.0f - d) * (1.0f - d);
+      hm->data[i * w + j] = f < 0.0f ? 0.0f : (f > 1.0f ? 1.0f : f);
+    }
+  rect[0] = x0; rect[1] = z0; rect[2] = x1; rect[3] = z1;
+  return 1;
+}
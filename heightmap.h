@@ -0,0 +1,49 @@
+/*!\file heightmap.h
+ *
+ * \brief description d'une heightMap et de sa mise à l'échelle dans
+ * le monde.
+ *
+ * Le sommet (i, j) (ligne i, colonne j) de la heightMap est placé, en
+ * coordonnées modèle, en x = -1 + 2 j / (w - 1), z = 1 - 2 i / (h - 1)
+ * et y = 2 data[i * w + j] - 1 ; le passage au monde applique scale_xz
+ * en x et z et scale_y en y.
+ *
+ * Les requêtes d'altitude interpolent dans le triangle du maillage
+ * pleine résolution qui contient le point (diagonale de (i, j + 1) à
+ * (i + 1, j), comme terrain.c) : altitude et normale exactes de la
+ * surface dessinée au niveau le plus fin.
+ *
+ * heightmapBrush déforme la carte sous une empreinte circulaire
+ * (cratère, sculpture) et rend le rectangle d'échantillons modifiés, à
+ * transmettre à terrainDirty.
+ *
+ * \author Farès BELHADJ, amsi@ai.univ-paris8.fr
+ * \date October 14 2026
+ */
+#ifndef _HEIGHTMAP_H
+#define _HEIGHTMAP_H
+
+#include <GL4D/gl4dummies.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  typedef struct heightmap_t heightmap_t;
+  /*!\brief une heightMap de w x h altitudes dans [0, 1] */
+  struct heightmap_t {
+    int w, h;
+    GLfloat * data;
+    GLfloat scale_xz, scale_y;
+  };
+
+  extern GLfloat heightmapAltitude(const heightmap_t * hm, GLfloat x, GLfloat z);
+  extern void    heightmapQuery(const heightmap_t * hm, int n, const GLfloat * x, const GLfloat * z,
+                                GLfloat * y, GLfloat * nx, GLfloat * ny, GLfloat * nz);
+  extern int     heightmapBrush(heightmap_t * hm, GLfloat x, GLfloat z, GLfloat radius, GLfloat amount, int rect[4]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
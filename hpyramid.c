@@ -0,0 +1,243 @@
+/*!\file hpyramid.c
+ *
+ * \brief pyramide min/max d'une heightMap et lancer de rayon
+ * hiérarchique, cf. hpyramid.h.
+ *
+ * Le rayon est exprimé dans l'espace des échantillons (colonne u,
+ * ligne v, altitude dans [0, 1]), image affine de l'espace monde : le
+ * paramètre t d'un point du rayon y est le même.
+ *
+ * \author Farès BELHADJ, amsi@ai.univ-paris8.fr
+ * \date October 14 2026
+ */
+#include "hpyramid.h"
+#include <stdlib.h>
+#include <math.h>
+#include <assert.h>
+
+/*!\brief tolérance (en paramètre et en fraction de quad) des tests
+ * d'intersection, pour ne pas perdre un rayon passant sur une arête */
+#define EPSILON 1e-4f
+
+typedef struct ray_t ray_t;
+/*!\brief rayon dans l'espace des échantillons : origine et direction
+ * (u, v, altitude) */
+struct ray_t {
+  GLfloat o[3], d[3];
+};
+
+extern hpyramid_t * hpyramidNew(const heightmap_t * hm) {
+  int l, w = hm->w - 1, h = hm->h - 1;
+  hpyramid_t * p = malloc(sizeof *p);
+  assert(p && w > 0 && h > 0);
+  p->hm = *hm;
+  for(p->levels = 1; w > 1 || h > 1; p->levels++) {
+    w = (w + 1) >> 1;
+    h = (h + 1) >> 1;
+  }
+  p->w = malloc(p->levels * sizeof *p->w);
+  p->h = malloc(p->levels * sizeof *p->h);
+  p->min = malloc(p->levels * sizeof *p->min);
+  p->max = malloc(p->levels * sizeof *p->max);
+  assert(p->w && p->h && p->min && p->max);
+  for(l = 0, w = hm->w - 1, h = hm->h - 1; l < p->levels; l++, w = (w + 1) >> 1, h = (h + 1) >> 1) {
+    p->w[l] = w;
+    p->h[l] = h;
+    p->min[l] = malloc(w * h * sizeof *p->min[l]);
+    p->max[l] = malloc(w * h * sizeof *p->max[l]);
+    assert(p->min[l] && p->max[l]);
+  }
+  hpyramidUpdate(p);
+  return p;
+}
+
+/*!\brief recalcul de la pyramide après modification des altitudes de
+ * la heightMap */
+extern void hpyramidUpdate(hpyramid_t * p) {
+  hpyramidUpdateRect(p, 0, 0, p->hm.h - 1, p->hm.w - 1);
+}
+
+/*!\brief recalcul des seules cellules couvrant les échantillons
+ * modifiés [i0, i1] x [j0, j1] (lignes, colonnes, bornes incluses) et
+ * de leurs ancêtres : proportionnel à la région et non à la carte */
+extern void hpyramidUpdateRect(hpyramid_t * p, int i0, int j0, int i1, int j1) {
+  int l, i, j, c, ci, cj, W = p->hm.w, k;
+  const GLfloat * d = p->hm.data;
+  GLfloat a, b, lo, hi;
+  /* un échantillon est un coin des quads (i - 1, j - 1) à (i, j) */
+  i0 = i0 > 0 ? i0 - 1 : 0; j0 = j0 > 0 ? j0 - 1 : 0;
+  i1 = i1 < p->h[0] - 1 ? i1 : p->h[0] - 1;
+  j1 = j1 < p->w[0] - 1 ? j1 : p->w[0] - 1;
+  /* niveau 0 : les 4 coins de chaque quad */
+  for(i = i0; i <= i1; i++)
+    for(j = j0; j <= j1; j++) {
+      k = i * W + j;
+      a = d[k] < d[k + 1] ? d[k] : d[k + 1];
+      b = d[k + W] < d[k + W + 1] ? d[k + W] : d[k + W + 1];
+      p->min[0][i * p->w[0] + j] = a < b ? a : b;
+      a = d[k] > d[k + 1] ? d[k] : d[k + 1];
+      b = d[k + W] > d[k + W + 1] ? d[k + W] : d[k + W + 1];
+      p->max[0][i * p->w[0] + j] = a > b ? a : b;
+    }
+  /* niveaux suivants : les 4 cellules filles, ou celles qui existent */
+  for(l = 1; l < p->levels; l++) {
+    i0 >>= 1; j0 >>= 1; i1 >>= 1; j1 >>= 1;
+    for(i = i0; i <= i1; i++)
+      for(j = j0; j <= j1; j++) {
+        for(c = 0, lo = HUGE_VALF, hi = -HUGE_VALF; c < 4; c++) {
+          ci = 2 * i + (c >> 1);
+          cj = 2 * j + (c & 1);
+          if(ci >= p->h[l - 1] || cj >= p->w[l - 1])
+            continue;
+          k = ci * p->w[l - 1] + cj;
+          if(p->min[l - 1][k] < lo) lo = p->min[l - 1][k];
+          if(p->max[l - 1][k] > hi) hi = p->max[l - 1][k];
+        }
+        p->min[l][i * p->w[l] + j] = lo;
+        p->max[l][i * p->w[l] + j] = hi;
+      }
+  }
+}
+
+/*!\brief altitudes minimale et maximale ([0, 1]) de la cellule (i, j)
+ * du niveau level ; HUGE_VALF et -HUGE_VALF hors de la carte. Au-delà
+ * du dernier niveau, seule la cellule (0, 0) existe et couvre toute la
+ * carte. */
+extern void hpyramidCell(const hpyramid_t * p, int level, int i, int j, GLfloat * min, GLfloat * max) {
+  if(level >= p->levels) {
+    level = p->levels - 1;
+    i = i || j ? p->h[level] : 0;
+  }
+  if(i >= p->h[level] || j >= p->w[level]) {
+    *min = HUGE_VALF;
+    *max = -HUGE_VALF;
+    return;
+  }
+  *min = p->min[level][i * p->w[level] + j];
+  *max = p->max[level][i * p->w[level] + j];
+}
+
+/*!\brief restriction de [*t0, *t1] à la traversée par r de l'emprise de
+ * la cellule (i, j) du niveau level. Retourne 0 si elle est vide. */
+static int slab(const hpyramid_t * p, const ray_t * r, int level, int i, int j, GLfloat * t0, GLfloat * t1) {
+  int a;
+  GLfloat lo[2], hi[2], ta, tb, s;
+  lo[0] = (GLfloat)(j << level);
+  hi[0] = (GLfloat)((j + 1) << level < p->hm.w - 1 ? (j + 1) << level : p->hm.w - 1);
+  lo[1] = (GLfloat)(i << level);
+  hi[1] = (GLfloat)((i + 1) << level < p->hm.h - 1 ? (i + 1) << level : p->hm.h - 1);
+  for(a = 0; a < 2; a++) {
+    if(r->d[a] == 0.0f) {
+      if(r->o[a] < lo[a] || r->o[a] > hi[a])
+        return 0;
+      continue;
+    }
+    ta = (lo[a] - r->o[a]) / r->d[a];
+    tb = (hi[a] - r->o[a]) / r->d[a];
+    if(ta > tb) { s = ta; ta = tb; tb = s; }
+    if(ta > *t0) *t0 = ta;
+    if(tb < *t1) *t1 = tb;
+  }
+  return *t0 <= *t1;
+}
+
+/*!\brief intersection de r, pour t dans [t0, t1], avec les deux
+ * triangles du quad (i, j) */
+static int triangles(const hpyramid_t * p, const ray_t * r, int i, int j, GLfloat t0, GLfloat t1, GLfloat * t) {
+  int W = p->hm.w, k = i * W + j, hit = 0;
+  const GLfloat * d = p->hm.data;
+  GLfloat ou = r->o[0] - j, ov = r->o[1] - i, g0, g1, s, fx, fz, x, z;
+  GLfloat h00 = d[k], h01 = d[k + 1], h10 = d[k + W], h11 = d[k + W + 1];
+  /* triangle (i, j), (i, j + 1), (i + 1, j) : h = h00 + fx x + fz z,
+   * fx + fz <= 1 ; on annule l'écart linéaire g0 + s g1 entre le rayon
+   * et le plan */
+  x = h01 - h00; z = h10 - h00;
+  g0 = r->o[2] - h00 - ou * x - ov * z;
+  g1 = r->d[2] - r->d[0] * x - r->d[1] * z;
+  if(g1 != 0.0f && (s = -g0 / g1) >= t0 - EPSILON && s <= t1 + EPSILON) {
+    fx = ou + s * r->d[0]; fz = ov + s * r->d[1];
+    if(fx + fz <= 1.0f + EPSILON) {
+      *t = s;
+      hit = 1;
+    }
+  }
+  /* triangle opposé : h = h11 - (1 - fx) x - (1 - fz) z, fx + fz >= 1 */
+  x = h11 - h10; z = h11 - h01;
+  g0 = r->o[2] - (h11 - x - z) - ou * x - ov * z;
+  g1 = r->d[2] - r->d[0] * x - r->d[1] * z;
+  if(g1 != 0.0f && (s = -g0 / g1) >= t0 - EPSILON && s <= t1 + EPSILON && (!hit || s < *t)) {
+    fx = ou + s * r->d[0]; fz = ov + s * r->d[1];
+    if(fx + fz >= 1.0f - EPSILON) {
+      *t = s;
+      hit = 1;
+    }
+  }
+  return hit;
+}
+
+/*!\brief première intersection de r avec le relief de la cellule (i,
+ * j) du niveau level, traversée pour t dans [t0, t1] */
+static int cast(const hpyramid_t * p, const ray_t * r, int level, int i, int j, GLfloat t0, GLfloat t1, GLfloat * t) {
+  int c, n, k, ci[4], cj[4], o[4];
+  GLfloat ha, hb, c0[4], c1[4];
+  /* le rayon passe-t-il au-dessus de tout le relief de la cellule ? */
+  ha = r->o[2] + t0 * r->d[2];
+  hb = r->o[2] + t1 * r->d[2];
+  if((ha < hb ? ha : hb) > p->max[level][i * p->w[level] + j])
+    return 0;
+  if(level == 0)
+    return triangles(p, r, i, j, t0, t1, t);
+  /* filles traversées, triées par paramètre d'entrée */
+  for(c = 0, n = 0; c < 4; c++) {
+    ci[n] = 2 * i + (c >> 1);
+    cj[n] = 2 * j + (c & 1);
+    c0[n] = t0; c1[n] = t1;
+    if(ci[n] >= p->h[level - 1] || cj[n] >= p->w[level - 1] ||
+       !slab(p, r, level - 1, ci[n], cj[n], &c0[n], &c1[n]))
+      continue;
+    for(k = n; k > 0 && c0[o[k - 1]] > c0[n]; k--)
+      o[k] = o[k - 1];
+    o[k] = n++;
+  }
+  for(k = 0; k < n; k++)
+    if(cast(p, r, level - 1, ci[o[k]], cj[o[k]], c0[o[k]], c1[o[k]], t))
+      return 1;
+  return 0;
+}
+
+/*!\brief première intersection du rayon origin + t dir (monde), t dans
+ * [0, tmax], avec le relief ; retourne 1 et t en cas d'impact */
+extern int hpyramidRaycast(const hpyramid_t * p, const GLfloat origin[3], const GLfloat dir[3],
+                           GLfloat tmax, GLfloat * t) {
+  ray_t r;
+  const heightmap_t * hm = &p->hm;
+  GLfloat t0 = 0.0f, t1 = tmax, su = 0.5f * (hm->w - 1) / hm->scale_xz, sv = 0.5f * (hm->h - 1) / hm->scale_xz;
+  r.o[0] = (origin[0] / hm->scale_xz + 1.0f) * 0.5f * (hm->w - 1);
+  r.o[1] = (1.0f - origin[2] / hm->scale_xz) * 0.5f * (hm->h - 1);
+  r.o[2] = 0.5f * (origin[1] / hm->scale_y + 1.0f);
+  r.d[0] = dir[0] * su;
+  r.d[1] = -dir[2] * sv;
+  r.d[2] = 0.5f * dir[1] / hm->scale_y;
+  if(!slab(p, &r, p->levels - 1, 0, 0, &t0, &t1))
+    return 0;
+  return cast(p, &r, p->levels - 1, 0, 0, t0, t1, t);
+}
+
+/*!\brief le segment [a, b] (monde) est-il libre de relief ? */
+extern int hpyramidVisible(const hpyramid_t * p, const GLfloat a[3], const GLfloat b[3]) {
+  GLfloat d[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] }, t;
+  return !hpyramidRaycast(p, a, d, 1.0f - EPSILON, &t);
+}
+
+extern void hpyramidDelete(hpyramid_t * p) {
+  int l;
+  for(l = 0; l < p->levels; l++) {
+    free(p->min[l]);
+    free(p->max[l]);
+  }
+  free(p->min);
+  free(p->max);
+  free(p->w);
+  free(p->h);
+  free(p);
+}
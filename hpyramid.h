@@ -0,0 +1,52 @@
+/*!\file hpyramid.h
+ *
+ * \brief pyramide (quadtree complet) des altitudes minimales et
+ * maximales d'une heightMap, et lancer de rayon hiérarchique.
+ *
+ * Au niveau 0, la cellule (i, j) est le quad d'échantillons (i, j) à
+ * (i + 1, j + 1), bornes incluses ; au niveau l, elle couvre les 2^l x
+ * 2^l quads de ses 4 cellules filles. Un rayon n'est raffiné que dans
+ * les cellules qu'il traverse sous leur altitude maximale : un rayon
+ * qui passe au-dessus du relief ne visite que O(log n) cellules par
+ * région survolée. Au niveau 0, l'intersection est exacte avec les
+ * deux triangles du quad (diagonale de (i, j + 1) à (i + 1, j), comme
+ * terrain.c).
+ *
+ * \author Farès BELHADJ, amsi@ai.univ-paris8.fr
+ * \date October 14 2026
+ */
+#ifndef _HPYRAMID_H
+#define _HPYRAMID_H
+
+#include "heightmap.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  typedef struct hpyramid_t hpyramid_t;
+  /*!\brief pyramide min/max : niveau l de w[l] x h[l] cellules,
+   * altitudes dans [0, 1] comme la heightMap ; hm en est une copie,
+   * dont data peut être remplacé (mêmes dimensions) avant
+   * hpyramidUpdate */
+  struct hpyramid_t {
+    heightmap_t hm;
+    int levels;
+    int * w, * h;
+    GLfloat ** min, ** max;
+  };
+
+  extern hpyramid_t * hpyramidNew(const heightmap_t * hm);
+  extern void         hpyramidUpdate(hpyramid_t * p);
+  extern void         hpyramidUpdateRect(hpyramid_t * p, int i0, int j0, int i1, int j1);
+  extern void         hpyramidCell(const hpyramid_t * p, int level, int i, int j, GLfloat * min, GLfloat * max);
+  extern int          hpyramidRaycast(const hpyramid_t * p, const GLfloat origin[3], const GLfloat dir[3],
+                                      GLfloat tmax, GLfloat * t);
+  extern int          hpyramidVisible(const hpyramid_t * p, const GLfloat a[3], const GLfloat b[3]);
+  extern void         hpyramidDelete(hpyramid_t * p);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
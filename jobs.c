@@ -0,0 +1,150 @@
+/*!\file jobs.c
+ *
+ * \brief pool de threads de travail, cf. jobs.h. File FIFO protégée
+ * par un mutex, threads endormis sur une variable de condition quand
+ * elle est vide ; une seconde variable réveille jobsWait à chaque tâche
+ * terminée.
+ *
+ * \author Farès BELHADJ, amsi@ai.univ-paris8.fr
+ * \date October 14 2026
+ */
+#include "jobs.h"
+#include <stdlib.h>
+#include <assert.h>
+
+/*!\brief nombre maximal de threads du pool */
+#define JOBS_MAX_THREADS 64
+
+typedef struct job_t job_t;
+/*!\brief tâche en attente */
+struct job_t {
+  void (*run)(void *);
+  void * arg;
+  SDL_atomic_t * pending;
+  job_t * next;
+};
+
+static SDL_Thread * _threads[JOBS_MAX_THREADS];
+static int _nthreads = 0;
+static SDL_mutex * _mutex = NULL;
+static SDL_cond * _cond = NULL, * _done = NULL;
+/*!\brief tête et queue de la file */
+static job_t * _head = NULL, * _tail = NULL;
+static int _quit = 0;
+
+/*!\brief exécution de j, mutex tenu à l'entrée comme à la sortie */
+static void run(job_t * j) {
+  SDL_UnlockMutex(_mutex);
+  j->run(j->arg);
+  if(j->pending)
+    SDL_AtomicAdd(j->pending, -1);
+  free(j);
+  SDL_LockMutex(_mutex);
+  SDL_CondBroadcast(_done);
+}
+
+static int worker(void * data) {
+  job_t * j;
+  (void)data;
+  SDL_LockMutex(_mutex);
+  for(;;) {
+    while(!_head && !_quit)
+      SDL_CondWait(_cond, _mutex);
+    if(!_head)
+      break;
+    j = _head;
+    if(!(_head = j->next))
+      _tail = NULL;
+    run(j);
+  }
+  SDL_UnlockMutex(_mutex);
+  return 0;
+}
+
+/*!\brief démarrage de nthreads threads de travail ; nthreads <= 0
+ * laisse un cœur au thread de rendu (au moins un thread) */
+extern void jobsInit(int nthreads) {
+  if(_nthreads)
+    return;
+  if(nthreads <= 0)
+    nthreads = SDL_GetCPUCount() - 1;
+  nthreads = nthreads < 1 ? 1 : (nthreads > JOBS_MAX_THREADS ? JOBS_MAX_THREADS : nthreads);
+  _mutex = SDL_CreateMutex();
+  _cond = SDL_CreateCond();
+  _done = SDL_CreateCond();
+  assert(_mutex && _cond && _done);
+  _quit = 0;
+  for(_nthreads = 0; _nthreads < nthreads; _nthreads++)
+    if(!(_threads[_nthreads] = SDL_CreateThread(worker, "jobs", NULL)))
+      break;
+  assert(_nthreads > 0);
+}
+
+/*!\brief dépôt de la tâche run(arg) ; si pending est non nul, il est
+ * incrémenté ici et décrémenté une fois la tâche terminée */
+extern void jobsPush(void (*run)(void *), void * arg, SDL_atomic_t * pending) {
+  job_t * j = malloc(sizeof *j);
+  assert(j && _nthreads);
+  j->run = run;
+  j->arg = arg;
+  j->pending = pending;
+  j->next = NULL;
+  if(pending)
+    SDL_AtomicAdd(pending, 1);
+  SDL_LockMutex(_mutex);
+  if(_tail)
+    _tail->next = j;
+  else
+    _head = j;
+  _tail = j;
+  SDL_CondSignal(_cond);
+  SDL_UnlockMutex(_mutex);
+}
+
+/*!\brief attente de la fin des tâches comptées par pending : celles
+ * encore en file sont retirées et exécutées par l'appelant, dans
+ * l'ordre, puis il dort jusqu'à la fin de celles déjà commencées (et
+ * de celles qu'elles déposent à leur tour) */
+extern void jobsWait(SDL_atomic_t * pending) {
+  job_t * j, * prev;
+  SDL_LockMutex(_mutex);
+  while(SDL_AtomicGet(pending)) {
+    for(prev = NULL, j = _head; j && j->pending != pending; prev = j, j = j->next);
+    if(!j) {
+      SDL_CondWait(_done, _mutex);
+      continue;
+    }
+    if(prev)
+      prev->next = j->next;
+    else
+      _head = j->next;
+    if(_tail == j)
+      _tail = prev;
+    run(j);
+  }
+  SDL_UnlockMutex(_mutex);
+}
+
+/*!\brief nombre de threads de travail démarrés */
+extern int jobsCount(void) {
+  return _nthreads;
+}
+
+/*!\brief arrêt des threads une fois la file vidée */
+extern void jobsFree(void) {
+  int i;
+  if(!_nthreads)
+    return;
+  SDL_LockMutex(_mutex);
+  _quit = 1;
+  SDL_CondBroadcast(_cond);
+  SDL_UnlockMutex(_mutex);
+  for(i = 0; i < _nthreads; i++)
+    SDL_WaitThread(_threads[i], NULL);
+  _nthreads = 0;
+  SDL_DestroyCond(_cond);
+  SDL_DestroyCond(_done);
+  SDL_DestroyMutex(_mutex);
+  _cond = _done = NULL;
+  _mutex = NULL;
+}
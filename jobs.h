@@ -0,0 +1,32 @@
+/*!\file jobs.h
+ *
+ * \brief pool de threads de travail : des tâches indépendantes sont
+ * exécutées en arrière-plan dans l'ordre de leur dépôt, le thread de
+ * rendu suivant leur avancement par un compteur atomique sans jamais
+ * les attendre, sauf jobsWait pour les tâches de la frame : il exécute
+ * lui-même celles qui sont encore en file plutôt que de rester
+ * inactif.
+ *
+ * \author Farès BELHADJ, amsi@ai.univ-paris8.fr
+ * \date October 14 2026
+ */
+#ifndef _JOBS_H
+#define _JOBS_H
+
+#include <SDL.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  extern void jobsInit(int nthreads);
+  extern void jobsPush(void (*run)(void *), void * arg, SDL_atomic_t * pending);
+  extern void jobsWait(SDL_atomic_t * pending);
+  extern int  jobsCount(void);
+  extern void jobsFree(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
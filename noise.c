@@ -1,14 +1,36 @@
-/*!\file window.c
+/*!\file noise.c
  *
  * \brief Bruit de Perlin appliqué en GPU. Nécessite la préparation de
  * données et envoi sous forme de texture.
  * \author Farès BELHADJ, amsi@ai.univ-paris8.fr 
  * \date March 3 2017
  */
-#include <GL4D/gl4dummies.h>
+#include "noise.h"
+#include "variant.h"
+#include "resources.h"
+#include <GL4D/gl4du.h>
+#include <GL4D/gl4dg.h>
+#include <SDL.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
 #include <assert.h>
 
-static GLuint permTexId = 0, gradTexId = 0;
+static GLuint permTexId = 0, gradTexId = 0, volumeTexId = 0;
+/*!\brief poignées résidentes des mêmes textures, nulles sans
+ * GL_ARB_bindless_texture */
+static GLuint64 permHandle = 0, gradHandle = 0, volumeHandle = 0;
+static PFNGLGETTEXTUREHANDLEARBPROC _getTextureHandle = NULL;
+static PFNGLMAKETEXTUREHANDLERESIDENTARBPROC _makeResident = NULL;
+static PFNGLMAKETEXTUREHANDLENONRESIDENTARBPROC _makeNonResident = NULL;
+static PFNGLUNIFORMHANDLEUI64ARBPROC _uniformHandle = NULL;
+/*!\brief backend des programmes construits par noiseProgram */
+static int _backend = NOISE_DEFAULT_BACKEND;
+/*!\brief source du shader objet et nom de chaque backend */
+static const char * _shaders[NOISE_BACKENDS] = {
+  "shaders/noise.fs", "shaders/noisealu.fs", "shaders/noisevolume.fs"
+};
+static const char * _names[NOISE_BACKENDS] = { "textures", "ALU", "volume" };
 
 static int perm[256]= { 151, 160, 137, 91, 90, 15, 
 			131, 13, 201, 95, 96, 53, 194, 233, 7, 225, 140, 36, 103, 30, 69, 142, 8, 99, 37, 240, 21, 10, 23, 
@@ -38,75 +60,279 @@ static int grad4[32][4] = { { 0,  1, 1, 1}, { 0,  1,  1, -1}, { 0,  1, -1, 1}, {
 			    { 1,  1, 1, 0}, { 1,  1, -1,  0}, { 1, -1,  1, 0}, { 1, -1, -1,  0}, 
 			    {-1,  1, 1, 0}, {-1,  1, -1,  0}, {-1, -1,  1, 0}, {-1, -1, -1,  0} };
 
-extern void initNoiseTextures(void) {
-  int i, j, k, i8;
-  GLubyte * buffer, v;
+/*!\brief l'extension name est-elle disponible ? */
+static int hasExtension(const char * name) {
+  GLint i, n = 0;
+  glGetIntegerv(GL_NUM_EXTENSIONS, &n);
+  for(i = 0; i < n; i++)
+    if(!strcmp((const char *)glGetStringi(GL_EXTENSIONS, i), name))
+      return 1;
+  return 0;
+}
 
-  if(permTexId || gradTexId)
-    return;
+/*!\brief poignée résidente (GL_ARB_bindless_texture) de la texture id,
+ * 0 sans l'extension */
+static GLuint64 residentHandle(GLuint id) {
+  GLuint64 handle;
+  if(!_getTextureHandle)
+    return 0;
+  handle = _getTextureHandle(id);
+  _makeResident(handle);
+  return handle;
+}
 
-  buffer = malloc( (1 << 18)/* 4 * 256 * 256 */ * sizeof *buffer); assert(buffer);
-
-  for(i = 0; i < 256; i++) {
-    i8 = i << 8;
-    for(j = 0; j < 256; j++) {
-      k = (i8 + j) << 2;
-      v = perm[(j + perm[i]) & 0xFF];
-      buffer[k + 0] = (grad4[v & 0x1F][0] << 6) + 64;
-      buffer[k + 1] = (grad4[v & 0x1F][1] << 6) + 64;
-      buffer[k + 2] = (grad4[v & 0x1F][2] << 6) + 64;
-      buffer[k + 3] = (grad4[v & 0x1F][3] << 6) + 64;
-    }
+/*!\brief texture 256 x 256 du texel (j, i) = row[(j + perm[i]) & 0xFF] :
+ * chaque ligne est une rotation de row, copiée en deux morceaux, liée
+ * une fois pour toutes à l'unité unit */
+static GLuint rotatedTexture(const GLubyte row[256][4], int unit) {
+  GLubyte * buffer = malloc(256 * 256 * sizeof *row), * line;
+  GLuint id;
+  int i, r;
+  assert(buffer);
+  for(i = 0, line = buffer; i < 256; i++, line += 256 * sizeof *row) {
+    r = perm[i];
+    memcpy(line, row[r], (256 - r) * sizeof *row);
+    memcpy(line + (256 - r) * sizeof *row, row[0], r * sizeof *row);
   }
-  glActiveTexture(GL_TEXTURE2);
-  glGenTextures(1, &gradTexId);
-  glBindTexture(GL_TEXTURE_2D, gradTexId);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-  glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA, 256, 256, 0, GL_RGBA, GL_UNSIGNED_BYTE, buffer );
-
-  for(i = 0; i < 256; i++) {
-    i8 = i << 8;
-    for(j = 0; j < 256; j++) {
-      k = (i8 + j) << 2;
-      buffer[k + 3] = (v = perm[(j + perm[i]) & 0xFF]);
-      buffer[k + 0] = (grad3[v & 0x0F][0] << 6) + 64;
-      buffer[k + 1] = (grad3[v & 0x0F][1] << 6) + 64;
-      buffer[k + 2] = (grad3[v & 0x0F][2] << 6) + 64;
-    }
-  }
-  glActiveTexture(GL_TEXTURE1);
-  glGenTextures(1, &permTexId);
-  glBindTexture(GL_TEXTURE_2D, permTexId);
+  glActiveTexture(GL_TEXTURE0 + unit);
+  glGenTextures(1, &id);
+  glBindTexture(GL_TEXTURE_2D, id);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
   glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 256, 256, 0, GL_RGBA, GL_UNSIGNED_BYTE, buffer);
   glActiveTexture(GL_TEXTURE0);
-
+  resTrack(RES_TEXTURE, id, RES_NOISE, 256 * 256 * sizeof *row);
   free(buffer);
+  return id;
+}
+
+/*!\brief textures de NOISE_TEXTURE, liées à leurs unités réservées ou,
+ * avec GL_ARB_bindless_texture, rendues résidentes. Le texel (j, i) ne
+ * dépend que de v = perm[(j + perm[i]) & 0xFF] : une seule ligne de 256
+ * texels (gradients de perm[k]) est calculée, les autres en sont des
+ * rotations. */
+extern void initNoiseTextures(void) {
+  GLubyte grad[256][4], perm3[256][4];
+  int k, c, v;
+
+  if(permTexId || gradTexId)
+    return;
+  if(hasExtension("GL_ARB_bindless_texture")) {
+    _getTextureHandle = (PFNGLGETTEXTUREHANDLEARBPROC)SDL_GL_GetProcAddress("glGetTextureHandleARB");
+    _makeResident = (PFNGLMAKETEXTUREHANDLERESIDENTARBPROC)SDL_GL_GetProcAddress("glMakeTextureHandleResidentARB");
+    _makeNonResident = (PFNGLMAKETEXTUREHANDLENONRESIDENTARBPROC)SDL_GL_GetProcAddress("glMakeTextureHandleNonResidentARB");
+    _uniformHandle = (PFNGLUNIFORMHANDLEUI64ARBPROC)SDL_GL_GetProcAddress("glUniformHandleui64ARB");
+    if(!_getTextureHandle || !_makeResident || !_makeNonResident || !_uniformHandle)
+      _getTextureHandle = NULL;
+  }
+  for(k = 0; k < 256; k++) {
+    v = perm[k];
+    for(c = 0; c < 4; c++)
+      grad[k][c] = (grad4[v & 0x1F][c] << 6) + 64;
+    for(c = 0; c < 3; c++)
+      perm3[k][c] = (grad3[v & 0x0F][c] << 6) + 64;
+    perm3[k][3] = v;
+  }
+  gradTexId = rotatedTexture((const GLubyte (*)[4])grad, NOISE_GRAD_UNIT);
+  permTexId = rotatedTexture((const GLubyte (*)[4])perm3, NOISE_PERM_UNIT);
+  gradHandle = residentHandle(gradTexId);
+  permHandle = residentHandle(permTexId);
+  setNoiseBackend(_backend);
+}
+
+static GLfloat fade(GLfloat t) {
+  return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f);
+}
+
+/*!\brief contribution du gradient du coin (x, y, z), coordonnées
+ * réduites à la période de la texture 3D */
+static GLfloat corner(int x, int y, int z, GLfloat dx, GLfloat dy, GLfloat dz) {
+  const int p = NOISE_VOLUME_PERIOD - 1, * g;
+  g = grad3[perm[(perm[(perm[x & p] + (y & p)) & 0xFF] + (z & p)) & 0xFF] & 0x0F];
+  return g[0] * dx + g[1] * dy + g[2] * dz;
+}
+
+/*!\brief bruit classique (mêmes gradients que permTexture) de période
+ * NOISE_VOLUME_PERIOD en chaque dimension */
+static GLfloat periodicNoise(GLfloat x, GLfloat y, GLfloat z) {
+  int i = (int)floorf(x), j = (int)floorf(y), k = (int)floorf(z), c;
+  GLfloat fx = x - i, fy = y - j, fz = z - k, n[8], u = fade(fx), v = fade(fy), w = fade(fz);
+  for(c = 0; c < 8; c++)
+    n[c] = corner(i + (c & 1), j + ((c >> 1) & 1), k + (c >> 2),
+                  fx - (c & 1), fy - ((c >> 1) & 1), fz - (c >> 2));
+  for(c = 0; c < 4; c++)
+    n[c] = n[c] + w * (n[c + 4] - n[c]);
+  n[0] += v * (n[2] - n[0]);
+  n[1] += v * (n[3] - n[1]);
+  return n[0] + u * (n[1] - n[0]);
 }
 
-extern void useNoiseTextures(GLuint pid, int shift) {
-  glActiveTexture(GL_TEXTURE1 + shift);
-  glBindTexture(GL_TEXTURE_2D, gradTexId);
-  glActiveTexture(GL_TEXTURE0 + shift);
-  glBindTexture(GL_TEXTURE_2D, permTexId);
-  glUniform1i(glGetUniformLocation(pid, "permTexture"), shift);
-  glUniform1i(glGetUniformLocation(pid, "gradTexture"), shift + 1);
+/*!\brief texture 3D de NOISE_VOLUME : le texel (i, j, k) est le bruit au
+ * centre du texel, la lecture se répète (GL_REPEAT) avec la période */
+static void initVolume(void) {
+  int i, j, k;
+  const GLfloat s = NOISE_VOLUME_PERIOD / (GLfloat)NOISE_VOLUME_SIZE;
+  GLfloat * buffer = malloc(NOISE_VOLUME_SIZE * NOISE_VOLUME_SIZE * NOISE_VOLUME_SIZE * sizeof *buffer), * v = buffer;
+  assert(buffer);
+  for(k = 0; k < NOISE_VOLUME_SIZE; k++)
+    for(j = 0; j < NOISE_VOLUME_SIZE; j++)
+      for(i = 0; i < NOISE_VOLUME_SIZE; i++)
+        *v++ = periodicNoise((i + 0.5f) * s, (j + 0.5f) * s, (k + 0.5f) * s);
+  glActiveTexture(GL_TEXTURE0 + NOISE_VOLUME_UNIT);
+  glGenTextures(1, &volumeTexId);
+  glBindTexture(GL_TEXTURE_3D, volumeTexId);
+  glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_REPEAT);
+  glTexImage3D(GL_TEXTURE_3D, 0, GL_R16F, NOISE_VOLUME_SIZE, NOISE_VOLUME_SIZE, NOISE_VOLUME_SIZE, 0,
+               GL_RED, GL_FLOAT, buffer);
   glActiveTexture(GL_TEXTURE0);
+  resTrack(RES_TEXTURE, volumeTexId, RES_NOISE, 2 * NOISE_VOLUME_SIZE * NOISE_VOLUME_SIZE * NOISE_VOLUME_SIZE);
+  volumeHandle = residentHandle(volumeTexId);
+  free(buffer);
 }
 
-extern void unuseNoiseTextures(int shift) {
-  glActiveTexture(GL_TEXTURE1 + shift);
-  glBindTexture(GL_TEXTURE_2D, 0);
-  glActiveTexture(GL_TEXTURE0 + shift);
+/*!\brief backend des prochains programmes construits par noiseProgram
+ * (noise_backend_t) ; la texture 3D n'est calculée qu'au premier
+ * besoin */
+extern void setNoiseBackend(int backend) {
+  _backend = backend;
+  if(backend == NOISE_VOLUME && !volumeTexId)
+    initVolume();
+}
+
+extern int noiseBackend(void) {
+  return _backend;
+}
+
+extern const char * noiseBackendName(int backend) {
+  return _names[backend];
+}
+
+/*!\brief variante (cf. variant.h) des shaders vs et fs, compilés
+ * avec defines et NOISE_BACKEND (et NOISE_BINDLESS si les textures sont
+ * résidentes), liés au bruit du backend courant dont les samplers sont
+ * fixés une fois pour toutes (cf. setNoiseUniforms) : aucune liaison
+ * n'est à faire autour des dessins. Changer de backend puis revenir ne
+ * recompile rien. */
+extern GLuint noiseProgram(const char * defines, const char * vs, const char * fs) {
+  char d[256], n[64];
+  GLuint id;
+  snprintf(d, sizeof d, "NOISE_BACKEND=%d%s %s", _backend, _getTextureHandle ? " NOISE_BINDLESS" : "", defines);
+  snprintf(n, sizeof n, "<fs>%s", _shaders[_backend]);
+  if((id = variantProgram(d, vs, n, fs, NULL)))
+    setNoiseUniforms(id);
+  return id;
+}
+
+/*!\brief comme noiseProgram, avec des étages de tessellation : le
+ * bruit est lié à l'étage d'évaluation tes (compilé avec NOISE_TESS)
+ * et non au fragment shader */
+extern GLuint noiseTessProgram(const char * defines, const char * vs, const char * tcs, const char * tes, const char * fs) {
+  char d[256], n[64];
+  GLuint id;
+  snprintf(d, sizeof d, "NOISE_BACKEND=%d%s NOISE_TESS %s", _backend, _getTextureHandle ? " NOISE_BINDLESS" : "", defines);
+  snprintf(n, sizeof n, "<tes>%s", _shaders[_backend]);
+  if((id = variantProgram(d, vs, tcs, tes, n, fs, NULL)))
+    setNoiseUniforms(id);
+  return id;
+}
+
+/*!\brief sampler name de pid : poignée handle si elle existe, unité
+ * unit sinon */
+static void sampler(GLuint pid, const char * name, GLuint64 handle, int unit) {
+  GLint loc = glGetUniformLocation(pid, name);
+  if(loc < 0)
+    return;
+  if(handle)
+    _uniformHandle(loc, handle);
+  else
+    glUniform1i(loc, unit);
+}
+
+/*!\brief associe, une fois après sa création, les samplers
+ * permTexture, gradTexture et noiseVolume du programme pid à leurs
+ * textures : poignées résidentes ou unités réservées NOISE_*_UNIT ;
+ * laisse pid actif */
+extern void setNoiseUniforms(GLuint pid) {
+  glUseProgram(pid);
+  sampler(pid, "permTexture", permHandle, NOISE_PERM_UNIT);
+  sampler(pid, "gradTexture", gradHandle, NOISE_GRAD_UNIT);
+  sampler(pid, "noiseVolume", volumeHandle, NOISE_VOLUME_UNIT);
+}
+
+/*!\brief mesure, pour chaque backend, de la durée GPU (GL_TIME_ELAPSED)
+ * de frames rendus plein écran de size x size pixels de
+ * shaders/noisebench.fs (8 appels à noise(vec3) et 8 à snoise(vec2) par
+ * pixel), affichée en ns par pixel. Attend le GPU ; l'état GL modifié
+ * et le backend courant sont restaurés. */
+extern void noiseBenchmark(int size, int frames) {
+  static GLuint quad = 0;
+  GLint vp[4], pId, pm[2], fb;
+  GLboolean depth, blend;
+  GLuint fbo, tex, query, pid;
+  GLuint64 ns;
+  int b, i, backend = _backend;
+  if(!quad) {
+    quad = gl4dgGenQuadf();
+    resTrackGeometry(quad, RES_NOISE);
+  }
+  glGetIntegerv(GL_VIEWPORT, vp);
+  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &fb);
+  glGetIntegerv(GL_CURRENT_PROGRAM, &pId);
+  glGetIntegerv(GL_POLYGON_MODE, pm);
+  depth = glIsEnabled(GL_DEPTH_TEST);
+  blend = glIsEnabled(GL_BLEND);
+  glDisable(GL_DEPTH_TEST);
+  glDisable(GL_BLEND);
+  glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+  glGenTextures(1, &tex);
+  glBindTexture(GL_TEXTURE_2D, tex);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, size, size, 0, GL_RED, GL_FLOAT, NULL);
   glBindTexture(GL_TEXTURE_2D, 0);
-  glActiveTexture(GL_TEXTURE0);
+  resTrack(RES_TEXTURE, tex, RES_NOISE, 4 * (size_t)size * size);
+  glGenFramebuffers(1, &fbo);
+  glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, tex, 0);
+  glViewport(0, 0, size, size);
+  glGenQueries(1, &query);
+  for(b = 0; b < NOISE_BACKENDS; b++) {
+    setNoiseBackend(b);
+    pid = noiseProgram("", "<vs>shaders/water.vs", "<fs>shaders/noisebench.fs");
+    glUseProgram(pid);
+    /* une passe à vide : compilation différée du pilote */
+    gl4dgDraw(quad);
+    glBeginQuery(GL_TIME_ELAPSED, query);
+    for(i = 0; i < frames; i++)
+      gl4dgDraw(quad);
+    glEndQuery(GL_TIME_ELAPSED);
+    glGetQueryObjectui64v(query, GL_QUERY_RESULT, &ns);
+    fprintf(stderr, "bruit %-8s : %.3f ns/pixel (%.3f ns par appel)\n", _names[b],
+            ns / ((GLdouble)frames * size * size), ns / ((GLdouble)frames * size * size * 16));
+  }
+  setNoiseBackend(backend);
+  glDeleteQueries(1, &query);
+  glBindFramebuffer(GL_FRAMEBUFFER, fb);
+  glDeleteFramebuffers(1, &fbo);
+  resDeleteTextures(1, &tex);
+  glViewport(vp[0], vp[1], vp[2], vp[3]);
+  glPolygonMode(GL_FRONT_AND_BACK, pm[0]);
+  if(depth) glEnable(GL_DEPTH_TEST);
+  if(blend) glEnable(GL_BLEND);
+  glUseProgram(pId);
 }
 
 extern void freeNoiseTextures(void) {
-  glDeleteTextures(1, &gradTexId);
-  glDeleteTextures(1, &permTexId);
-  permTexId = 0; gradTexId = 0;
+  if(permHandle) _makeNonResident(permHandle);
+  if(gradHandle) _makeNonResident(gradHandle);
+  if(volumeHandle) _makeNonResident(volumeHandle);
+  permHandle = gradHandle = volumeHandle = 0;
+  resDeleteTextures(1, &gradTexId);
+  resDeleteTextures(1, &permTexId);
+  resDeleteTextures(1, &volumeTexId);
+  permTexId = 0; gradTexId = 0; volumeTexId = 0;
 }
 
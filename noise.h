@@ -0,0 +1,79 @@
+/*!\file noise.h
+ *
+ * \brief bruits de Perlin (classique) et simplex des shaders, avec
+ * trois backends interchangeables fournissant les mêmes fonctions GLSL
+ * (float noise(vec3), float snoise(vec2)) :
+ * - NOISE_TEXTURE : implémentation de Gustavson (shaders/noise.fs),
+ *   permutations et gradients lus dans deux textures 256 x 256 ;
+ * - NOISE_ALU : hachage par permutation polynomiale, sans aucune
+ *   lecture de texture (shaders/noisealu.fs) ;
+ * - NOISE_VOLUME : bruit classique précalculé dans une texture 3D
+ *   périodique filtrée en trilinéaire (shaders/noisevolume.fs), une
+ *   lecture par appel au prix des détails plus fins qu'un quart de
+ *   période.
+ *
+ * Le backend est celui du shader objet lié aux programmes qui utilisent
+ * le bruit (noiseProgram, ou noiseTessProgram pour l'étage
+ * d'évaluation de tessellation, qui en fait une variante de variant.h
+ * définissant aussi NOISE_BACKEND) ; NOISE_DEFAULT_BACKEND fixe celui du
+ * démarrage (par exemple -DNOISE_DEFAULT_BACKEND=NOISE_ALU) et
+ * setNoiseBackend en change, les programmes concernés devant alors être
+ * reconstruits. noiseBenchmark mesure chacun sur le GPU courant.
+ *
+ * Les textures sont construites une fois (une ligne de 256 texels, les
+ * autres en étant des rotations) et liées une fois pour toutes aux
+ * unités réservées NOISE_*_UNIT ; si GL_ARB_bindless_texture est
+ * disponible, elles sont rendues résidentes et les samplers reçoivent
+ * leurs poignées (shaders compilés avec NOISE_BINDLESS). Dans les deux
+ * cas les programmes de noiseProgram dessinent sans aucune liaison.
+ *
+ * \author Farès BELHADJ, amsi@ai.univ-paris8.fr
+ * \date October 14 2026
+ */
+#ifndef _NOISE_H
+#define _NOISE_H
+
+#include <GL4D/gl4dummies.h>
+
+/*!\brief backends de bruit */
+enum noise_backend_t {
+  NOISE_TEXTURE = 0,
+  NOISE_ALU,
+  NOISE_VOLUME,
+  NOISE_BACKENDS
+};
+
+#ifndef NOISE_DEFAULT_BACKEND
+#  define NOISE_DEFAULT_BACKEND NOISE_TEXTURE
+#endif
+
+/*!\brief côté (texels) et période (unités de bruit) de la texture 3D
+ * de NOISE_VOLUME */
+#define NOISE_VOLUME_SIZE 128
+#define NOISE_VOLUME_PERIOD 32
+
+/*!\brief unités de texture réservées aux textures de bruit, hors de
+ * celles des autres passes (0 à WATERPASS_UNIT) */
+#define NOISE_PERM_UNIT 6
+#define NOISE_GRAD_UNIT 7
+#define NOISE_VOLUME_UNIT 8
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  extern void         initNoiseTextures(void);
+  extern void         setNoiseBackend(int backend);
+  extern int          noiseBackend(void);
+  extern const char * noiseBackendName(int backend);
+  extern GLuint       noiseProgram(const char * defines, const char * vs, const char * fs);
+  extern GLuint       noiseTessProgram(const char * defines, const char * vs, const char * tcs, const char * tes, const char * fs);
+  extern void         setNoiseUniforms(GLuint pid);
+  extern void         noiseBenchmark(int size, int frames);
+  extern void         freeNoiseTextures(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,276 @@
+/*!\file profiler.c
+ *
+ * \brief profileur de frames à requêtes GPU différées, cf. profiler.h.
+ *
+ * \author Farès BELHADJ, amsi@ai.univ-paris8.fr
+ * \date October 14 2026
+ */
+#include "profiler.h"
+#include <SDL.h>
+#include <string.h>
+
+/*!\brief indice de la frame entière dans les tableaux par phase */
+#define FRAME PROF_PHASES
+
+typedef struct pslot_t pslot_t;
+/*!\brief mesures d'une frame en attente de leurs résultats GPU */
+struct pslot_t {
+  unsigned int frame;
+  int pending;
+  int used[PROF_PHASES + 1];
+  Uint64 cpu[PROF_PHASES + 1][2];     /* début et fin (compteur SDL) */
+  GLuint queries[PROF_PHASES + 1][2]; /* GL_TIMESTAMP de début et de fin */
+};
+
+static const char * _names[PROF_PHASES + 1];
+static int _nphases = 0;
+static pslot_t _slots[PROF_LATENCY];
+/*!\brief jeu de la frame en cours, NULL hors frame */
+static pslot_t * _cur = NULL;
+static unsigned int _frame = 0;
+/*!\brief durées lissées (ms), négatives tant qu'inconnues */
+static GLdouble _cpu[PROF_PHASES + 1], _gpu[PROF_PHASES + 1];
+/*!\brief enregistrement en cours : fichier, format Chrome trace,
+ * événements déjà écrits et origine des dates */
+static FILE * _out = NULL;
+static int _json = 0, _events = 0;
+static Uint64 _origin = 0;
+/*!\brief requêtes créées */
+static int _ready = 0;
+
+extern void profInit(void) {
+  int i;
+  if(_ready)
+    return;
+  _ready = 1;
+  for(i = 0; i < PROF_LATENCY; i++)
+    glGenQueries(2 * (PROF_PHASES + 1), &_slots[i].queries[0][0]);
+  for(i = 0; i <= PROF_PHASES; i++)
+    _cpu[i] = _gpu[i] = -1.0;
+  _names[FRAME] = "frame";
+  _nphases = 0;
+}
+
+/*!\brief enregistre la phase name (chaîne conservée telle quelle) et
+ * retourne son identifiant, -1 s'il y en a déjà PROF_PHASES */
+extern int profPhase(const char * name) {
+  int i;
+  for(i = 0; i < _nphases; i++)
+    if(!strcmp(_names[i], name))
+      return i;
+  if(_nphases == PROF_PHASES)
+    return -1;
+  _names[_nphases] = name;
+  return _nphases++;
+}
+
+static inline GLdouble ms(Uint64 t) {
+  return t * 1000.0 / SDL_GetPerformanceFrequency();
+}
+
+static void smooth(GLdouble * avg, GLdouble v) {
+  *avg = *avg < 0.0 ? v : *avg + PROF_SMOOTHING * (v - *avg);
+}
+
+/*!\brief écriture d'une mesure : CSV (début et durée relatifs à la
+ * frame, en ms) ou événement complet ("X") de la piste tid, dates en
+ * µs depuis le début de l'enregistrement ; les frames commencées avant
+ * ce début (encore en attente quand profRecord est appelée) sont
+ * ignorées */
+static void record(const pslot_t * s, int p, GLdouble cpu0, GLdouble cpu, GLdouble gpu0, GLdouble gpu) {
+  GLdouble t0;
+  if(s->cpu[FRAME][0] < _origin)
+    return;
+  t0 = ms(s->cpu[FRAME][0] - _origin);
+  if(!_json) {
+    if(gpu < 0.0)
+      fprintf(_out, "%u,%s,%.4f,%.4f,,\n", s->frame, _names[p], cpu0, cpu);
+    else
+      fprintf(_out, "%u,%s,%.4f,%.4f,%.4f,%.4f\n", s->frame, _names[p], cpu0, cpu, gpu0, gpu);
+    return;
+  }
+  fprintf(_out, "%s\n{\"name\":\"%s\",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}",
+          _events++ ? "," : "", _names[p], 1000.0 * (t0 + cpu0), 1000.0 * cpu);
+  /* piste GPU calée sur le début CPU de la frame */
+  if(gpu >= 0.0)
+    fprintf(_out, ",\n{\"name\":\"%s\",\"cat\":\"gpu\",\"ph\":\"X\",\"pid\":1,\"tid\":2,\"ts\":%.3f,\"dur\":%.3f}",
+            _names[p], 1000.0 * (t0 + gpu0), 1000.0 * gpu);
+}
+
+/*!\brief relevé des mesures du jeu s, sans attente : les résultats GPU
+ * sont ignorés si le dernier timestamp de la frame n'est pas prêt (les
+ * précédents le sont alors tous) */
+static void resolve(pslot_t * s) {
+  int p;
+  GLint available = 0;
+  GLuint64 g0, g1, f0 = 0;
+  GLdouble cpu0, cpu, gpu0, gpu;
+  glGetQueryObjectiv(s->queries[FRAME][1], GL_QUERY_RESULT_AVAILABLE, &available);
+  if(available)
+    glGetQueryObjectui64v(s->queries[FRAME][0], GL_QUERY_RESULT, &f0);
+  for(p = 0; p <= FRAME; p++) {
+    if(p == _nphases)
+      p = FRAME;
+    if(!s->used[p])
+      continue;
+    cpu0 = ms(s->cpu[p][0] - s->cpu[FRAME][0]);
+    cpu = ms(s->cpu[p][1] - s->cpu[p][0]);
+    gpu0 = gpu = -1.0;
+    smooth(&_cpu[p], cpu);
+    if(available) {
+      glGetQueryObjectui64v(s->queries[p][0], GL_QUERY_RESULT, &g0);
+      glGetQueryObjectui64v(s->queries[p][1], GL_QUERY_RESULT, &g1);
+      gpu0 = (GLdouble)(g0 - f0) * 1e-6;
+      gpu = (GLdouble)(g1 - g0) * 1e-6;
+      smooth(&_gpu[p], gpu);
+    }
+    if(_out)
+      record(s, p, cpu0, cpu, gpu0, gpu);
+  }
+  s->pending = 0;
+}
+
+/*!\brief début de frame ; relève au passage la frame qui utilisait le
+ * même jeu de requêtes */
+extern void profFrameBegin(void) {
+  pslot_t * s = &_slots[_frame % PROF_LATENCY];
+  if(s->pending)
+    resolve(s);
+  memset(s->used, 0, sizeof s->used);
+  s->frame = _frame;
+  _cur = s;
+  profBegin(FRAME);
+}
+
+/*!\brief début de la phase (identifiant de profPhase) dans la frame
+ * courante, à fermer par profEnd dans la même frame */
+extern void profBegin(int phase) {
+  if(!_cur || phase < 0)
+    return;
+  _cur->used[phase] = 1;
+  _cur->cpu[phase][0] = SDL_GetPerformanceCounter();
+  glQueryCounter(_cur->queries[phase][0], GL_TIMESTAMP);
+}
+
+extern void profEnd(int phase) {
+  if(!_cur || phase < 0 || !_cur->used[phase])
+    return;
+  glQueryCounter(_cur->queries[phase][1], GL_TIMESTAMP);
+  _cur->cpu[phase][1] = SDL_GetPerformanceCounter();
+}
+
+extern void profFrameEnd(void) {
+  if(!_cur)
+    return;
+  profEnd(FRAME);
+  _cur->pending = 1;
+  _cur = NULL;
+  _frame++;
+}
+
+/*!\brief durées lissées (ms) CPU et GPU de la phase, PROF_PHASES pour
+ * la frame entière ; négatives si encore inconnues */
+extern void profTimes(int phase, GLdouble * cpu, GLdouble * gpu) {
+  *cpu = _cpu[phase];
+  *gpu = _gpu[phase];
+}
+
+extern void profPrint(FILE * f) {
+  int p;
+  for(p = 0; p <= FRAME; p++) {
+    if(p == _nphases)
+      p = FRAME;
+    if(_cpu[p] >= 0.0)
+      fprintf(f, "%-16s CPU %7.3f ms, GPU %7.3f ms\n", _names[p], _cpu[p], _gpu[p] < 0.0 ? 0.0 : _gpu[p]);
+  }
+}
+
+/*!\brief rectangle de couleur c, en pixels de la fenêtre */
+static void bar(int x, int y, int w, int h, const GLfloat c[3]) {
+  if(w <= 0)
+    return;
+  glScissor(x, y, w, h);
+  glClearColor(c[0], c[1], c[2], 1.0f);
+  glClear(GL_COLOR_BUFFER_BIT);
+}
+
+/*!\brief barres des durées lissées, de bas en haut à partir de (x, y),
+ * une paire par phase puis pour la frame (CPU au-dessus, GPU plus
+ * sombre au-dessous) ; width pixels valent PROF_OVERLAY_MS, un repère
+ * marque 16.7 ms. Dessinées par glClear limité au scissor : aucun
+ * programme ni tampon, état GL restauré. */
+extern void profOverlay(int x, int y, int width) {
+  static const GLfloat colors[][3] = {
+    {0.9f, 0.3f, 0.3f}, {0.3f, 0.9f, 0.3f}, {0.3f, 0.5f, 1.0f}, {0.9f, 0.9f, 0.3f},
+    {0.9f, 0.3f, 0.9f}, {0.3f, 0.9f, 0.9f}, {1.0f, 0.6f, 0.2f}, {0.7f, 0.7f, 0.7f}
+  };
+  static const GLfloat background[3] = {0.0f, 0.0f, 0.0f}, marker[3] = {1.0f, 1.0f, 1.0f};
+  const int h = 5, row = 2 * h + 4;
+  int p, r = 0;
+  GLfloat cc[4], c[3];
+  GLboolean scissor = glIsEnabled(GL_SCISSOR_TEST);
+  GLint box[4];
+  GLdouble k = width / PROF_OVERLAY_MS;
+  glGetFloatv(GL_COLOR_CLEAR_VALUE, cc);
+  glGetIntegerv(GL_SCISSOR_BOX, box);
+  glEnable(GL_SCISSOR_TEST);
+  bar(x - 2, y - 2, width + 4, (_nphases + 1) * row + 2, background);
+  for(p = 0; p <= FRAME; p++, r++) {
+    const GLfloat * col;
+    if(p == _nphases)
+      p = FRAME;
+    col = p == FRAME ? marker : colors[p % (sizeof colors / sizeof *colors)];
+    bar(x, y + r * row + h, (int)(k * _cpu[p] + 0.5), h, col);
+    c[0] = 0.5f * col[0]; c[1] = 0.5f * col[1]; c[2] = 0.5f * col[2];
+    bar(x, y + r * row, (int)(k * _gpu[p] + 0.5), h, c);
+  }
+  bar(x + (int)(k * 1000.0 / 60.0), y - 2, 1, (_nphases + 1) * row + 2, marker);
+  glScissor(box[0], box[1], box[2], box[3]);
+  if(!scissor)
+    glDisable(GL_SCISSOR_TEST);
+  glClearColor(cc[0], cc[1], cc[2], cc[3]);
+}
+
+/*!\brief débute l'enregistrement frame par frame dans path (Chrome
+ * trace si path se termine par ".json", CSV sinon) ou, path NULL,
+ * termine l'enregistrement en cours. Retourne 0 si path ne peut être
+ * ouvert. */
+extern int profRecord(const char * path) {
+  size_t n;
+  if(_out) {
+    if(_json)
+      fprintf(_out, "\n]}\n");
+    fclose(_out);
+    _out = NULL;
+  }
+  if(!path)
+    return 1;
+  if(!(_out = fopen(path, "w")))
+    return 0;
+  n = strlen(path);
+  _json = n >= 5 && !strcmp(path + n - 5, ".json");
+  _events = 0;
+  _origin = SDL_GetPerformanceCounter();
+  if(_json) {
+    fprintf(_out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+            "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n"
+            "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}");
+    _events = 1;
+  } else
+    fprintf(_out, "frame,phase,cpu_start_ms,cpu_ms,gpu_start_ms,gpu_ms\n");
+  return 1;
+}
+
+extern void profFree(void) {
+  int i;
+  profRecord(NULL);
+  if(!_ready)
+    return;
+  _ready = 0;
+  for(i = 0; i < PROF_LATENCY; i++) {
+    glDeleteQueries(2 * (PROF_PHASES + 1), &_slots[i].queries[0][0]);
+    _slots[i].pending = 0;
+  }
+  _cur = NULL;
+  _nphases = 0;
+}
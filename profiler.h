@@ -0,0 +1,54 @@
+/*!\file profiler.h
+ *
+ * \brief profileur de frames : durée CPU (compteur haute résolution de
+ * SDL) et GPU (paire de requêtes GL_TIMESTAMP) de phases nommées,
+ * éventuellement imbriquées, de chaque frame.
+ *
+ * Les requêtes d'une frame sont relues PROF_LATENCY frames plus tard,
+ * juste avant la réutilisation de leur jeu : aucune lecture n'attend le
+ * GPU et, s'il est en retard de plus de PROF_LATENCY frames, les durées
+ * GPU de la frame sont simplement perdues. Les durées relevées sont
+ * lissées pour l'affichage (profOverlay, profPrint) et peuvent être
+ * enregistrées frame par frame (profRecord) en CSV ou, si le nom du
+ * fichier se termine par ".json", au format Chrome trace (chrome://tracing,
+ * Perfetto) avec une piste CPU et une piste GPU.
+ *
+ * \author Farès BELHADJ, amsi@ai.univ-paris8.fr
+ * \date October 14 2026
+ */
+#ifndef _PROFILER_H
+#define _PROFILER_H
+
+#include <GL4D/gl4dummies.h>
+#include <stdio.h>
+
+/*!\brief nombre maximal de phases */
+#define PROF_PHASES 16
+/*!\brief jeux de requêtes, frames entre une mesure et sa lecture */
+#define PROF_LATENCY 2
+/*!\brief poids de la dernière frame dans les durées lissées */
+#define PROF_SMOOTHING 0.05
+/*!\brief durée (ms) correspondant à toute la largeur de profOverlay */
+#define PROF_OVERLAY_MS 33.3
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  extern void profInit(void);
+  extern int  profPhase(const char * name);
+  extern void profFrameBegin(void);
+  extern void profBegin(int phase);
+  extern void profEnd(int phase);
+  extern void profFrameEnd(void);
+  extern void profTimes(int phase, GLdouble * cpu, GLdouble * gpu);
+  extern void profPrint(FILE * f);
+  extern void profOverlay(int x, int y, int width);
+  extern int  profRecord(const char * path);
+  extern void profFree(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
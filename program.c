@@ -0,0 +1,84 @@
+/*!\file program.c
+ *
+ * \brief descripteurs de programmes GLSL et uniform buffer de l'état
+ * par frame, cf. program.h.
+ *
+ * \author Farès BELHADJ, amsi@ai.univ-paris8.fr
+ * \date October 14 2026
+ */
+#include "program.h"
+#include "vmath.h"
+#include "resources.h"
+
+/*!\brief uniform buffer du bloc frame */
+static GLuint _frameBufferId = 0;
+
+/*!\brief résolution des emplacements des uniformes par draw du
+ * programme id et liaison de son éventuel bloc frame */
+extern void programInit(program_t * p, GLuint id) {
+  GLuint block;
+  p->id = id;
+  p->modelViewMatrix = glGetUniformLocation(id, "modelViewMatrix");
+  p->modelViewProjectionMatrix = glGetUniformLocation(id, "modelViewProjectionMatrix");
+  p->normalMatrix = glGetUniformLocation(id, "normalMatrix");
+  p->skirt = glGetUniformLocation(id, "skirt");
+  p->morph = glGetUniformLocation(id, "morph");
+  p->grid = glGetUniformLocation(id, "grid");
+  p->tess = glGetUniformLocation(id, "tess");
+  p->bounds = glGetUniformLocation(id, "bounds");
+  p->farNear = glGetUniformLocation(id, "farNear");
+  if((block = glGetUniformBlockIndex(id, "frame")) != GL_INVALID_INDEX)
+    glUniformBlockBinding(id, block, PROGRAM_FRAME_BINDING);
+  if((block = glGetUniformBlockIndex(id, "clipmap")) != GL_INVALID_INDEX)
+    glUniformBlockBinding(id, block, PROGRAM_CLIPMAP_BINDING);
+}
+
+/*!\brief associe une fois pour toutes le sampler name du programme à
+ * l'unité de texture unit ; laisse le programme p actif */
+extern void programSampler(const program_t * p, const char * name, int unit) {
+  glUseProgram(p->id);
+  glUniform1i(glGetUniformLocation(p->id, name), unit);
+}
+
+/*!\brief envoi au programme p (courant) de la model-view, de
+ * projection x model-view et de la matrice des normales */
+extern void programMatrices(const program_t * p, const GLfloat * modelView, const GLfloat * projection) {
+  GLfloat mvp[16], n[9];
+  /* matrices rangées par lignes, d'où la transposition à l'envoi */
+  if(p->modelViewMatrix >= 0)
+    glUniformMatrix4fv(p->modelViewMatrix, 1, GL_TRUE, modelView);
+  if(p->modelViewProjectionMatrix >= 0) {
+    mat4Mult(mvp, projection, modelView);
+    glUniformMatrix4fv(p->modelViewProjectionMatrix, 1, GL_TRUE, mvp);
+  }
+  if(p->normalMatrix >= 0) {
+    mat4NormalMatrix(n, modelView);
+    glUniformMatrix3fv(p->normalMatrix, 1, GL_TRUE, n);
+  }
+}
+
+extern void frameInit(void) {
+  if(_frameBufferId)
+    return;
+  glGenBuffers(1, &_frameBufferId);
+  glBindBuffer(GL_UNIFORM_BUFFER, _frameBufferId);
+  glBufferData(GL_UNIFORM_BUFFER, sizeof(frame_t), NULL, GL_DYNAMIC_DRAW);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+  resTrack(RES_BUFFER, _frameBufferId, RES_SHADING, sizeof(frame_t));
+  glBindBufferBase(GL_UNIFORM_BUFFER, PROGRAM_FRAME_BINDING, _frameBufferId);
+}
+
+/*!\brief envoi, une fois par frame, de l'état partagé par tous les
+ * programmes */
+extern void frameUpdate(const frame_t * f) {
+  glBindBuffer(GL_UNIFORM_BUFFER, _frameBufferId);
+  glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof *f, f);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+extern void frameFree(void) {
+  if(_frameBufferId) {
+    resDeleteBuffers(1, &_frameBufferId);
+    _frameBufferId = 0;
+  }
+}
@@ -0,0 +1,67 @@
+/*!\file program.h
+ *
+ * \brief descripteurs de programmes GLSL (emplacements des uniformes
+ * résolus une seule fois après la création du programme) et état par frame
+ * partagé entre programmes via un uniform buffer std140.
+ *
+ * Côté GLSL, le bloc partagé se déclare :
+ * \code
+ * layout(std140, row_major) uniform frame {
+ *   mat4 viewMatrix;
+ *   mat4 projectionMatrix;
+ *   vec4 lumpos;
+ *   float cycle;
+ *   float waterBlend;
+ * };
+ * \endcode
+ *
+ * \author Farès BELHADJ, amsi@ai.univ-paris8.fr
+ * \date October 14 2026
+ */
+#ifndef _PROGRAM_H
+#define _PROGRAM_H
+
+#include <GL4D/gl4dummies.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!\brief point de liaison du bloc frame */
+#define PROGRAM_FRAME_BINDING 0
+/*!\brief point de liaison du bloc clipmap (cf. clipmap.h) */
+#define PROGRAM_CLIPMAP_BINDING 1
+
+  typedef struct program_t program_t;
+  /*!\brief un programme et les emplacements de ses uniformes par draw
+   * (-1 si absents) */
+  struct program_t {
+    GLuint id;
+    GLint modelViewMatrix, modelViewProjectionMatrix, normalMatrix;
+    GLint skirt, morph, grid;
+    GLint tess, bounds;
+    GLint farNear;
+  };
+
+  typedef struct frame_t frame_t;
+  /*!\brief état par frame, disposition std140 du bloc frame ; les
+   * matrices sont rangées par lignes (convention GL4Dummies) */
+  struct frame_t {
+    GLfloat viewMatrix[16];
+    GLfloat projectionMatrix[16];
+    GLfloat lumpos[4];
+    GLfloat cycle, waterBlend, pad[2];
+  };
+
+  extern void programInit(program_t * p, GLuint id);
+  extern void programSampler(const program_t * p, const char * name, int unit);
+  extern void programMatrices(const program_t * p, const GLfloat * modelView, const GLfloat * projection);
+  extern void frameInit(void);
+  extern void frameUpdate(const frame_t * f);
+  extern void frameFree(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
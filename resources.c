@@ -0,0 +1,311 @@
+/*!\file resources.c
+ *
+ * \brief registre des ressources, cf. resources.h.
+ *
+ * \author Farès BELHADJ, amsi@ai.univ-paris8.fr
+ * \date October 14 2026
+ */
+#include "resources.h"
+#include <GL4D/gl4dg.h>
+#include <SDL.h>
+#include <stdlib.h>
+#include <assert.h>
+
+typedef struct rentry_t rentry_t;
+/*!\brief ressource enregistrée, chaînée dans son entrée de la table */
+struct rentry_t {
+  uintptr_t key;
+  int kind, category;
+  size_t bytes;
+  rentry_t * next;
+};
+
+static rentry_t * _table[RES_BUCKETS];
+static size_t _usage[RES_CATEGORIES][RES_MEMORIES], _peak[RES_CATEGORIES][RES_MEMORIES];
+static size_t _total[RES_MEMORIES], _totalPeak[RES_MEMORIES];
+static size_t _budget[RES_CATEGORIES];
+static SDL_mutex * _lock = NULL;
+
+static const char * _names[] = {
+  "terrain", "eau", "bruit", "generation", "couleur", "choix GPU", "heightMaps", "tuiles", "autres"
+};
+_Static_assert(sizeof _names / sizeof *_names == RES_CATEGORIES, "un nom par catégorie");
+
+/*!\brief verrou du registre, sans effet avant resInit (outils hors
+ * ligne) */
+static void lock(void) {
+  if(_lock)
+    SDL_LockMutex(_lock);
+}
+
+static void unlock(void) {
+  if(_lock)
+    SDL_UnlockMutex(_lock);
+}
+
+static inline rentry_t ** bucket(int kind, uintptr_t key) {
+  /* les adresses du tas sont alignées : bits faibles écartés */
+  uintptr_t h = (kind == RES_HEAP ? key >> 4 : key) * 2654435761u + kind;
+  return &_table[(h >> 8) % RES_BUCKETS];
+}
+
+/*!\brief ajout (sign > 0) ou retrait de bytes à l'usage de la
+ * catégorie, dans la mémoire de la nature kind */
+static void account(int kind, int category, size_t bytes, int sign) {
+  int m = kind == RES_HEAP ? RES_CPU : RES_GPU;
+  if(sign > 0) {
+    _usage[category][m] += bytes;
+    _total[m] += bytes;
+  } else {
+    _usage[category][m] -= bytes;
+    _total[m] -= bytes;
+  }
+  if(_usage[category][m] > _peak[category][m])
+    _peak[category][m] = _usage[category][m];
+  if(_total[m] > _totalPeak[m])
+    _totalPeak[m] = _total[m];
+}
+
+extern void resInit(void) {
+  if(!_lock)
+    _lock = SDL_CreateMutex();
+  assert(_lock);
+}
+
+/*!\brief enregistrement de la ressource (kind, key) de bytes octets
+ * dans category, ou nouvelle taille si elle est déjà enregistrée */
+extern void resTrack(int kind, uintptr_t key, int category, size_t bytes) {
+  rentry_t ** b, * e;
+  if(!key)
+    return;
+  lock();
+  b = bucket(kind, key);
+  for(e = *b; e && (e->key != key || e->kind != kind); e = e->next)
+    ;
+  if(e)
+    account(kind, e->category, e->bytes, -1);
+  else {
+    e = malloc(sizeof *e);
+    assert(e);
+    e->key = key;
+    e->kind = kind;
+    e->next = *b;
+    *b = e;
+  }
+  e->category = category;
+  e->bytes = bytes;
+  account(kind, category, bytes, 1);
+  unlock();
+}
+
+/*!\brief oubli de la ressource (kind, key), sans effet si elle n'est
+ * pas enregistrée */
+extern void resUntrack(int kind, uintptr_t key) {
+  rentry_t ** p, * e;
+  lock();
+  for(p = bucket(kind, key); (e = *p) && (e->key != key || e->kind != kind); p = &e->next)
+    ;
+  if(e) {
+    account(kind, e->category, e->bytes, -1);
+    *p = e->next;
+    free(e);
+  }
+  unlock();
+}
+
+extern void resDeleteBuffers(GLsizei n, const GLuint * ids) {
+  GLsizei i;
+  for(i = 0; i < n; i++)
+    resUntrack(RES_BUFFER, ids[i]);
+  glDeleteBuffers(n, ids);
+}
+
+extern void resDeleteTextures(GLsizei n, const GLuint * ids) {
+  GLsizei i;
+  for(i = 0; i < n; i++)
+    resUntrack(RES_TEXTURE, ids[i]);
+  glDeleteTextures(n, ids);
+}
+
+/*!\brief buffers distincts du vertex array de la géométrie GL4Dummies
+ * (attributs 0 à 3 et indices), vao restauré ; retourne leur nombre */
+static int geometryBuffers(GLuint geometry, GLuint ids[5]) {
+  GLint vao, id;
+  int i, k, n = 0;
+  glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &vao);
+  glBindVertexArray(gl4dgGetVAO(geometry));
+  for(i = 0; i < 5; i++) {
+    if(i < 4)
+      glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_BUFFER_BINDING, &id);
+    else
+      glGetIntegerv(GL_ELEMENT_ARRAY_BUFFER_BINDING, &id);
+    for(k = 0; k < n && ids[k] != (GLuint)id; k++)
+      ;
+    if(id && k == n)
+      ids[n++] = id;
+  }
+  glBindVertexArray(vao);
+  return n;
+}
+
+/*!\brief enregistrement des buffers d'une géométrie GL4Dummies
+ * (gl4dgGen*), dont les noms ne sont pas exposés ; tailles lues auprès
+ * du pilote */
+extern void resTrackGeometry(GLuint geometry, int category) {
+  GLuint ids[5];
+  GLint size;
+  int i, n = geometryBuffers(geometry, ids);
+  for(i = 0; i < n; i++) {
+    glBindBuffer(GL_COPY_READ_BUFFER, ids[i]);
+    glGetBufferParameteriv(GL_COPY_READ_BUFFER, GL_BUFFER_SIZE, &size);
+    resTrack(RES_BUFFER, ids[i], category, size);
+  }
+  glBindBuffer(GL_COPY_READ_BUFFER, 0);
+}
+
+/*!\brief oubli des buffers de la géométrie, avant gl4dgDelete */
+extern void resUntrackGeometry(GLuint geometry) {
+  GLuint ids[5];
+  int i, n = geometryBuffers(geometry, ids);
+  for(i = 0; i < n; i++)
+    resUntrack(RES_BUFFER, ids[i]);
+}
+
+/*!\brief octets de la catégorie en mémoire memory (resmem_t),
+ * RES_CATEGORIES pour toutes */
+extern size_t resUsage(int category, int memory) {
+  size_t s;
+  lock();
+  s = category == RES_CATEGORIES ? _total[memory] : _usage[category][memory];
+  unlock();
+  return s;
+}
+
+/*!\brief maximum atteint de resUsage ; pour toutes les catégories,
+ * maximum du total et non somme des maximums */
+extern size_t resPeak(int category, int memory) {
+  size_t s;
+  lock();
+  s = category == RES_CATEGORIES ? _totalPeak[memory] : _peak[category][memory];
+  unlock();
+  return s;
+}
+
+/*!\brief budget (octets, deux mémoires confondues) de la catégorie, 0
+ * pour aucun */
+extern void resSetBudget(int category, size_t bytes) {
+  lock();
+  _budget[category] = bytes;
+  unlock();
+}
+
+extern size_t resBudget(int category) {
+  size_t s;
+  lock();
+  s = _budget[category];
+  unlock();
+  return s;
+}
+
+extern const char * resName(int category) {
+  return category == RES_CATEGORIES ? "total" : _names[category];
+}
+
+/*!\brief usage et maximum par catégorie non vide, budget et
+ * dépassement éventuels, puis totaux */
+extern void resPrint(FILE * f) {
+  const GLdouble M = 1.0 / (1024.0 * 1024.0);
+  int c;
+  lock();
+  for(c = 0; c < RES_CATEGORIES; c++) {
+    if(!_peak[c][RES_GPU] && !_peak[c][RES_CPU])
+      continue;
+    fprintf(f, "%-16s GPU %8.2f Mo (max %8.2f), CPU %8.2f Mo (max %8.2f)", _names[c],
+            _usage[c][RES_GPU] * M, _peak[c][RES_GPU] * M, _usage[c][RES_CPU] * M, _peak[c][RES_CPU] * M);
+    if(_budget[c])
+      fprintf(f, ", budget %.2f Mo%s", _budget[c] * M,
+              _usage[c][RES_GPU] + _usage[c][RES_CPU] > _budget[c] ? " DEPASSE" : "");
+    fprintf(f, "\n");
+  }
+  fprintf(f, "%-16s GPU %8.2f Mo (max %8.2f), CPU %8.2f Mo (max %8.2f)\n", "total",
+          _total[RES_GPU] * M, _totalPeak[RES_GPU] * M, _total[RES_CPU] * M, _totalPeak[RES_CPU] * M);
+  unlock();
+}
+
+/*!\brief rectangle de couleur c, en pixels de la fenêtre */
+static void bar(int x, int y, int w, int h, const GLfloat c[3]) {
+  if(w <= 0)
+    return;
+  glScissor(x, y, w, h);
+  glClearColor(c[0], c[1], c[2], 1.0f);
+  glClear(GL_COLOR_BUFFER_BIT);
+}
+
+/*!\brief barres des usages, de bas en haut à partir de (x, y), une
+ * paire par catégorie (mémoire centrale au-dessus, vidéo plus sombre
+ * au-dessous) ; un repère blanc marque le maximum atteint, un rouge le
+ * budget, et width pixels valent le plus grand des deux toutes
+ * catégories confondues. Même technique que profOverlay : glClear
+ * limité au scissor, état GL restauré. */
+extern void resOverlay(int x, int y, int width) {
+  static const GLfloat colors[][3] = {
+    {0.9f, 0.3f, 0.3f}, {0.3f, 0.9f, 0.3f}, {0.3f, 0.5f, 1.0f}, {0.9f, 0.9f, 0.3f},
+    {0.9f, 0.3f, 0.9f}, {0.3f, 0.9f, 0.9f}, {1.0f, 0.6f, 0.2f}, {0.6f, 0.4f, 1.0f},
+    {0.7f, 0.7f, 0.7f}
+  };
+  /* une couleur par catégorie : une catégorie ajoutée sans couleur ne
+   * compile pas */
+  _Static_assert(sizeof colors / sizeof *colors == RES_CATEGORIES, "une couleur par catégorie");
+  static const GLfloat background[3] = {0.0f, 0.0f, 0.0f}, marker[3] = {1.0f, 1.0f, 1.0f}, over[3] = {1.0f, 0.0f, 0.0f};
+  const int h = 5, row = 2 * h + 4;
+  int c, m, yy;
+  size_t top = 1, s;
+  GLfloat cc[4], col[3];
+  GLboolean scissor = glIsEnabled(GL_SCISSOR_TEST);
+  GLint box[4];
+  GLdouble k;
+  lock();
+  for(c = 0; c < RES_CATEGORIES; c++) {
+    s = _peak[c][RES_GPU] > _peak[c][RES_CPU] ? _peak[c][RES_GPU] : _peak[c][RES_CPU];
+    s = s > _budget[c] ? s : _budget[c];
+    top = s > top ? s : top;
+  }
+  k = width / (GLdouble)top;
+  glGetFloatv(GL_COLOR_CLEAR_VALUE, cc);
+  glGetIntegerv(GL_SCISSOR_BOX, box);
+  glEnable(GL_SCISSOR_TEST);
+  bar(x - 2, y - 2, width + 4, RES_CATEGORIES * row + 2, background);
+  for(c = 0; c < RES_CATEGORIES; c++)
+    for(m = 0; m < RES_MEMORIES; m++) {
+      const GLfloat * base = colors[c];
+      GLfloat f = m == RES_CPU ? 1.0f : 0.5f;
+      yy = y + c * row + (m == RES_CPU ? h : 0);
+      col[0] = f * base[0]; col[1] = f * base[1]; col[2] = f * base[2];
+      bar(x, yy, (int)(k * _usage[c][m] + 0.5), h, col);
+      if(_peak[c][m])
+        bar(x + (int)(k * _peak[c][m] + 0.5), yy, 1, h, marker);
+      if(_budget[c])
+        bar(x + (int)(k * _budget[c] + 0.5), yy, 1, h, over);
+    }
+  unlock();
+  glScissor(box[0], box[1], box[2], box[3]);
+  if(!scissor)
+    glDisable(GL_SCISSOR_TEST);
+  glClearColor(cc[0], cc[1], cc[2], cc[3]);
+}
+
+/*!\brief oubli de toutes les ressources (les objets GL ne sont pas
+ * détruits) et destruction du verrou */
+extern void resFree(void) {
+  int i;
+  rentry_t * e;
+  for(i = 0; i < RES_BUCKETS; i++)
+    while((e = _table[i])) {
+      _table[i] = e->next;
+      free(e);
+    }
+  if(_lock) {
+    SDL_DestroyMutex(_lock);
+    _lock = NULL;
+  }
+}
@@ -0,0 +1,93 @@
+/*!\file resources.h
+ *
+ * \brief registre des ressources : chaque buffer et texture (mémoire
+ * vidéo) et chaque bloc du tas suivi (altitudes, cache de tuiles) est
+ * enregistré avec sa taille et sa catégorie, pour savoir quelles
+ * allocations remplissent la mémoire.
+ *
+ * - resTrack enregistre une ressource ou, même nature et même clé (nom
+ *   GL ou adresse), en change la taille (glBufferData ou glTexImage
+ *   répétés) ; resUntrack l'oublie, resDeleteBuffers et
+ *   resDeleteTextures l'oublient puis la détruisent. Les tailles sont
+ *   celles demandées au pilote (mipmaps comptés par l'appelant) : le
+ *   pilote peut aligner, ou garder une copie en mémoire centrale.
+ * - Totaux et maximums atteints par catégorie et par mémoire (vidéo,
+ *   centrale), affichés par resPrint et en surimpression par
+ *   resOverlay (barres, comme profOverlay).
+ * - Budget par catégorie (resSetBudget), consulté par les caches qui
+ *   évincent contre lui (tuiles décodées de tilefile.c, les moins
+ *   récemment utilisées d'abord) ; un dépassement est signalé.
+ *
+ * resTrack, resUntrack et les lectures sont protégés par un verrou et
+ * peuvent être appelés depuis les threads de travail ; les fonctions
+ * qui appellent GL restent réservées au thread GL.
+ *
+ * \author Farès BELHADJ, amsi@ai.univ-paris8.fr
+ * \date October 14 2026
+ */
+#ifndef _RESOURCES_H
+#define _RESOURCES_H
+
+#include <GL4D/gl4dummies.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*!\brief nombre d'entrées de la table de hachage du registre */
+#define RES_BUCKETS 256
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  /*!\brief catégories de ressources */
+  enum rescat_t {
+    RES_TERRAIN = 0, /* sommets, indices, nœuds, altitudes et transferts du terrain */
+    RES_WATER,       /* cartes de l'eau, cibles de la passe d'eau, plan */
+    RES_NOISE,       /* permutation, gradients et volume de bruit */
+    RES_GEN,         /* génération de la heightMap sur GPU */
+    RES_SHADING,     /* dégradé, clipmap, état par frame */
+    RES_CULL,        /* choix des tuiles sur GPU, pyramide de profondeur */
+    RES_HEIGHT,      /* heightMaps en mémoire centrale */
+    RES_TILES,       /* cache des tuiles décodées du monde précalculé */
+    RES_OTHER,
+    RES_CATEGORIES
+  };
+
+  /*!\brief natures de ressources : les deux premières sont en mémoire
+   * vidéo, la dernière dans le tas */
+  enum reskind_t {
+    RES_BUFFER = 0,
+    RES_TEXTURE,
+    RES_HEAP,
+    RES_KINDS
+  };
+
+  /*!\brief mémoires comptées séparément */
+  enum resmem_t {
+    RES_GPU = 0,
+    RES_CPU,
+    RES_MEMORIES
+  };
+
+  extern void         resInit(void);
+  extern void         resTrack(int kind, uintptr_t key, int category, size_t bytes);
+  extern void         resUntrack(int kind, uintptr_t key);
+  extern void         resDeleteBuffers(GLsizei n, const GLuint * ids);
+  extern void         resDeleteTextures(GLsizei n, const GLuint * ids);
+  extern void         resTrackGeometry(GLuint geometry, int category);
+  extern void         resUntrackGeometry(GLuint geometry);
+  extern size_t       resUsage(int category, int memory);
+  extern size_t       resPeak(int category, int memory);
+  extern void         resSetBudget(int category, size_t bytes);
+  extern size_t       resBudget(int category);
+  extern const char * resName(int category);
+  extern void         resPrint(FILE * f);
+  extern void         resOverlay(int x, int y, int width);
+  extern void         resFree(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,7 +1,10 @@
 #version 330
 
 uniform mat4 modelViewMatrix;
-uniform mat4 projectionMatrix;
+/* produit projection x model-view et inverse transposée de la partie
+ * 3x3 de la model-view, calculés une fois par draw côté CPU */
+uniform mat4 modelViewProjectionMatrix;
+uniform mat3 normalMatrix;
 
 layout (location = 0) in vec3 vsiPosition;
 layout (location = 1) in vec3 vsiNormal;
@@ -13,9 +16,9 @@ out vec4 vsoModPosition;
 out vec3 vsoPosition;
 
 void main(void) {
-  vsoNormal = (transpose(inverse(modelViewMatrix)) * vec4(vsiNormal.xyz, 0.0)).xyz;
+  vsoNormal = normalMatrix * vsiNormal;
   vsoPosition = vsiPosition;
   vsoModPosition = modelViewMatrix * vec4(vsiPosition.xyz, 1.0);
-  gl_Position = projectionMatrix * modelViewMatrix * vec4(vsiPosition.xyz, 1.0);
+  gl_Position = modelViewProjectionMatrix * vec4(vsiPosition.xyz, 1.0);
   vsoTexCoord = vsiTexCoord;
 }
@@ -0,0 +1,118 @@
+#version 430
+/* choix des nœuds de terrain (cf. gpucull.h), un nœud par invocation ;
+ * variante GRID : instances d'une commande unique, sinon une commande
+ * par nœud (TERRAIN_MESHES) */
+layout(local_size_x = 64) in;
+
+/* boîte (monde) et erreurs, tuile : origine (x0, z0), pas et parent
+ * (-1 pour la racine) */
+struct node_t {
+  vec4 bmin;  /* xyz, erreur */
+  vec4 bmax;  /* xyz, erreur du parent */
+  ivec4 tile;
+};
+layout(std430, binding = 0) readonly buffer nodeBuffer {
+  node_t nodes[];
+};
+/* commandes de glDrawElementsIndirect : count, instanceCount,
+ * firstIndex, baseVertex, baseInstance */
+layout(std430, binding = 1) buffer commandBuffer {
+  uint commands[];
+};
+#ifdef GRID
+layout(std430, binding = 2) writeonly buffer instanceBuffer {
+  float instances[];
+};
+#endif
+
+uniform int nnodes;
+uniform int nindices;
+uniform int nvertices;
+/* erreur projetée : error * kscreen / distance, comparée à tau */
+uniform vec3 eye;
+uniform float kscreen;
+uniform float tau;
+/* plans du frustum (cf. terrainSelect), testés si frustum est non nul */
+uniform vec4 planes[6];
+uniform int frustum;
+/* pyramide Hi-Z de la frame précédente, sa vue-projection et la taille
+ * de la fenêtre ; testée si occlusion est non nul */
+uniform sampler2D hiz;
+uniform mat4 previous;
+uniform ivec2 viewport;
+uniform int occlusion;
+
+float boxDistance(vec3 bmin, vec3 bmax) {
+  return length(max(max(bmin - eye, eye - bmax), 0.0));
+}
+
+bool accept(node_t n) {
+  return n.tile.z == 1 || n.bmin.w * kscreen <= tau * boxDistance(n.bmin.xyz, n.bmax.xyz);
+}
+
+bool outside(node_t n) {
+  int p;
+  for(p = 0; p < 6; p++)
+    if(dot(planes[p].xyz, mix(n.bmin.xyz, n.bmax.xyz, greaterThan(planes[p].xyz, vec3(0.0)))) + planes[p].w < 0.0)
+      return true;
+  return false;
+}
+
+/* la boîte, projetée par la vue précédente, est-elle derrière la
+ * profondeur de cette vue ? Au moindre doute (sommet derrière l'œil,
+ * boîte débordant de la fenêtre), elle est visible. */
+bool occluded(node_t n) {
+  int c, l;
+  vec2 lo = vec2(1.0), hi = vec2(0.0);
+  float z = 1.0;
+  for(c = 0; c < 8; c++) {
+    vec4 q = previous * vec4(mix(n.bmin.xyz, n.bmax.xyz, bvec3(c & 1, c & 2, c & 4)), 1.0);
+    if(q.w <= 0.0)
+      return false;
+    q.xyz = q.xyz / q.w * 0.5 + 0.5;
+    lo = min(lo, q.xy); hi = max(hi, q.xy);
+    z = min(z, q.z);
+  }
+  if(any(lessThan(lo, vec2(0.0))) || any(greaterThan(hi, vec2(1.0))))
+    return false;
+  /* pixels couverts, puis niveau où ils tiennent dans 2 x 2 texels :
+   * le texel (x, y) du niveau l couvre au moins les pixels
+   * (x << (l + 1), y << (l + 1)) à ((x + 1) << (l + 1)) exclus */
+  ivec2 a = min(ivec2(lo * viewport), viewport - 1), b = min(ivec2(hi * viewport), viewport - 1);
+  l = clamp(int(ceil(log2(float(max(max(b.x - a.x, b.y - a.y), 1))))) - 1, 0, textureQueryLevels(hiz) - 1);
+  ivec2 s = textureSize(hiz, l) - 1;
+  a = min(a >> (l + 1), s); b = min(b >> (l + 1), s);
+  return z > max(max(texelFetch(hiz, a, l).r, texelFetch(hiz, ivec2(b.x, a.y), l).r),
+                 max(texelFetch(hiz, ivec2(a.x, b.y), l).r, texelFetch(hiz, b, l).r));
+}
+
+void main(void) {
+  int i = int(gl_GlobalInvocationID.x);
+  bool selected;
+  if(i >= nnodes)
+    return;
+  node_t n = nodes[i];
+  /* coupe du parcours de terrainSelect : le fils d'un nœud refusé est
+   * retenu dès qu'il est accepté */
+  selected = accept(n) && (n.tile.w < 0 || !accept(nodes[n.tile.w]));
+  if(selected && frustum != 0)
+    selected = !outside(n);
+  if(selected && occlusion != 0)
+    selected = !occluded(n);
+#ifdef GRID
+  if(selected) {
+    uint k = atomicAdd(commands[1], 1u) * 5u;
+    instances[k] = float(n.tile.x);
+    instances[k + 1u] = float(n.tile.y);
+    instances[k + 2u] = float(n.tile.z);
+    instances[k + 3u] = n.bmin.w;
+    instances[k + 4u] = n.bmax.w;
+  }
+#else
+  commands[5 * i]     = selected ? uint(nindices) : 0u;
+  commands[5 * i + 1] = selected ? 1u : 0u;
+  commands[5 * i + 2] = 0u;
+  commands[5 * i + 3] = uint(i * nvertices);
+  commands[5 * i + 4] = 0u;
+#endif
+}
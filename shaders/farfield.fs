@@ -0,0 +1,37 @@
+#version 330
+/* champ lointain (cf. farfield.h) : couleur et distance lues dans le
+ * cube selon la direction de vue du pixel, profondeur du point capturé
+ * vue de l'œil courant */
+layout(std140, row_major) uniform frame {
+  mat4 viewMatrix;
+  mat4 projectionMatrix;
+  vec4 lumpos;
+  float cycle;
+  float waterBlend;
+};
+uniform samplerCube farColor;
+uniform samplerCube farDistance;
+/* point de capture du cube (monde) */
+uniform vec3 captureEye;
+
+in vec2 vsoNdc;
+
+out vec4 fragColor;
+
+void main(void) {
+  /* rayon dans le repère de la vue (frustum symétrique), ramené au
+   * monde par la transposée de la rotation de la vue */
+  vec3 d = vec3(vsoNdc.x / projectionMatrix[0][0], vsoNdc.y / projectionMatrix[1][1], -1.0);
+  vec3 dir = normalize(transpose(mat3(viewMatrix)) * d);
+  vec4 c = texture(farColor, dir);
+  float dist = texture(farDistance, dir).r;
+  vec4 p;
+  if(c.a <= 0.0)
+    discard;
+  /* point repoussé d'un pour cent : dans la bande où le champ proche
+   * dessine encore le même relief, sa géométrie l'emporte */
+  p = projectionMatrix * viewMatrix * vec4(captureEye + 1.01 * dist * dir, 1.0);
+  gl_FragDepth = dist > 0.0 ? clamp(0.5 * p.z / p.w + 0.5, 0.0, 1.0) : 1.0;
+  /* alpha filtré avec le fond aux silhouettes : couleur non prémultipliée */
+  fragColor = vec4(c.rgb / c.a, c.a);
+}
@@ -0,0 +1,11 @@
+#version 330
+/* champ lointain (cf. farfield.h) : le quadrilatère [-1, 1]^2 couvre
+ * l'écran, la profondeur est écrite par le fragment shader */
+layout (location = 0) in vec3 vsiPosition;
+
+out vec2 vsoNdc;
+
+void main(void) {
+  vsoNdc = vsiPosition.xy;
+  gl_Position = vec4(vsiPosition.xy, 0.0, 1.0);
+}
@@ -0,0 +1,41 @@
+#version 430
+/* niveau de la pyramide Hi-Z (cf. gpucull.h) : chaque texel garde le
+ * maximum des 3 x 3 texels (2x, 2y) à (2x + 2, 2y + 2) du niveau
+ * inférieur, bornés à sa taille ; la troisième ligne et la troisième
+ * colonne couvrent le reste des tailles impaires. Variante FROM_DEPTH
+ * : le niveau inférieur est la profondeur de la fenêtre. */
+layout(local_size_x = 8, local_size_y = 8) in;
+
+#ifdef FROM_DEPTH
+uniform sampler2D depth;
+#else
+layout(r32f) uniform readonly image2D src;
+#endif
+layout(r32f) uniform writeonly image2D dst;
+
+float fetch(ivec2 p) {
+#ifdef FROM_DEPTH
+  return texelFetch(depth, p, 0).r;
+#else
+  return imageLoad(src, p).r;
+#endif
+}
+
+void main(void) {
+  ivec2 p = ivec2(gl_GlobalInvocationID.xy), q;
+  int i, j;
+  float m = 0.0;
+#ifdef FROM_DEPTH
+  ivec2 s = textureSize(depth, 0) - 1;
+#else
+  ivec2 s = imageSize(src) - 1;
+#endif
+  if(any(greaterThanEqual(p, imageSize(dst))))
+    return;
+  for(j = 0; j < 3; j++)
+    for(i = 0; i < 3; i++) {
+      q = min(2 * p + ivec2(i, j), s);
+      m = max(m, fetch(q));
+    }
+  imageStore(dst, p, vec4(m));
+}
@@ -0,0 +1,67 @@
+#version 330
+
+uniform mat4 modelViewMatrix;
+uniform mat4 modelViewProjectionMatrix;
+uniform mat3 normalMatrix;
+/* abaissement des jupes (coordonnées modèle) */
+uniform float skirt;
+/* kscreen / tau : un nœud d'erreur e est retenu au-delà de la distance
+ * e x morph (cf. terrain.h) */
+uniform float morph;
+/* côté des tuiles en quads, sommets par tuile, w - 1 et h - 1 de la
+ * heightMap */
+uniform ivec4 grid;
+/* deux texels par nœud : (x0, z0, pas, erreur) puis (erreur du parent,
+ * -, -, -) */
+uniform samplerBuffer nodes;
+
+/* sommet compact de terrain.c : altitude et altitude sur le maillage du
+ * parent dans [0, 1], normale projetée sur l'octaèdre */
+layout (location = 0) in vec2 vsiHeight;
+layout (location = 1) in vec2 vsiNormal;
+
+out vec2 vsoTexCoord;
+out vec3 vsoNormal;
+out vec4 vsoModPosition;
+out vec3 vsoPosition;
+/* même position quel que soit le fragment shader lié : la pré-passe de
+ * profondeur (variante DEPTH_ONLY de basic.fs) et la passe éclairée
+ * produisent des profondeurs identiques */
+invariant gl_Position;
+
+vec3 octahedron(vec2 e) {
+  vec3 n = vec3(e.x, 1.0 - abs(e.x) - abs(e.y), e.y);
+  if(n.y < 0.0)
+    n.xz = (1.0 - abs(n.zx)) * vec2(n.x < 0.0 ? -1.0 : 1.0, n.z < 0.0 ? -1.0 : 1.0);
+  return normalize(n);
+}
+
+/* gl_VertexID inclut le base vertex du nœud : nœud i, sommet k de la
+ * tuile, dans l'ordre de buildMesh() (grille puis 4 jupes) */
+void main(void) {
+  int T = grid.x, W = T + 1, node = gl_VertexID / grid.y, k = gl_VertexID % grid.y, e, q;
+  ivec2 ij;
+  float drop = 0.0;
+  if(k < W * W)
+    ij = ivec2(k % W, k / W);
+  else {
+    e = (k - W * W) / W; q = (k - W * W) % W;
+    ij = ivec2(e < 2 ? q : (e == 2 ? 0 : T), e == 0 ? 0 : (e == 1 ? T : q));
+    drop = skirt;
+  }
+  vec4 a = texelFetch(nodes, 2 * node), b = texelFetch(nodes, 2 * node + 1);
+  ivec2 p = min(ivec2(a.xy) + int(a.z) * ij, grid.zw);
+  vec3 pos = vec3(-1.0 + 2.0 * float(p.x) / float(grid.z),
+                  2.0 * vsiHeight.x - 1.0 - drop,
+                  1.0 - 2.0 * float(p.y) / float(grid.w));
+  /* morphing vers le parent entre la distance où le nœud est retenu et
+   * celle où son parent le serait */
+  float dist = length((modelViewMatrix * vec4(pos, 1.0)).xyz);
+  float s = a.w * morph, f = b.x * morph;
+  pos.y += clamp((dist - s) / max(f - s, 1e-6), 0.0, 1.0) * 2.0 * (vsiHeight.y - vsiHeight.x);
+  vsoNormal = normalMatrix * octahedron(vsiNormal);
+  vsoPosition = pos;
+  vsoModPosition = modelViewMatrix * vec4(pos, 1.0);
+  gl_Position = modelViewProjectionMatrix * vec4(pos, 1.0);
+  vsoTexCoord = vec2(p) / vec2(grid.zw);
+}
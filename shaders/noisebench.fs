@@ -0,0 +1,19 @@
+#version 330
+/* charge de noiseBenchmark (noise.c) : 8 appels de chacune des deux
+ * fonctions de bruit par pixel, à des fréquences croissantes comme dans
+ * water.fs et terraingen.fs */
+
+float noise(vec3 P);
+float snoise(vec2 P);
+
+in  vec2 vsoTexCoord;
+out float fragColor;
+
+void main(void) {
+  float sum = 0.0, freq = 4.0;
+  for(int i = 0; i < 8; i++) {
+    sum += noise(vec3(vsoTexCoord * freq, 0.5 * freq)) + snoise(vsoTexCoord.yx * freq);
+    freq *= 2.0;
+  }
+  fragColor = sum;
+}
@@ -0,0 +1,26 @@
+#version 330
+/* backend NOISE_VOLUME de la bibliothèque de bruit (cf. noise.h) :
+ * bruit classique précalculé (noise.c, initVolume) dans une texture 3D
+ * de période 32 en chaque dimension, une seule lecture filtrée par
+ * appel. Le simplex 2D est approché par une coupe du même volume. */
+#ifdef NOISE_BINDLESS
+#extension GL_ARB_bindless_texture : require
+#endif
+#ifdef NOISE_TESS
+/* shader objet d'évaluation de tessellation (cf. noiseTessProgram) */
+#extension GL_ARB_tessellation_shader : enable
+#endif
+
+uniform sampler3D noiseVolume;
+
+/* période de la texture, NOISE_VOLUME_PERIOD de noise.h */
+const float period = 32.0;
+
+float noise(vec3 P) {
+  return texture(noiseVolume, P / period).r;
+}
+
+float snoise(vec2 P) {
+  /* coupe hors des plans entiers, où le bruit classique s'annule */
+  return 1.4 * texture(noiseVolume, vec3(P, 0.37) / period).r;
+}
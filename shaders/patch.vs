@@ -0,0 +1,10 @@
+#version 330
+/* coin d'un patch de tessellation (cf. terrainDrawPatches) : colonne
+ * et ligne de l'échantillon, passées telles quelles à patch.tcs */
+layout (location = 0) in vec2 vsiSample;
+
+out vec2 vsoSample;
+
+void main(void) {
+  vsoSample = vsiSample;
+}
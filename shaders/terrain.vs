@@ -0,0 +1,61 @@
+#version 330
+
+uniform mat4 modelViewMatrix;
+uniform mat4 modelViewProjectionMatrix;
+uniform mat3 normalMatrix;
+/* abaissement des jupes (coordonnées modèle) */
+uniform float skirt;
+/* kscreen / tau, cf. mesh.vs */
+uniform float morph;
+/* altitudes dans [0, 1], texel (j, i) = ligne i, colonne j */
+uniform sampler2D heights;
+/* normales (modèle) encodées dans [0, 1], cf. shaders/terrainnormal.fs */
+uniform sampler2D normals;
+
+/* sommet de la grille partagée : colonne, ligne dans la tuile et
+ * drapeau de jupe */
+layout (location = 0) in vec3 vsiPosition;
+/* attributs d'instance, la tuile dessinée : origine (x0, z0) et pas en
+ * échantillons de la heightMap, erreurs du nœud et de son parent */
+layout (location = 3) in vec3 vsiTile;
+layout (location = 4) in vec2 vsiMorph;
+
+out vec2 vsoTexCoord;
+out vec3 vsoNormal;
+out vec4 vsoModPosition;
+out vec3 vsoPosition;
+/* même position quel que soit le fragment shader lié : la pré-passe de
+ * profondeur (variante DEPTH_ONLY de basic.fs) et la passe éclairée
+ * produisent des profondeurs identiques */
+invariant gl_Position;
+
+float altitude(ivec2 p) {
+  return texelFetch(heights, p, 0).r;
+}
+
+/* mêmes position, normale et coordonnée de texture que les maillages
+ * précalculés de terrain.c (cf. vertex()), la normale étant lue dans la
+ * texture des normales */
+void main(void) {
+  ivec2 s = textureSize(heights, 0) - 1;
+  ivec2 p = min(ivec2(vsiTile.xy + vsiTile.z * vsiPosition.xy), s);
+  /* sur le maillage du parent, un sommet impair est au milieu d'une
+   * arête horizontale, verticale ou diagonale (cf. coarseHeight() dans
+   * terrain.c) */
+  ivec2 o = ivec2(vsiPosition.xy) & 1, m = int(vsiTile.z) * ivec2(o.x, -o.y);
+  float coarse = 0.5 * (altitude(clamp(p + m, ivec2(0), s)) + altitude(clamp(p - m, ivec2(0), s)));
+  vec3 pos = vec3(-1.0 + 2.0 * float(p.x) / float(s.x),
+                  2.0 * altitude(p) - 1.0 - skirt * vsiPosition.z,
+                  1.0 - 2.0 * float(p.y) / float(s.y));
+  /* morphing vers le parent, cf. mesh.vs ; la racine (erreurs égales)
+   * ne se déforme pas */
+  float dist = length((modelViewMatrix * vec4(pos, 1.0)).xyz);
+  float a = vsiMorph.x * morph, b = vsiMorph.y * morph;
+  if(vsiMorph.y > vsiMorph.x)
+    pos.y += clamp((dist - a) / max(b - a, 1e-6), 0.0, 1.0) * 2.0 * (coarse - altitude(p));
+  vsoNormal = normalMatrix * normalize(texelFetch(normals, p, 0).xyz * 2.0 - 1.0);
+  vsoPosition = pos;
+  vsoModPosition = modelViewMatrix * vec4(pos, 1.0);
+  gl_Position = modelViewProjectionMatrix * vec4(pos, 1.0);
+  vsoTexCoord = vec2(p) / vec2(s);
+}
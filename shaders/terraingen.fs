@@ -0,0 +1,41 @@
+#version 330
+/* nombre d'octaves, fixé à la compilation (cf. gpugen.c) */
+#ifndef OCTAVES
+#  define OCTAVES 8
+#endif
+/* décalage dans le domaine du bruit tiré de la graine, fréquence de
+ * base et réduction d'amplitude par octave */
+uniform vec2 offset;
+uniform float frequency;
+uniform float reduction;
+/* nombre d'intervalles de la heightMap en x et z : (w - 1, h - 1) */
+uniform vec2 size;
+
+out vec4 fragColor;
+
+/* bruit simplex 2D, défini dans noise.fs */
+float snoise(vec2 P);
+
+/* étalement du fBm normalisé autour de 0.5 (son écart type est bien
+ * inférieur à 1) */
+const float contrast = 1.5;
+
+/* fBm : somme d'octaves de bruit, normalisée dans [-1, 1] */
+float fbm(vec2 p) {
+  float amp = 1.0, sum = 0.0, norm = 0.0;
+  for(int i = 0; i < OCTAVES; i++) {
+    sum += amp * snoise(p);
+    norm += amp;
+    /* décalage par octave pour décorréler les octaves à l'origine */
+    p = 2.0 * p + vec2(19.1, 7.3);
+    amp *= reduction;
+  }
+  return sum / norm;
+}
+
+/* le texel (j, i) est l'altitude de la ligne i, colonne j de la
+ * heightMap, dans [0, 1] */
+void main(void) {
+  vec2 ij = floor(gl_FragCoord.xy);
+  fragColor = vec4(clamp(0.5 + 0.5 * contrast * fbm(offset + frequency * ij / size), 0.0, 1.0));
+}
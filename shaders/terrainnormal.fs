@@ -0,0 +1,18 @@
+#version 330
+/* altitudes dans [0, 1], texel (j, i) = ligne i, colonne j */
+uniform sampler2D height;
+
+out vec4 fragColor;
+
+/* normale (modèle) de la heightMap par différences centrées
+ * (décentrées sur les bords), encodée dans [0, 1] ; même calcul que
+ * meshVertex() dans terrain.c : z décroît quand la ligne i croît */
+void main(void) {
+  ivec2 s = textureSize(height, 0) - 1, p = ivec2(gl_FragCoord.xy);
+  ivec2 l = ivec2(max(p.x - 1, 0), p.y), r = ivec2(min(p.x + 1, s.x), p.y);
+  ivec2 u = ivec2(p.x, max(p.y - 1, 0)), d = ivec2(p.x, min(p.y + 1, s.y));
+  /* pentes dy/dx et dy/dz en coordonnées modèle */
+  float dx =  (texelFetch(height, r, 0).r - texelFetch(height, l, 0).r) * float(s.x) / float(r.x - l.x);
+  float dz = -(texelFetch(height, d, 0).r - texelFetch(height, u, 0).r) * float(s.y) / float(d.y - u.y);
+  fragColor = vec4(0.5 + 0.5 * normalize(vec3(-dx, 1.0, -dz)), 1.0);
+}
@@ -0,0 +1,35 @@
+#version 330
+/* nombre d'octaves du champ de hauteur, borné par water.c à celles
+ * que la résolution de la carte représente */
+#ifndef OCTAVES
+#  define OCTAVES 8
+#endif
+uniform float cycle;
+in vec2 vsoTexCoord;
+
+out vec4 fragColor;
+
+/* bruit de Perlin classique, défini dans noise.fs */
+float noise(vec3 P);
+
+/* champ de hauteur de la surface de l'eau : OCTAVES octaves de bruit
+ * plus une houle sinusoïdale */
+float alt(vec2 xy) {
+  const float mamp = 1.0, mfreq = 100.0;
+  float amp, freq;
+  float n = 0.0;
+  for(int i = 0; i < OCTAVES; i++) {
+    float mult = pow(2.2, float(OCTAVES - 1 - i)), np;
+    amp = mamp / mult;
+    freq = mfreq * mult;
+    np = amp * (2.0 * abs(noise(vec3(xy*freq, cycle / 2.5)) - 0.5));
+    n += np * np;
+  }
+  float s = n + (1.0 + sin(xy.y * 300.0 + cycle)) / 2.0;
+  return s;
+}
+
+/* précalcul : une évaluation de alt() par texel */
+void main(void) {
+  fragColor = vec4(alt(vsoTexCoord));
+}
@@ -0,0 +1,12 @@
+#version 330
+
+layout (location = 0) in vec3 vsiPosition;
+layout (location = 2) in vec2 vsiTexCoord;
+
+out vec2 vsoTexCoord;
+
+/* passage direct du quad plein écran pour le précalcul de l'eau */
+void main(void) {
+  gl_Position = vec4(vsiPosition.xy, 0.0, 1.0);
+  vsoTexCoord = vsiTexCoord;
+}
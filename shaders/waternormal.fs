@@ -0,0 +1,24 @@
+#version 330
+uniform sampler2D height;
+in vec2 vsoTexCoord;
+
+out vec4 fragColor;
+
+const vec2 steps = vec2(0.005, 0.005);
+
+vec2 G[9] = vec2[9](vec2(-1, -1), vec2(0, -2), vec2(1, -1),
+                    vec2(-2,  0), vec2(0,  0), vec2(2, 0),
+                    vec2(-1,  1), vec2(0,  2), vec2(1,  1));
+
+vec2 offset[9] = vec2[9](vec2(-steps.x,  steps.y), vec2(0,  steps.y), vec2(steps.x,  steps.y),
+                         vec2(-steps.x,  0),       vec2(0,  0),       vec2(steps.x, 0),
+                         vec2(-steps.x, -steps.y), vec2(0, -steps.y), vec2(steps.x, -steps.y));
+
+/* Sobel sur le champ de hauteur précalculé par water.fs : le résultat
+ * est la perturbation (tangente, binormale) de la normale de l'eau */
+void main(void) {
+  vec2 g = vec2(0);
+  for(int i = 0; i < 9; i++)
+    g += G[i] * texture(height, vsoTexCoord + offset[i]).r;
+  fragColor = vec4(g / 1000.0, 0.0, 1.0);
+}
@@ -0,0 +1,30 @@
+#version 330
+/* recomposition à pleine résolution de l'eau éclairée dans une cible
+ * réduite (cf. waterpass.h) : le plan d'eau est redessiné, son test de
+ * profondeur le découpe contre le terrain au pixel près, et chaque
+ * fragment interpole les quatre texels réduits voisins en écartant ceux
+ * que l'eau ne couvre pas (alpha nul) */
+uniform sampler2D lowres;
+/* rapport région réduite / fenêtre et taille (texels) de la région */
+uniform vec2 scale;
+uniform ivec2 size;
+
+out vec4 fragColor;
+
+void main(void) {
+  vec2 p = gl_FragCoord.xy * scale - 0.5, f = fract(p);
+  ivec2 i = ivec2(floor(p));
+  vec4 c = vec4(0.0);
+  float s = 0.0;
+  for(int k = 0; k < 4; k++) {
+    ivec2 o = ivec2(k & 1, k >> 1);
+    vec4 t = texelFetch(lowres, clamp(i + o, ivec2(0), size - 1), 0);
+    vec2 b = mix(1.0 - f, f, vec2(o));
+    float w = b.x * b.y * step(1.0 / 255.0, t.a);
+    c += w * t;
+    s += w;
+  }
+  if(s <= 0.0)
+    discard;
+  fragColor = c / s;
+}
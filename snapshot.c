@@ -0,0 +1,49 @@
+/*!\file snapshot.c
+ *
+ * \brief triple tampon d'états de frame, cf. snapshot.h.
+ *
+ * \author Farès BELHADJ, amsi@ai.univ-paris8.fr
+ * \date October 14 2026
+ */
+#include "snapshot.h"
+#include <stdlib.h>
+
+/*!\brief drapeau de l'emplacement du milieu publié et non lu */
+#define SNAPSHOT_FRESH 4
+
+/*!\brief a, b et c : emplacements initiaux du producteur, du milieu et
+ * du consommateur ; rien n'est publié */
+extern void snapshotsInit(snapshots_t * s, void * a, void * b, void * c) {
+  s->slots[0] = a;
+  s->slots[1] = b;
+  s->slots[2] = c;
+  s->write = 0;
+  s->read = 2;
+  s->valid = 0;
+  SDL_AtomicSet(&s->middle, 1);
+}
+
+/*!\brief emplacement à remplir par le producteur */
+extern void * snapshotsWrite(snapshots_t * s) {
+  return s->slots[s->write];
+}
+
+/*!\brief publication de l'emplacement du producteur, qui reçoit
+ * l'ancien emplacement du milieu (lu ou remplacé avant d'avoir été
+ * lu) */
+extern void snapshotsPublish(snapshots_t * s) {
+  /* écritures de l'état visibles avant sa publication */
+  SDL_MemoryBarrierRelease();
+  s->write = SDL_AtomicSet(&s->middle, s->write | SNAPSHOT_FRESH) & 3;
+}
+
+/*!\brief état publié le plus récent, possédé par le consommateur
+ * jusqu'à son prochain appel ; NULL si rien n'a encore été publié */
+extern void * snapshotsRead(snapshots_t * s) {
+  if(SDL_AtomicGet(&s->middle) & SNAPSHOT_FRESH) {
+    s->read = SDL_AtomicSet(&s->middle, s->read) & 3;
+    SDL_MemoryBarrierAcquire();
+    s->valid = 1;
+  }
+  return s->valid ? s->slots[s->read] : NULL;
+}
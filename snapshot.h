@@ -0,0 +1,45 @@
+/*!\file snapshot.h
+ *
+ * \brief triple tampon d'états de frame entre un producteur (les
+ * tâches de simulation et de visibilité de la frame N + 1) et un
+ * consommateur (le thread GL qui soumet la frame N). Chacun possède son
+ * emplacement, le troisième est l'état publié le plus récent :
+ * snapshotsPublish échange l'emplacement du producteur avec lui,
+ * snapshotsRead celui du consommateur s'il est plus récent. Aucun état
+ * n'est partagé en écriture et aucun des deux côtés n'attend l'autre.
+ *
+ * Les emplacements sont fournis par l'appelant (contenu opaque).
+ *
+ * \author Farès BELHADJ, amsi@ai.univ-paris8.fr
+ * \date October 14 2026
+ */
+#ifndef _SNAPSHOT_H
+#define _SNAPSHOT_H
+
+#include <SDL.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  typedef struct snapshots_t snapshots_t;
+  /*!\brief triple tampon : emplacements du producteur et du
+   * consommateur (valide dès la première lecture), et, dans middle,
+   * celui du milieu avec le drapeau SNAPSHOT_FRESH s'il n'a pas encore
+   * été lu */
+  struct snapshots_t {
+    void * slots[3];
+    int write, read, valid;
+    SDL_atomic_t middle;
+  };
+
+  extern void   snapshotsInit(snapshots_t * s, void * a, void * b, void * c);
+  extern void * snapshotsWrite(snapshots_t * s);
+  extern void   snapshotsPublish(snapshots_t * s);
+  extern void * snapshotsRead(snapshots_t * s);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,1301 @@
+/*!\file terrain.c
+ *
+ * \brief rendu de terrain par tuiles (chunked LOD) organisées en
+ * quadtree, cf. terrain.h.
+ *
+ * Tous les nœuds partagent la même topologie (grille de tile x tile
+ * quads et jupes) et donc le même index buffer ; seuls les sommets
+ * diffèrent. L'erreur géométrique d'un nœud est l'écart vertical
+ * maximal entre la heightMap pleine résolution et le maillage du
+ * nœud ; elle est rendue monotone (un parent n'est jamais plus précis
+ * que ses enfants) afin que la sélection descende de façon
+ * cohérente. Le seuil d'erreur écran est ajusté d'une frame à l'autre
+ * pour tenir un budget de triangles indépendant de la taille de la
+ * carte.
+ *
+ * En mode TERRAIN_GRID, la grille partagée ne stocke par sommet que sa
+ * colonne, sa ligne dans la tuile et un drapeau de jupe (4 octets) ;
+ * l'origine et le pas de chaque tuile sont des attributs d'instance. En
+ * mode TERRAIN_MESHES les maillages des nœuds se suivent dans un seul
+ * vertex buffer, le nœud i commençant au sommet i * nvertices : un
+ * sommet n'y garde que ce qui ne se recalcule pas, altitudes quantifiées
+ * sur 16 bits et normale en octaèdre sur 2 x 16 bits (8 octets contre
+ * 32 en flottants). Le vertex shader retrouve nœud et position dans la
+ * tuile à partir de gl_VertexID (base vertex compris), l'origine et le
+ * pas du nœud dans une texture buffer.
+ *
+ * L'horizon est une table de pentes (dy / distance horizontale)
+ * indexée par secteur d'azimut autour de l'œil. Sous une tuile
+ * d'altitude minimale ymin tout est plein : un rayon qui traverse son
+ * emprise plus bas que ymin est arrêté. Pour chaque secteur entièrement
+ * couvert par l'emprise on en déduit une borne inférieure de la pente
+ * masquée. Un nœud visité ensuite (donc plus loin le long de chacun de
+ * ses rayons, grâce à l'ordre de parcours) dont la pente maximale reste
+ * sous l'horizon de tous ses secteurs est invisible.
+ *
+ * \author Farès BELHADJ, amsi@ai.univ-paris8.fr
+ * \date October 14 2026
+ */
+#include "terrain.h"
+#include "gpugen.h"
+#include "vcache.h"
+#include "resources.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+
+/*!\brief nombre de GLushort par sommet (TERRAIN_MESHES) : altitude,
+ * altitude sur le maillage du parent (morphing) et normale en
+ * octaèdre ; le reste se déduit de gl_VertexID (cf. shaders/mesh.vs) */
+#define VERTEX_SIZE 4
+/*!\brief nombre de texels (RGBA32F) par nœud dans la texture des nœuds
+ * (TERRAIN_MESHES) : origine, pas et erreur, puis erreur du parent */
+#define NODE_TEXELS 2
+/*!\brief nombre d'octets par sommet de la grille partagée : colonne,
+ * ligne, drapeau de jupe et remplissage */
+#define GRID_VERTEX_SIZE 4
+/*!\brief nombre de secteurs d'azimut de l'horizon */
+#define HORIZON_BINS 1024
+
+typedef struct view_t view_t;
+/*!\brief paramètres de vue d'une sélection et, pour une partie,
+ * profondeur de découpe et sous-arbres [lo, hi[ qui lui reviennent */
+struct view_t {
+  GLfloat eye[3], kscreen;
+  GLfloat planes[6][4];
+  int depth, lo, hi;
+};
+
+static int buildNode(const terrain_t * t, const hpyramid_t * p, tnode_t * nodes, int * count, int level, int x0, int z0);
+static GLfloat nodeError(const heightmap_t * hm, const tnode_t * n, int x0, int z0, int x1, int z1);
+static void nodeBounds(const terrain_t * t, const hpyramid_t * p, tnode_t * n);
+static void buildMesh(const terrain_t * t, const heightmap_t * hm, const tnode_t * n, GLushort * v);
+static void meshVertex(const terrain_t * t, const heightmap_t * hm, const tnode_t * n, int k, GLushort * v);
+static void editNode(terrain_t * t, int id, const int * r, GLushort * v);
+static void uploadNode(const terrain_t * t, int id);
+static void buildMeshBuffer(terrain_t * t, GLuint * vao, GLuint * vbo);
+static void buildNodeTexture(terrain_t * t);
+static void uploadNodes(const terrain_t * t);
+static void buildIndices(terrain_t * t);
+static void buildGrid(terrain_t * t);
+static void buildPatches(terrain_t * t);
+static int hasExtension(const char * name);
+static GLuint heightTexture(const terrain_t * t);
+static GLuint normalTexture(const terrain_t * t);
+static void copyTexture(GLuint src, GLuint dst, int w, int h);
+static void commit(terrain_t * t);
+static void buildRing(terrain_t * t);
+static void uploadSlices(terrain_t * t, GLsizeiptr budget);
+static void selectNode(const terrain_t * t, tselection_t * s, int i, const view_t * v, int mask, int depth, int lo);
+
+/*!\brief altitude [0, 1] de l'échantillon (x, z), bornée à la carte */
+static inline GLfloat sample(const heightmap_t * hm, int x, int z) {
+  x = x < 0 ? 0 : (x >= hm->w ? hm->w - 1 : x);
+  z = z < 0 ? 0 : (z >= hm->h ? hm->h - 1 : z);
+  return hm->data[z * hm->w + x];
+}
+
+/*!\brief création du terrain sur la heightMap hm avec des tuiles de
+ * tile x tile quads (tile puissance de 2, multiple de TERRAIN_CELLS et
+ * <= 128 pour tenir en index 16 bits) et des
+ * sommets stockés selon mode (tmode_t) */
+extern terrain_t * terrainNew(heightmap_t * hm, int tile, int mode) {
+  int l, n, max = (hm->w > hm->h ? hm->w : hm->h) - 1;
+  terrain_t * t = malloc(sizeof *t);
+  assert(t && tile >= TERRAIN_CELLS && tile <= 128 && !(tile & (tile - 1)));
+  t->hm = hm;
+  t->pyramid = hpyramidNew(hm);
+  for(t->cellshift = 0; (TERRAIN_CELLS << t->cellshift) < tile; t->cellshift++);
+  t->tile = tile;
+  t->mode = mode;
+  for(t->levels = 1; (tile << (t->levels - 1)) < max; t->levels++);
+  for(l = 0, n = 0; l < t->levels; l++)
+    n += 1 << (2 * l);
+  t->nnodes = n;
+  t->nodes = malloc(n * sizeof *t->nodes);
+  t->next = malloc(n * sizeof *t->next);
+  t->nextPyramid = hpyramidNew(hm);
+  t->nbins = HORIZON_BINS;
+  assert(t->nodes && t->next);
+  t->nvertices = (tile + 1) * (tile + 1) + 4 * (tile + 1);
+  t->vao = t->vbo = t->heightTex = t->normalTex = t->ibuffer = 0;
+  t->skirtLoc = t->morphLoc = t->gridLoc = -1;
+  t->nodeBuffer = t->nodeTex = 0;
+  t->patchVao = t->patchVbo = 0;
+  t->npatches = 0;
+  t->tessLoc = t->boundsLoc = -1;
+  t->vbytes = 0;
+  t->staging = NULL;
+  t->nextData = NULL;
+  t->staged = t->uploaded = 0;
+  t->nextVao = t->nextVbo = t->nextTex = t->ring = 0;
+  t->ringPtr = NULL;
+  memset(t->fences, 0, sizeof t->fences);
+  t->segment = 0;
+  t->ndirty = 0;
+  t->edited = 0;
+  t->revision = 0;
+  buildIndices(t);
+  if(mode == TERRAIN_GRID) {
+    buildGrid(t);
+    if(hasExtension("GL_ARB_tessellation_shader"))
+      buildPatches(t);
+  } else
+    buildNodeTexture(t);
+  terrainRefresh(t);
+  t->tau = t->tau_min = 2.0f;
+  t->budget = 0;
+  t->culling = TERRAIN_CULL_ALL;
+  return t;
+}
+
+/*!\brief prise en compte d'une modification de hm->data : pyramide
+ * min/max et quadtree (boîtes, erreurs, altitudes minimales)
+ * recalculés, puis maillages des nœuds ou texture d'altitudes mis à
+ * jour selon le mode, immédiatement */
+extern void terrainRefresh(terrain_t * t) {
+  terrainPrepare(t, t->hm->data);
+  terrainUpload(t, 0);
+  t->ndirty = 0;
+}
+
+/*!\brief préparation de l'état suivant du terrain pour les altitudes
+ * data (mêmes dimensions que t->hm) : pyramide, quadtree et, en mode
+ * TERRAIN_MESHES, sommets de tous les nœuds. Sans appel GL ni
+ * modification de l'état courant, elle peut s'exécuter dans un autre
+ * thread pendant que le terrain est sélectionné et dessiné ; data doit
+ * rester valide jusqu'à ce que terrainUpload ait rendu 1. */
+extern void terrainPrepare(terrain_t * t, const GLfloat * data) {
+  int n, count = 0;
+  GLsizeiptr nv = t->nvertices * VERTEX_SIZE;
+  hpyramid_t * p = t->nextPyramid;
+  p->hm.data = (GLfloat *)data;
+  hpyramidUpdate(p);
+  buildNode(t, p, t->next, &count, t->levels - 1, 0, 0);
+  /* quadtree complet : même nombre de nœuds, t->nnodes reste lisible
+   * par le thread de rendu */
+  assert(count == t->nnodes);
+  /* la fissure entre deux tuiles voisines ne dépasse jamais l'erreur
+   * de la plus grossière des deux, bornée par celle de la racine */
+  t->nextSkirt = t->next[0].error / t->hm->scale_y + 0.01f;
+  t->nextData = data;
+  t->uploaded = 0;
+  if(t->mode == TERRAIN_GRID) {
+    t->staged = t->hm->w * (GLsizeiptr)t->hm->h * sizeof *data;
+    return;
+  }
+  t->staged = t->nnodes * nv * sizeof *t->staging;
+  if(!t->staging)
+    t->staging = malloc(t->staged);
+  assert(t->staging);
+  resTrack(RES_HEAP, (uintptr_t)t->staging, RES_TERRAIN, t->staged);
+  for(n = 0; n < t->nnodes; n++)
+    buildMesh(t, &p->hm, &t->next[n], &t->staging[n * nv]);
+}
+
+/*!\brief transfert vers le GPU d'au plus budget octets de l'état
+ * préparé par terrainPrepare, via un tampon de transfert découpé en
+ * TERRAIN_RING_SEGMENTS segments : un segment n'est réécrit qu'une fois
+ * sa barrière (fence) passée, sans jamais attendre le GPU. Les données
+ * vont dans un second vertex buffer ou une seconde texture, échangés
+ * avec les courants une fois complets. budget <= 0 transfère tout,
+ * directement dans les ressources courantes. En mode TERRAIN_GRID, les
+ * normales sont ensuite recalculées sur le GPU (gpuGenNormals). Retourne
+ * 1 quand l'état préparé est devenu l'état courant. */
+extern int terrainUpload(terrain_t * t, GLsizeiptr budget) {
+  GLuint id;
+  if(budget <= 0) {
+    if(t->mode == TERRAIN_GRID) {
+      glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+      glBindTexture(GL_TEXTURE_2D, t->heightTex);
+      glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, t->hm->w, t->hm->h, GL_RED, GL_FLOAT, t->nextData);
+      glBindTexture(GL_TEXTURE_2D, 0);
+    } else {
+      if(!t->vbo)
+        buildMeshBuffer(t, &t->vao, &t->vbo);
+      glBindBuffer(GL_ARRAY_BUFFER, t->vbo);
+      glBufferSubData(GL_ARRAY_BUFFER, 0, t->staged, t->staging);
+      glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+  } else {
+    if(!t->ring)
+      buildRing(t);
+    if(t->mode == TERRAIN_GRID && !t->nextTex)
+      t->nextTex = heightTexture(t);
+    else if(t->mode != TERRAIN_GRID && !t->nextVbo)
+      buildMeshBuffer(t, &t->nextVao, &t->nextVbo);
+    uploadSlices(t, budget);
+    if(t->uploaded < t->staged)
+      return 0;
+    if(t->mode == TERRAIN_GRID) {
+      id = t->heightTex; t->heightTex = t->nextTex; t->nextTex = id;
+    } else {
+      id = t->vao; t->vao = t->nextVao; t->nextVao = id;
+      id = t->vbo; t->vbo = t->nextVbo; t->nextVbo = id;
+    }
+  }
+  if(t->mode == TERRAIN_GRID)
+    gpuGenNormals(t->heightTex, t->normalTex, t->hm->w, t->hm->h, NULL);
+  commit(t);
+  return 1;
+}
+
+/*!\brief prise en compte de heightTex et normalTex (GL_R32F et
+ * GL_RGB10_A2, dimensions de t->hm, cf. gpugen.h), déjà calculées sur
+ * le GPU pour les altitudes t->hm->data (TERRAIN_GRID) : pyramide et
+ * quadtree recalculés sur le CPU, textures copiées de GPU à GPU sans
+ * transfert depuis la mémoire centrale */
+extern void terrainRefreshTextures(terrain_t * t, GLuint heightTex, GLuint normalTex) {
+  assert(t->mode == TERRAIN_GRID);
+  terrainPrepare(t, t->hm->data);
+  copyTexture(heightTex, t->heightTex, t->hm->w, t->hm->h);
+  copyTexture(normalTex, t->normalTex, t->hm->w, t->hm->h);
+  commit(t);
+  t->ndirty = 0;
+}
+
+/*!\brief l'état préparé, transféré, devient l'état courant */
+static void commit(terrain_t * t) {
+  tnode_t * nodes;
+  hpyramid_t * p;
+  t->uploaded = t->staged;
+  nodes = t->nodes; t->nodes = t->next; t->next = nodes;
+  p = t->pyramid; t->pyramid = t->nextPyramid; t->nextPyramid = p;
+  t->skirt = t->nextSkirt;
+  t->revision++;
+  if(t->mode != TERRAIN_GRID)
+    uploadNodes(t);
+  resUntrack(RES_HEAP, (uintptr_t)t->staging);
+  free(t->staging);
+  t->staging = NULL;
+}
+
+/*!\brief ajout des échantillons [x0, x1] x [z0, z1] (colonnes,
+ * lignes, bornes incluses) de t->hm->data aux régions modifiées : un
+ * rectangle qui en touche un autre le rejoint ; au-delà de
+ * TERRAIN_DIRTY_RECTS, il est fusionné à celui que l'union agrandit le
+ * moins */
+extern void terrainDirty(terrain_t * t, int x0, int z0, int x1, int z1) {
+  int k, best = 0, * d;
+  long long a, amin = -1;
+  x0 = x0 < 0 ? 0 : x0; z0 = z0 < 0 ? 0 : z0;
+  x1 = x1 > t->hm->w - 1 ? t->hm->w - 1 : x1;
+  z1 = z1 > t->hm->h - 1 ? t->hm->h - 1 : z1;
+  if(x0 > x1 || z0 > z1)
+    return;
+  for(k = 0; k < t->ndirty; k++) {
+    d = t->dirty[k];
+    if(d[0] <= x1 + 1 && x0 <= d[2] + 1 && d[1] <= z1 + 1 && z0 <= d[3] + 1)
+      break;
+    a = (long long)((d[2] > x1 ? d[2] : x1) - (d[0] < x0 ? d[0] : x0) + 1) *
+      ((d[3] > z1 ? d[3] : z1) - (d[1] < z0 ? d[1] : z0) + 1) - (long long)(d[2] - d[0] + 1) * (d[3] - d[1] + 1);
+    if(amin < 0 || a < amin) {
+      amin = a;
+      best = k;
+    }
+  }
+  if(k == t->ndirty && t->ndirty < TERRAIN_DIRTY_RECTS) {
+    d = t->dirty[t->ndirty++];
+    d[0] = x0; d[1] = z0; d[2] = x1; d[3] = z1;
+    return;
+  }
+  d = t->dirty[k < t->ndirty ? k : best];
+  d[0] = d[0] < x0 ? d[0] : x0; d[1] = d[1] < z0 ? d[1] : z0;
+  d[2] = d[2] > x1 ? d[2] : x1; d[3] = d[3] > z1 ? d[3] : z1;
+}
+
+/*!\brief application immédiate des régions modifiées (terrainDirty) :
+ * pyramide, nœuds touchés et leurs lignes de sommets ou le rectangle de
+ * la texture d'altitudes, envoyés en un glBufferSubData par nœud ou un
+ * glTexSubImage2D par région. Retourne 0, régions conservées, tant
+ * qu'une mise à jour étalée (terrainPrepare, terrainUpload) est en
+ * cours. */
+extern int terrainFlush(terrain_t * t) {
+  int k, w = t->hm->w, * r, rect[4];
+  GLushort * v;
+  t->edited = 0;
+  if(!t->ndirty)
+    return 1;
+  if(t->uploaded < t->staged)
+    return 0;
+  t->pyramid->hm.data = t->hm->data;
+  v = malloc(t->nvertices * VERTEX_SIZE * sizeof *v);
+  assert(v);
+  if(t->mode == TERRAIN_GRID) {
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, w);
+    glBindTexture(GL_TEXTURE_2D, t->heightTex);
+  } else {
+    glBindBuffer(GL_ARRAY_BUFFER, t->vbo);
+    glBindBuffer(GL_TEXTURE_BUFFER, t->nodeBuffer);
+  }
+  for(k = 0; k < t->ndirty; k++) {
+    r = t->dirty[k];
+    hpyramidUpdateRect(t->pyramid, r[1], r[0], r[3], r[2]);
+    editNode(t, 0, r, v);
+    if(t->mode == TERRAIN_GRID) {
+      glTexSubImage2D(GL_TEXTURE_2D, 0, r[0], r[1], r[2] - r[0] + 1, r[3] - r[1] + 1, GL_RED, GL_FLOAT,
+                      t->hm->data + r[1] * w + r[0]);
+      t->edited += (GLsizeiptr)(r[2] - r[0] + 1) * (r[3] - r[1] + 1) * sizeof(GLfloat);
+    } else
+      uploadNode(t, 0);
+  }
+  if(t->mode == TERRAIN_GRID) {
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    /* normales à un échantillon autour de chaque région */
+    for(k = 0; k < t->ndirty; k++) {
+      r = t->dirty[k];
+      rect[0] = r[0] > 0 ? r[0] - 1 : 0;
+      rect[1] = r[1] > 0 ? r[1] - 1 : 0;
+      rect[2] = r[2] < w - 1 ? r[2] + 1 : w - 1;
+      rect[3] = r[3] < t->hm->h - 1 ? r[3] + 1 : t->hm->h - 1;
+      gpuGenNormals(t->heightTex, t->normalTex, w, t->hm->h, rect);
+    }
+  } else {
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+  }
+  free(v);
+  t->skirt = t->nodes[0].error / t->hm->scale_y + 0.01f;
+  t->ndirty = 0;
+  t->revision++;
+  return 1;
+}
+
+/*!\brief retouche du nœud id et de ses descendants dont la région
+ * touche le rectangle r élargi d'un pas du nœud (pentes à un
+ * échantillon, altitude sur le parent et triangles du nœud à un pas) :
+ * erreur, bornes et, en mode TERRAIN_MESHES, lignes de sommets
+ * concernées, jupes et texels des enfants (erreur du parent). v reçoit
+ * les sommets d'un maillage au plus ; vertex buffer et texture buffer
+ * des nœuds sont liés par l'appelant. */
+static void editNode(terrain_t * t, int id, const int * r, GLushort * v) {
+  const heightmap_t * hm = &t->pyramid->hm;
+  tnode_t * n = &t->nodes[id];
+  int c, k, i, z, ia = -1, ib = -1, T = t->tile, step = 1 << n->level, grid = (T + 1) * (T + 1);
+  int x0 = r[0] - step, z0 = r[1] - step, x1 = r[2] + step, z1 = r[3] + step;
+  GLsizeiptr stride = VERTEX_SIZE * sizeof *v, base = (GLsizeiptr)id * t->nvertices;
+  GLfloat e, err = n->error;
+  if(x1 < n->x0 || z1 < n->z0 || x0 > n->x0 + n->size || z0 > n->z0 + n->size)
+    return;
+  for(c = 0; c < 4; c++)
+    if(n->children[c] >= 0) {
+      editNode(t, n->children[c], r, v);
+      if(t->nodes[n->children[c]].error > err)
+        err = t->nodes[n->children[c]].error;
+    }
+  if((e = nodeError(hm, n, x0, z0, x1, z1)) > err)
+    err = e;
+  n->error = err;
+  if(id == 0)
+    n->perror = err;
+  for(c = 0; c < 4; c++)
+    if(n->children[c] >= 0) {
+      t->nodes[n->children[c]].perror = err;
+      if(t->mode != TERRAIN_GRID)
+        uploadNode(t, n->children[c]);
+    }
+  nodeBounds(t, t->pyramid, n);
+  if(t->mode == TERRAIN_GRID)
+    return;
+  /* lignes de la grille dont l'échantillon (borné à la carte) est dans
+   * [z0, z1], contiguës puisque z croît avec la ligne */
+  for(i = 0; i <= T; i++) {
+    z = n->z0 + i * step;
+    z = z < hm->h - 1 ? z : hm->h - 1;
+    if(z >= z0 && z <= z1) {
+      ia = ia < 0 ? i : ia;
+      ib = i;
+    }
+  }
+  if(ia >= 0) {
+    for(k = ia * (T + 1); k < (ib + 1) * (T + 1); k++)
+      meshVertex(t, hm, n, k, &v[(k - ia * (T + 1)) * VERTEX_SIZE]);
+    glBufferSubData(GL_ARRAY_BUFFER, (base + ia * (T + 1)) * stride, (ib - ia + 1) * (T + 1) * stride, v);
+    t->edited += (ib - ia + 1) * (T + 1) * stride;
+  }
+  /* jupes, à la suite de la grille : copies abaissées des bords */
+  for(k = grid; k < t->nvertices; k++)
+    meshVertex(t, hm, n, k, &v[(k - grid) * VERTEX_SIZE]);
+  glBufferSubData(GL_ARRAY_BUFFER, (base + grid) * stride, (t->nvertices - grid) * stride, v);
+  t->edited += (t->nvertices - grid) * stride;
+}
+
+/*!\brief envoi des texels du seul nœud id, texture buffer des nœuds
+ * liée par l'appelant */
+static void uploadNode(const terrain_t * t, int id) {
+  const tnode_t * n = &t->nodes[id];
+  GLfloat v[NODE_TEXELS * 4] = {n->x0, n->z0, 1 << n->level, n->error, n->perror, 0.0f, 0.0f, 0.0f};
+  glBufferSubData(GL_TEXTURE_BUFFER, id * sizeof v, sizeof v, v);
+}
+
+/*!\brief l'extension name est-elle disponible ? */
+static int hasExtension(const char * name) {
+  GLint i, n = 0;
+  glGetIntegerv(GL_NUM_EXTENSIONS, &n);
+  for(i = 0; i < n; i++)
+    if(!strcmp((const char *)glGetStringi(GL_EXTENSIONS, i), name))
+      return 1;
+  return 0;
+}
+
+/*!\brief tampon de transfert, projeté une fois pour toutes
+ * (persistant et cohérent) si GL_ARB_buffer_storage est disponible,
+ * à chaque segment sinon */
+static void buildRing(terrain_t * t) {
+  GLsizeiptr size = TERRAIN_RING_SEGMENTS * (GLsizeiptr)TERRAIN_RING_SEGMENT;
+  GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+  glGenBuffers(1, &t->ring);
+  glBindBuffer(GL_COPY_READ_BUFFER, t->ring);
+  if(hasExtension("GL_ARB_buffer_storage")) {
+    glBufferStorage(GL_COPY_READ_BUFFER, size, NULL, flags);
+    t->ringPtr = glMapBufferRange(GL_COPY_READ_BUFFER, 0, size, flags);
+  } else
+    glBufferData(GL_COPY_READ_BUFFER, size, NULL, GL_STREAM_DRAW);
+  glBindBuffer(GL_COPY_READ_BUFFER, 0);
+  resTrack(RES_BUFFER, t->ring, RES_TERRAIN, size);
+}
+
+/*!\brief copie, segment par segment, d'au plus budget octets de l'état
+ * préparé dans le vertex buffer ou la texture suivants ; s'arrête au
+ * premier segment encore lu par le GPU */
+static void uploadSlices(terrain_t * t, GLsizeiptr budget) {
+  int grid = t->mode == TERRAIN_GRID;
+  GLenum target = grid ? GL_PIXEL_UNPACK_BUFFER : GL_COPY_READ_BUFFER;
+  GLsizeiptr n, row = t->hm->w * sizeof(GLfloat), done = 0;
+  GLintptr offset;
+  const GLubyte * src = grid ? (const GLubyte *)t->nextData : (const GLubyte *)t->staging;
+  GLubyte * dst;
+  GLsync * f;
+  assert(!grid || row <= TERRAIN_RING_SEGMENT);
+  glBindBuffer(target, t->ring);
+  if(grid) {
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D, t->nextTex);
+  } else
+    glBindBuffer(GL_COPY_WRITE_BUFFER, t->nextVbo);
+  while(t->uploaded < t->staged && done < budget) {
+    f = &t->fences[t->segment];
+    if(*f) {
+      if(glClientWaitSync(*f, 0, 0) == GL_TIMEOUT_EXPIRED)
+        break;
+      glDeleteSync(*f);
+      *f = 0;
+    }
+    n = t->staged - t->uploaded;
+    n = n < TERRAIN_RING_SEGMENT ? n : TERRAIN_RING_SEGMENT;
+    n = n < budget - done ? n : budget - done;
+    /* des lignes entières de la texture, au moins une */
+    if(grid)
+      n = n < row ? row : n - n % row;
+    offset = t->segment * (GLintptr)TERRAIN_RING_SEGMENT;
+    dst = t->ringPtr ? t->ringPtr + offset :
+      glMapBufferRange(target, offset, n, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    memcpy(dst, src + t->uploaded, n);
+    if(!t->ringPtr)
+      glUnmapBuffer(target);
+    if(grid)
+      glTexSubImage2D(GL_TEXTURE_2D, 0, 0, t->uploaded / row, t->hm->w, n / row, GL_RED, GL_FLOAT, (const GLvoid *)offset);
+    else
+      glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, offset, t->uploaded, n);
+    *f = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    t->uploaded += n;
+    done += n;
+    t->segment = (t->segment + 1) % TERRAIN_RING_SEGMENTS;
+  }
+  glBindBuffer(target, 0);
+  if(grid)
+    glBindTexture(GL_TEXTURE_2D, 0);
+  else
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+/*!\brief construction récursive, dans nodes, du nœud de niveau level
+ * d'origine (x0, z0) pour les altitudes de la pyramide p : boîte
+ * englobante et erreur géométrique. Retourne son indice. */
+static int buildNode(const terrain_t * t, const hpyramid_t * p, tnode_t * nodes, int * count, int level, int x0, int z0) {
+  const heightmap_t * hm = &p->hm;
+  int id = (*count)++, c, x, z;
+  GLfloat e, err = 0.0f;
+  tnode_t * n = &nodes[id];
+  n->level = level;
+  n->x0 = x0;
+  n->z0 = z0;
+  n->size = t->tile << level;
+  for(c = 0; c < 4; c++) {
+    n->children[c] = -1;
+    if(level > 0) {
+      x = x0 + (c & 1) * (n->size >> 1);
+      z = z0 + (c >> 1) * (n->size >> 1);
+      if(x < hm->w - 1 && z < hm->h - 1) {
+        n->children[c] = buildNode(t, p, nodes, count, level - 1, x, z);
+        if(err < nodes[n->children[c]].error)
+          err = nodes[n->children[c]].error;
+      }
+    }
+  }
+  if((e = nodeError(hm, n, x0, z0, x0 + n->size, z0 + n->size)) > err)
+    err = e;
+  n->error = err;
+  /* le morphing d'un nœud s'achève à la distance où son parent serait
+   * retenu ; la racine, sans parent, ne se déforme pas */
+  n->perror = err;
+  for(c = 0; c < 4; c++)
+    if(n->children[c] >= 0)
+      nodes[n->children[c]].perror = err;
+  nodeBounds(t, p, n);
+  return id;
+}
+
+/*!\brief écart vertical maximal (monde) entre les échantillons de
+ * [x0, x1] x [z0, z1] situés dans la région du nœud n et le triangle du
+ * maillage du nœud qui les recouvre (diagonale de (i, j + 1) à (i + 1,
+ * j)) ; un nœud de niveau 0 reproduit exactement la heightMap */
+static GLfloat nodeError(const heightmap_t * hm, const tnode_t * n, int x0, int z0, int x1, int z1) {
+  int x, z, i, j, step = 1 << n->level;
+  GLfloat h, a, fx, fz, e, err = 0.0f;
+  x0 = x0 > n->x0 ? x0 : n->x0;
+  z0 = z0 > n->z0 ? z0 : n->z0;
+  x1 = x1 < n->x0 + n->size ? x1 : n->x0 + n->size;
+  z1 = z1 < n->z0 + n->size ? z1 : n->z0 + n->size;
+  x1 = x1 < hm->w - 1 ? x1 : hm->w - 1;
+  z1 = z1 < hm->h - 1 ? z1 : hm->h - 1;
+  for(z = z0; n->level > 0 && z <= z1; z++) {
+    for(x = x0; x <= x1; x++) {
+      h = sample(hm, x, z);
+      j = (x - n->x0) / step; fx = ((x - n->x0) - j * step) / (GLfloat)step;
+      i = (z - n->z0) / step; fz = ((z - n->z0) - i * step) / (GLfloat)step;
+      j = n->x0 + j * step; i = n->z0 + i * step;
+      if(fx + fz <= 1.0f)
+        a = sample(hm, j, i) + fx * (sample(hm, j + step, i) - sample(hm, j, i)) + fz * (sample(hm, j, i + step) - sample(hm, j, i));
+      else
+        a = sample(hm, j + step, i + step) + (1.0f - fx) * (sample(hm, j, i + step) - sample(hm, j + step, i + step)) +
+          (1.0f - fz) * (sample(hm, j + step, i) - sample(hm, j + step, i + step));
+      e = 2.0f * fabsf(h - a) * hm->scale_y;
+      if(e > err) err = e;
+    }
+  }
+  return err;
+}
+
+/*!\brief boîte englobante et altitude minimale de chaque cellule du
+ * nœud n (bornes incluses) lues dans la pyramide p : le nœud est la
+ * cellule (z0, x0) >> l du niveau l = level + log2(tile) ; une cellule
+ * hors de la carte ne masque rien */
+static void nodeBounds(const terrain_t * t, const hpyramid_t * p, tnode_t * n) {
+  const heightmap_t * hm = &p->hm;
+  int c, l, x1, z1;
+  GLfloat a, h, ymin, ymax;
+  x1 = n->x0 + n->size < hm->w - 1 ? n->x0 + n->size : hm->w - 1;
+  z1 = n->z0 + n->size < hm->h - 1 ? n->z0 + n->size : hm->h - 1;
+  for(l = n->level; (1 << (l - n->level)) < t->tile; l++);
+  hpyramidCell(p, l, n->z0 >> l, n->x0 >> l, &ymin, &ymax);
+  for(c = 0, l -= t->cellshift; c < TERRAIN_CELLS * TERRAIN_CELLS; c++) {
+    hpyramidCell(p, l, (n->z0 >> l) + c / TERRAIN_CELLS, (n->x0 >> l) + c % TERRAIN_CELLS, &a, &h);
+    n->cellmin[c] = a > 1.0f ? -HUGE_VALF : (2.0f * a - 1.0f) * hm->scale_y;
+  }
+  n->bmin[0] = (-1.0f + 2.0f * n->x0 / (hm->w - 1)) * hm->scale_xz;
+  n->bmax[0] = (-1.0f + 2.0f * x1 / (hm->w - 1)) * hm->scale_xz;
+  n->bmin[1] = (2.0f * ymin - 1.0f) * hm->scale_y;
+  n->bmax[1] = (2.0f * ymax - 1.0f) * hm->scale_y;
+  n->bmin[2] = (1.0f - 2.0f * z1 / (hm->h - 1)) * hm->scale_xz;
+  n->bmax[2] = (1.0f - 2.0f * n->z0 / (hm->h - 1)) * hm->scale_xz;
+}
+
+/*!\brief altitude [0, 1] quantifiée sur 16 bits */
+static inline GLushort quantize(GLfloat h) {
+  return (GLushort)(65535.0f * (h < 0.0f ? 0.0f : (h > 1.0f ? 1.0f : h)) + 0.5f);
+}
+
+/*!\brief projection octaèdre de la normale unitaire (nx, ny, nz) sur
+ * deux composantes signées normalisées ; inverse dans shaders/mesh.vs */
+static void octahedron(GLfloat nx, GLfloat ny, GLfloat nz, GLshort * e) {
+  GLfloat l = fabsf(nx) + fabsf(ny) + fabsf(nz), u = nx / l, v = nz / l, a;
+  if(ny < 0.0f) {
+    a = u;
+    u = (1.0f - fabsf(v)) * (a < 0.0f ? -1.0f : 1.0f);
+    v = (1.0f - fabsf(a)) * (v < 0.0f ? -1.0f : 1.0f);
+  }
+  e[0] = (GLshort)lrintf(32767.0f * u);
+  e[1] = (GLshort)lrintf(32767.0f * v);
+}
+
+/*!\brief sommet compact de l'échantillon (x, z) : altitude, altitude
+ * coarse sur le maillage du parent et normale */
+static void vertex(const heightmap_t * hm, int x, int z, GLfloat coarse, GLushort * v) {
+  int xl, xr, zu, zd;
+  GLfloat dx, dz, n;
+  x = x < hm->w - 1 ? x : hm->w - 1;
+  z = z < hm->h - 1 ? z : hm->h - 1;
+  xl = x > 0 ? x - 1 : x; xr = x < hm->w - 1 ? x + 1 : x;
+  zu = z > 0 ? z - 1 : z; zd = z < hm->h - 1 ? z + 1 : z;
+  /* pentes dy/dx et dy/dz en coordonnées modèle */
+  dx =  (sample(hm, xr, z) - sample(hm, xl, z)) * (hm->w - 1) / (xr - xl);
+  dz = -(sample(hm, x, zd) - sample(hm, x, zu)) * (hm->h - 1) / (zd - zu);
+  n = sqrtf(dx * dx + 1.0f + dz * dz);
+  v[0] = quantize(sample(hm, x, z));
+  v[1] = quantize(coarse);
+  octahedron(-dx / n, 1.0f / n, -dz / n, (GLshort *)&v[2]);
+}
+
+/*!\brief altitude [0, 1], sur le maillage de son parent de pas 2 step,
+ * du sommet (i, j) d'un nœud de pas step : un sommet impair y est au
+ * milieu d'une arête, horizontale, verticale ou diagonale de (i - 1, j
+ * + 1) à (i + 1, j - 1) (cf. buildNode) */
+static GLfloat coarseHeight(const heightmap_t * hm, int x, int z, int i, int j, int step) {
+  int ex = (j & 1) * step, ez = -(i & 1) * step;
+  x = x < hm->w - 1 ? x : hm->w - 1;
+  z = z < hm->h - 1 ? z : hm->h - 1;
+  return 0.5f * (sample(hm, x + ex, z + ez) + sample(hm, x - ex, z - ez));
+}
+
+/*!\brief maillage du nœud n dans v : grille puis, pour chacun des 4
+ * bords, tile + 1 sommets de jupe (abaissés dans le vertex shader). La
+ * racine, sans parent, ne se déforme pas. */
+static void buildMesh(const terrain_t * t, const heightmap_t * hm, const tnode_t * n, GLushort * v) {
+  int k;
+  for(k = 0; k < t->nvertices; k++, v += VERTEX_SIZE)
+    meshVertex(t, hm, n, k, v);
+}
+
+/*!\brief sommet k du maillage du nœud n (cf. buildMesh) */
+static void meshVertex(const terrain_t * t, const heightmap_t * hm, const tnode_t * n, int k, GLushort * v) {
+  int i, j, e, x, z, T = t->tile, root = n->level == t->levels - 1;
+  int step = 1 << n->level;
+  if(k < (T + 1) * (T + 1)) {
+    i = k / (T + 1); j = k % (T + 1);
+  } else {
+    e = (k - (T + 1) * (T + 1)) / (T + 1); j = (k - (T + 1) * (T + 1)) % (T + 1);
+    i = e == 0 ? 0 : (e == 1 ? T : j);
+    j = e < 2 ? j : (e == 2 ? 0 : T);
+  }
+  x = n->x0 + j * step; z = n->z0 + i * step;
+  vertex(hm, x, z, root ? sample(hm, x < hm->w - 1 ? x : hm->w - 1, z < hm->h - 1 ? z : hm->h - 1) :
+         coarseHeight(hm, x, z, i, j, step), v);
+}
+
+/*!\brief vertex array et vertex buffer unique des maillages de tous
+ * les nœuds (TERRAIN_MESHES) */
+static void buildMeshBuffer(terrain_t * t, GLuint * vao, GLuint * vbo) {
+  GLsizei stride = VERTEX_SIZE * sizeof(GLushort);
+  t->vbytes = (GLsizeiptr)t->nnodes * t->nvertices * stride;
+  glGenVertexArrays(1, vao);
+  glBindVertexArray(*vao);
+  glGenBuffers(1, vbo);
+  glBindBuffer(GL_ARRAY_BUFFER, *vbo);
+  glBufferData(GL_ARRAY_BUFFER, t->vbytes, NULL, GL_STATIC_DRAW);
+  resTrack(RES_BUFFER, *vbo, RES_TERRAIN, t->vbytes);
+  glEnableVertexAttribArray(0);
+  glEnableVertexAttribArray(1);
+  glVertexAttribPointer(0, 2, GL_UNSIGNED_SHORT, GL_TRUE, stride, (const void *)0);
+  glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, stride, (const void *)(2 * sizeof(GLushort)));
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, t->ibo);
+  glBindVertexArray(0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/*!\brief texture buffer des nœuds (TERRAIN_MESHES), lue par le vertex
+ * shader pour replacer les sommets de chaque tuile */
+static void buildNodeTexture(terrain_t * t) {
+  glGenBuffers(1, &t->nodeBuffer);
+  glBindBuffer(GL_TEXTURE_BUFFER, t->nodeBuffer);
+  glBufferData(GL_TEXTURE_BUFFER, t->nnodes * NODE_TEXELS * 4 * sizeof(GLfloat), NULL, GL_DYNAMIC_DRAW);
+  resTrack(RES_BUFFER, t->nodeBuffer, RES_TERRAIN, t->nnodes * NODE_TEXELS * 4 * sizeof(GLfloat));
+  glGenTextures(1, &t->nodeTex);
+  glBindTexture(GL_TEXTURE_BUFFER, t->nodeTex);
+  glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, t->nodeBuffer);
+  glBindTexture(GL_TEXTURE_BUFFER, 0);
+  glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+/*!\brief envoi de l'origine, du pas et des erreurs des nœuds courants */
+static void uploadNodes(const terrain_t * t) {
+  int i;
+  GLfloat * texels = malloc(t->nnodes * NODE_TEXELS * 4 * sizeof *texels), * v = texels;
+  assert(texels);
+  for(i = 0; i < t->nnodes; i++, v += NODE_TEXELS * 4) {
+    const tnode_t * n = &t->nodes[i];
+    v[0] = n->x0; v[1] = n->z0; v[2] = 1 << n->level; v[3] = n->error;
+    v[4] = n->perror; v[5] = v[6] = v[7] = 0.0f;
+  }
+  glBindBuffer(GL_TEXTURE_BUFFER, t->nodeBuffer);
+  glBufferSubData(GL_TEXTURE_BUFFER, 0, t->nnodes * NODE_TEXELS * 4 * sizeof *texels, texels);
+  glBindBuffer(GL_TEXTURE_BUFFER, 0);
+  free(texels);
+}
+
+/*!\brief grille partagée (TERRAIN_GRID) : mêmes sommets, dans le
+ * même ordre, que ceux de buildMesh, réduits à (colonne, ligne,
+ * jupe) ; instance buffer et texture d'altitudes */
+static void buildGrid(terrain_t * t) {
+  int i, j, e, k, T = t->tile, nv = t->nvertices;
+  GLubyte * buffer = malloc(nv * GRID_VERTEX_SIZE), * v = buffer;
+  assert(buffer);
+  for(i = 0; i <= T; i++)
+    for(j = 0; j <= T; j++, v += GRID_VERTEX_SIZE) {
+      v[0] = j; v[1] = i; v[2] = 0; v[3] = 0;
+    }
+  for(e = 0; e < 4; e++)
+    for(k = 0; k <= T; k++, v += GRID_VERTEX_SIZE) {
+      v[0] = e < 2 ? k : (e == 2 ? 0 : T);
+      v[1] = e == 0 ? 0 : (e == 1 ? T : k);
+      v[2] = 1; v[3] = 0;
+    }
+  t->vbytes = nv * GRID_VERTEX_SIZE;
+  glGenVertexArrays(1, &t->vao);
+  glBindVertexArray(t->vao);
+  glGenBuffers(1, &t->vbo);
+  glBindBuffer(GL_ARRAY_BUFFER, t->vbo);
+  glBufferData(GL_ARRAY_BUFFER, nv * GRID_VERTEX_SIZE, buffer, GL_STATIC_DRAW);
+  resTrack(RES_BUFFER, t->vbo, RES_TERRAIN, nv * GRID_VERTEX_SIZE);
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(0, 3, GL_UNSIGNED_BYTE, GL_FALSE, GRID_VERTEX_SIZE, (const void *)0);
+  /* un jeu d'attributs de tuile par instance, rempli à chaque dessin */
+  glGenBuffers(1, &t->ibuffer);
+  glBindBuffer(GL_ARRAY_BUFFER, t->ibuffer);
+  glEnableVertexAttribArray(3);
+  glEnableVertexAttribArray(4);
+  glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, TERRAIN_INSTANCE_SIZE * sizeof(GLfloat), (const void *)0);
+  glVertexAttribPointer(4, 2, GL_FLOAT, GL_FALSE, TERRAIN_INSTANCE_SIZE * sizeof(GLfloat), (const void *)(3 * sizeof(GLfloat)));
+  glVertexAttribDivisor(3, 1);
+  glVertexAttribDivisor(4, 1);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, t->ibo);
+  glBindVertexArray(0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  free(buffer);
+  t->heightTex = heightTexture(t);
+  t->normalTex = normalTexture(t);
+  /* altitudes et normales font ici partie des données de sommets */
+  t->vbytes += t->hm->w * (GLsizeiptr)t->hm->h * (sizeof(GLfloat) + sizeof(GLuint));
+}
+
+/*!\brief patchs de tessellation (TERRAIN_GRID) : quatre coins par
+ * patch, en échantillons (colonne, ligne), dans l'ordre (x0, z0), (x1,
+ * z0), (x1, z1), (x0, z1) ; les derniers sont tronqués au bord de la
+ * carte */
+static void buildPatches(terrain_t * t) {
+  int i, j, k, nx = (t->hm->w - 2) / TERRAIN_PATCH + 1, nz = (t->hm->h - 2) / TERRAIN_PATCH + 1;
+  GLushort * buffer = malloc(nx * nz * 8 * sizeof *buffer), * v = buffer;
+  assert(buffer);
+  for(i = 0; i < nz; i++)
+    for(j = 0; j < nx; j++)
+      for(k = 0; k < 4; k++, v += 2) {
+        int x = (j + (k == 1 || k == 2)) * TERRAIN_PATCH, z = (i + (k >= 2)) * TERRAIN_PATCH;
+        v[0] = x < t->hm->w - 1 ? x : t->hm->w - 1;
+        v[1] = z < t->hm->h - 1 ? z : t->hm->h - 1;
+      }
+  t->npatches = nx * nz;
+  glGenVertexArrays(1, &t->patchVao);
+  glBindVertexArray(t->patchVao);
+  glGenBuffers(1, &t->patchVbo);
+  glBindBuffer(GL_ARRAY_BUFFER, t->patchVbo);
+  glBufferData(GL_ARRAY_BUFFER, t->npatches * 8 * sizeof *buffer, buffer, GL_STATIC_DRAW);
+  resTrack(RES_BUFFER, t->patchVbo, RES_TERRAIN, t->npatches * 8 * sizeof *buffer);
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(0, 2, GL_UNSIGNED_SHORT, GL_FALSE, 0, (const void *)0);
+  glBindVertexArray(0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  free(buffer);
+}
+
+/*!\brief texture d'altitudes, lue par texelFetch : pas de filtrage,
+ * pas de mipmaps */
+static GLuint heightTexture(const terrain_t * t) {
+  GLuint id;
+  glGenTextures(1, &id);
+  glBindTexture(GL_TEXTURE_2D, id);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, t->hm->w, t->hm->h, 0, GL_RED, GL_FLOAT, NULL);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  resTrack(RES_TEXTURE, id, RES_TERRAIN, t->hm->w * (size_t)t->hm->h * sizeof(GLfloat));
+  return id;
+}
+
+/*!\brief texture des normales (modèle, encodées dans [0, 1]), écrite
+ * par gpuGenNormals et lue par texelFetch */
+static GLuint normalTexture(const terrain_t * t) {
+  GLuint id;
+  glGenTextures(1, &id);
+  glBindTexture(GL_TEXTURE_2D, id);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB10_A2, t->hm->w, t->hm->h, 0, GL_RGBA, GL_UNSIGNED_INT_2_10_10_10_REV, NULL);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  resTrack(RES_TEXTURE, id, RES_TERRAIN, t->hm->w * (size_t)t->hm->h * sizeof(GLuint));
+  return id;
+}
+
+/*!\brief copie GPU à GPU du niveau 0 de src dans dst (w x h, mêmes
+ * formats) : glCopyImageSubData si disponible, sinon glBlitFramebuffer
+ * entre deux framebuffers temporaires */
+static void copyTexture(GLuint src, GLuint dst, int w, int h) {
+  GLuint fbo[2];
+  GLint read, draw;
+  if(hasExtension("GL_ARB_copy_image")) {
+    glCopyImageSubData(src, GL_TEXTURE_2D, 0, 0, 0, 0, dst, GL_TEXTURE_2D, 0, 0, 0, 0, w, h, 1);
+    return;
+  }
+  glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &read);
+  glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &draw);
+  glGenFramebuffers(2, fbo);
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo[0]);
+  glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, src, 0);
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbo[1]);
+  glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, dst, 0);
+  glBlitFramebuffer(0, 0, w, h, 0, 0, w, h, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, read);
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, draw);
+  glDeleteFramebuffers(2, fbo);
+}
+
+/*!\brief index buffer commun à tous les nœuds. Les triangles de la
+ * grille sont orientés vers +y, ceux des jupes vers l'extérieur de la
+ * tuile (les bords 0 et 3, en z et x maximaux, et les bords 1 et 2 ont
+ * des orientations opposées). */
+static void buildIndices(terrain_t * t) {
+  int i, j, e, k, T = t->tile, W = T + 1, s;
+  GLushort * idx, * p, a, b, c, d;
+  t->nindices = 6 * T * T + 4 * 6 * T;
+  idx = p = malloc(t->nindices * sizeof *idx);
+  assert(idx);
+  for(i = 0; i < T; i++)
+    for(j = 0; j < T; j++) {
+      a = i * W + j; b = a + 1; c = a + W; d = c + 1;
+      *p++ = a; *p++ = b; *p++ = c;
+      *p++ = b; *p++ = d; *p++ = c;
+    }
+  for(e = 0; e < 4; e++)
+    for(k = 0; k < T; k++) {
+      s = W * W + e * W + k;
+      a = e == 0 ? k : (e == 1 ? T * W + k : (e == 2 ? k * W : k * W + T));
+      b = e < 2 ? a + 1 : a + W;
+      c = s; d = s + 1;
+      if(e == 0 || e == 3) {
+        *p++ = a; *p++ = c; *p++ = b;
+        *p++ = b; *p++ = c; *p++ = d;
+      } else {
+        *p++ = a; *p++ = b; *p++ = c;
+        *p++ = b; *p++ = d; *p++ = c;
+      }
+    }
+  /* la grille parcourue ligne par ligne retransforme chaque ligne dès
+   * qu'elle dépasse le cache ; même tuile pour tous les nœuds, un seul
+   * réordonnancement */
+  t->acmrRows = vcacheACMR(idx, t->nindices, t->nvertices);
+  vcacheOptimize(idx, t->nindices, t->nvertices);
+  t->acmr = vcacheACMR(idx, t->nindices, t->nvertices);
+  glGenBuffers(1, &t->ibo);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, t->ibo);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, t->nindices * sizeof *idx, idx, GL_STATIC_DRAW);
+  resTrack(RES_BUFFER, t->ibo, RES_TERRAIN, t->nindices * sizeof *idx);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+  free(idx);
+}
+
+/*!\brief distance de eye à la boîte englobante du nœud n */
+static inline GLfloat boxDistance(const tnode_t * n, const GLfloat eye[3]) {
+  int i;
+  GLfloat d, d2 = 0.0f;
+  for(i = 0; i < 3; i++) {
+    d = eye[i] < n->bmin[i] ? n->bmin[i] - eye[i] : (eye[i] > n->bmax[i] ? eye[i] - n->bmax[i] : 0.0f);
+    d2 += d * d;
+  }
+  return sqrtf(d2);
+}
+
+/*!\brief test de la boîte du nœud n contre les plans de p dont le bit
+ * est levé dans mask. Retourne -1 si la boîte est hors d'un plan,
+ * sinon mask privé des plans qui la contiennent entièrement. */
+static int frustumTest(const GLfloat planes[6][4], const tnode_t * n, int mask) {
+  int p;
+  const GLfloat * pl;
+  for(p = 0; p < 6; p++) {
+    if(!(mask & (1 << p)))
+      continue;
+    pl = planes[p];
+    /* sommet le plus avancé puis le plus reculé selon la normale */
+    if(pl[0] * (pl[0] > 0.0f ? n->bmax[0] : n->bmin[0]) +
+       pl[1] * (pl[1] > 0.0f ? n->bmax[1] : n->bmin[1]) +
+       pl[2] * (pl[2] > 0.0f ? n->bmax[2] : n->bmin[2]) + pl[3] < 0.0f)
+      return -1;
+    if(pl[0] * (pl[0] > 0.0f ? n->bmin[0] : n->bmax[0]) +
+       pl[1] * (pl[1] > 0.0f ? n->bmin[1] : n->bmax[1]) +
+       pl[2] * (pl[2] > 0.0f ? n->bmin[2] : n->bmax[2]) + pl[3] >= 0.0f)
+      mask &= ~(1 << p);
+  }
+  return mask;
+}
+
+/*!\brief emprise horizontale du nœud n vue de eye : secteurs [*b0,
+ * *b1] en unités de secteurs (non bornées, à ramener modulo nbins),
+ * distances horizontales minimale et maximale. Retourne 0 si l'œil est
+ * au-dessus de l'emprise. */
+static int footprint(const terrain_t * t, const GLfloat bmin[3], const GLfloat bmax[3], const GLfloat eye[3],
+                     GLfloat * b0, GLfloat * b1, GLfloat * dmin, GLfloat * dmax) {
+  int c;
+  GLfloat dx, dz, ac, a, d, amin = 0.0f, amax = 0.0f, s = t->nbins / (2.0f * M_PI);
+  dx = eye[0] < bmin[0] ? bmin[0] - eye[0] : (eye[0] > bmax[0] ? eye[0] - bmax[0] : 0.0f);
+  dz = eye[2] < bmin[2] ? bmin[2] - eye[2] : (eye[2] > bmax[2] ? eye[2] - bmax[2] : 0.0f);
+  if(dx == 0.0f && dz == 0.0f)
+    return 0;
+  *dmin = sqrtf(dx * dx + dz * dz);
+  *dmax = 0.0f;
+  ac = atan2f(0.5f * (bmin[2] + bmax[2]) - eye[2], 0.5f * (bmin[0] + bmax[0]) - eye[0]);
+  for(c = 0; c < 4; c++) {
+    dx = ((c & 1) ? bmax[0] : bmin[0]) - eye[0];
+    dz = ((c >> 1) ? bmax[2] : bmin[2]) - eye[2];
+    if((d = sqrtf(dx * dx + dz * dz)) > *dmax) *dmax = d;
+    /* l'œil étant hors de l'emprise, elle est vue sous moins de pi */
+    a = atan2f(dz, dx) - ac;
+    a = a > M_PI ? a - 2.0f * M_PI : (a < -M_PI ? a + 2.0f * M_PI : a);
+    if(a < amin) amin = a;
+    if(a > amax) amax = a;
+  }
+  *b0 = (ac + amin) * s;
+  *b1 = (ac + amax) * s;
+  return 1;
+}
+
+static inline int wrapBin(const terrain_t * t, int b) {
+  return ((b % t->nbins) + t->nbins) % t->nbins;
+}
+
+/*!\brief le nœud n est-il entièrement sous l'horizon courant de s ? */
+static int belowHorizon(const terrain_t * t, const tselection_t * s, const tnode_t * n, const GLfloat eye[3]) {
+  int b, e;
+  GLfloat b0, b1, dmin, dmax, m;
+  if(!footprint(t, n->bmin, n->bmax, eye, &b0, &b1, &dmin, &dmax))
+    return 0;
+  /* pente maximale d'un point de la boîte */
+  m = (n->bmax[1] - eye[1]) / (n->bmax[1] > eye[1] ? dmin : dmax);
+  for(b = (int)floorf(b0), e = (int)floorf(b1); b <= e; b++)
+    if(s->horizon[wrapBin(t, b)] < m)
+      return 0;
+  return 1;
+}
+
+/*!\brief rehausse l'horizon de s des secteurs entièrement couverts
+ * par l'emprise de chaque cellule du nœud n, pleine sous son altitude
+ * minimale */
+static void raiseHorizon(const terrain_t * t, tselection_t * s, const tnode_t * n, const GLfloat eye[3]) {
+  int c, b, e, w, x, z, step = n->size / TERRAIN_CELLS;
+  GLfloat b0, b1, dmin, dmax, m, cmin[3], cmax[3];
+  const heightmap_t * hm = t->hm;
+  for(c = 0; c < TERRAIN_CELLS * TERRAIN_CELLS; c++) {
+    if(n->cellmin[c] == -HUGE_VALF)
+      continue;
+    x = n->x0 + (c % TERRAIN_CELLS) * step;
+    z = n->z0 + (c / TERRAIN_CELLS) * step;
+    cmin[0] = (-1.0f + 2.0f * x / (hm->w - 1)) * hm->scale_xz;
+    cmax[0] = (-1.0f + 2.0f * (x + step < hm->w - 1 ? x + step : hm->w - 1) / (hm->w - 1)) * hm->scale_xz;
+    cmin[2] = ( 1.0f - 2.0f * (z + step < hm->h - 1 ? z + step : hm->h - 1) / (hm->h - 1)) * hm->scale_xz;
+    cmax[2] = ( 1.0f - 2.0f * z / (hm->h - 1)) * hm->scale_xz;
+    if(!footprint(t, cmin, cmax, eye, &b0, &b1, &dmin, &dmax))
+      continue;
+    /* borne inférieure, sur chaque rayon de l'emprise, de la pente
+     * au-dessous de laquelle le rayon passe sous l'altitude minimale */
+    m = (n->cellmin[c] - eye[1]) / (n->cellmin[c] < eye[1] ? dmin : dmax);
+    for(b = (int)ceilf(b0), e = (int)floorf(b1) - 1; b <= e; b++)
+      if(s->horizon[w = wrapBin(t, b)] < m)
+        s->horizon[w] = m;
+  }
+}
+
+/*!\brief parcours d'avant en arrière du sous-arbre i, de profondeur
+ * depth ; mask contient les plans du frustum restant à tester. Au-dessus
+ * de v->depth, le nœud couvre, dans l'ordre du parcours, les sous-arbres
+ * [lo, lo + 4^(v->depth - depth)[ de profondeur v->depth : il n'est
+ * parcouru que s'il en partage avec la partie, et n'est compté ou retenu
+ * que par celle de lo. Toutes les parties qui le parcourent prennent les
+ * mêmes décisions de frustum et de niveau de détail ; l'horizon,
+ * rehaussé par tout relief parcouru, reste une borne valide. */
+static void selectNode(const terrain_t * t, tselection_t * s, int i, const view_t * v, int mask, int depth, int lo) {
+  int c, near, span = depth < v->depth ? 1 << 2 * (v->depth - depth) : 1;
+  int own = lo >= v->lo && lo < v->hi;
+  GLfloat sx, sz;
+  const tnode_t * n = &t->nodes[i];
+  if(lo + span <= v->lo || lo >= v->hi)
+    return;
+  s->stats.visited += own;
+  if(mask && (mask = frustumTest(v->planes, n, mask)) < 0) {
+    s->stats.frustum_culled += own;
+    return;
+  }
+  if((t->culling & TERRAIN_CULL_HORIZON) && belowHorizon(t, s, n, v->eye)) {
+    s->stats.horizon_culled += own;
+    return;
+  }
+  /* erreur projetée : error * kscreen / distance, comparée à tau */
+  if(n->level == 0 || n->error * v->kscreen <= s->tau * boxDistance(n, v->eye)) {
+    if(own)
+      s->selected[s->nselected++] = i;
+    if(t->culling & TERRAIN_CULL_HORIZON)
+      raiseHorizon(t, s, n, v->eye);
+    return;
+  }
+  /* l'enfant du côté de l'œil d'abord, le plus opposé en dernier : tout
+   * rayon issu de l'œil traverse les enfants dans cet ordre */
+  sx = (-1.0f + 2.0f * (n->x0 + (n->size >> 1)) / (t->hm->w - 1)) * t->hm->scale_xz;
+  sz = ( 1.0f - 2.0f * (n->z0 + (n->size >> 1)) / (t->hm->h - 1)) * t->hm->scale_xz;
+  near = (v->eye[0] > sx ? 1 : 0) | (v->eye[2] < sz ? 2 : 0);
+  for(c = 0; c < 4; c++)
+    if(n->children[near ^ c] >= 0)
+      selectNode(t, s, n->children[near ^ c], v, mask, depth + 1, lo + c * (span >> 2));
+}
+
+/*!\brief sélection vide pour le terrain t : tableaux dimensionnés pour
+ * tous ses nœuds, selon son mode */
+extern tselection_t * terrainSelectionNew(const terrain_t * t) {
+  tselection_t * s = calloc(1, sizeof *s);
+  assert(s);
+  s->mode = t->mode;
+  s->selected = malloc(t->nnodes * sizeof *s->selected);
+  s->horizon = malloc(t->nbins * sizeof *s->horizon);
+  assert(s->selected && s->horizon);
+  if(t->mode == TERRAIN_GRID) {
+    s->instances = malloc(t->nnodes * TERRAIN_INSTANCE_SIZE * sizeof *s->instances);
+    assert(s->instances);
+  } else {
+    s->counts = malloc(t->nnodes * sizeof *s->counts);
+    s->offsets = malloc(t->nnodes * sizeof *s->offsets);
+    s->basevertex = malloc(t->nnodes * sizeof *s->basevertex);
+    assert(s->counts && s->offsets && s->basevertex);
+  }
+  s->tau = t->tau;
+  return s;
+}
+
+extern void terrainSelectionDelete(tselection_t * s) {
+  if(!s)
+    return;
+  free(s->selected);
+  free(s->horizon);
+  free(s->instances);
+  free(s->counts);
+  free(s->offsets);
+  free(s->basevertex);
+  free(s);
+}
+
+/*!\brief partie part (sur nparts) de la sélection des nœuds à
+ * dessiner pour un œil en eye (monde), écrite dans s ; kscreen est le
+ * nombre de pixels couverts par une unité à distance 1 (largeur du
+ * viewport / (2 tan(fovx / 2))) et viewProjection la matrice projection
+ * x vue (monde vers clip, rangée par lignes comme celles de
+ * GL4Dummies). Les sous-arbres d'une profondeur de découpe (au moins
+ * quatre par partie si l'arbre le permet) sont répartis en plages
+ * contiguës, dans l'ordre d'avant en arrière ; chaque partie a son
+ * propre horizon, qui n'élimine donc rien derrière le relief d'une
+ * partie précédente. Les parties d'une même vue peuvent tourner en
+ * parallèle, puis sont réunies par terrainSelectMerge. */
+extern void terrainSelectPart(const terrain_t * t, tselection_t * s, int part, int nparts, const GLfloat eye[3],
+                              GLfloat kscreen, const GLfloat * viewProjection) {
+  int p, i, slots;
+  view_t v;
+  const GLfloat * m = viewProjection;
+  v.eye[0] = eye[0]; v.eye[1] = eye[1]; v.eye[2] = eye[2];
+  v.kscreen = kscreen;
+  /* plans gauche, droit, bas, haut, proche et lointain : ligne 3 +/-
+   * ligne 0, 1 puis 2 */
+  for(p = 0; p < 6; p++)
+    for(i = 0; i < 4; i++)
+      v.planes[p][i] = m[12 + i] + ((p & 1) ? -1.0f : 1.0f) * m[4 * (p >> 1) + i];
+  for(v.depth = 0; v.depth < t->levels - 1 && (1 << 2 * v.depth) < 4 * nparts; v.depth++);
+  slots = 1 << 2 * v.depth;
+  v.lo = part * slots / nparts;
+  v.hi = (part + 1) * slots / nparts;
+  assert(s->mode == t->mode);
+  for(i = 0; i < t->nbins; i++)
+    s->horizon[i] = -HUGE_VALF;
+  s->nselected = 0;
+  s->tau = t->tau;
+  memset(&s->stats, 0, sizeof s->stats);
+  selectNode(t, s, 0, &v, (t->culling & TERRAIN_CULL_FRUSTUM) ? 0x3F : 0, 0, 0);
+}
+
+/*!\brief réunion dans s, dans l'ordre, des nœuds et statistiques des
+ * nparts parties de sélection parts (s peut être la seule), puis
+ * paramètres du dessin. Si un budget est fixé, tau est ajusté pour la
+ * sélection suivante. */
+extern void terrainSelectMerge(terrain_t * t, tselection_t * s, tselection_t * const * parts, int nparts,
+                               GLfloat kscreen) {
+  int p, i, count = 0;
+  tstats_t st = {0, 0, 0, 0, 0};
+  assert(s->mode == t->mode);
+  for(p = 0; p < nparts; p++) {
+    const tselection_t * q = parts[p];
+    if(q != s)
+      memcpy(&s->selected[count], q->selected, q->nselected * sizeof *s->selected);
+    count += q->nselected;
+    st.visited += q->stats.visited;
+    st.frustum_culled += q->stats.frustum_culled;
+    st.horizon_culled += q->stats.horizon_culled;
+  }
+  s->nselected = count;
+  s->stats = st;
+  s->tau = t->tau;
+  /* un nœud est retenu au-delà de la distance error x lodScale */
+  s->lodScale = kscreen / s->tau;
+  s->stats.drawn = s->nselected;
+  /* paramètres du dessin en un appel */
+  for(i = 0; i < s->nselected; i++) {
+    if(t->mode == TERRAIN_GRID) {
+      GLfloat * in = &s->instances[i * TERRAIN_INSTANCE_SIZE];
+      const tnode_t * n = &t->nodes[s->selected[i]];
+      in[0] = n->x0; in[1] = n->z0;
+      in[2] = 1 << n->level;
+      in[3] = n->error;
+      in[4] = n->perror;
+    } else {
+      s->counts[i] = t->nindices;
+      s->offsets[i] = (const GLvoid *)0;
+      s->basevertex[i] = s->selected[i] * t->nvertices;
+    }
+  }
+  s->stats.triangles = s->nselected * 2 * t->tile * t->tile;
+  if(t->budget > 0) {
+    if(s->stats.triangles > t->budget)
+      t->tau *= 1.1f;
+    else if(s->stats.triangles < 0.8f * t->budget && t->tau > t->tau_min)
+      t->tau = t->tau / 1.1f < t->tau_min ? t->tau_min : t->tau / 1.1f;
+  }
+}
+
+/*!\brief sélection dans s, en une partie, des nœuds à dessiner pour un
+ * œil en eye (monde), cf. terrainSelectPart et terrainSelectMerge */
+extern void terrainSelect(terrain_t * t, tselection_t * s, const GLfloat eye[3], GLfloat kscreen,
+                          const GLfloat * viewProjection) {
+  terrainSelectPart(t, s, 0, 1, eye, kscreen, viewProjection);
+  terrainSelectMerge(t, s, &s, 1, kscreen);
+}
+
+/*!\brief état commun aux dessins : vertex array, altitudes ou nœuds
+ * et uniformes du programme */
+static void drawBegin(const terrain_t * t, GLfloat lodScale) {
+  glBindVertexArray(t->vao);
+  glActiveTexture(GL_TEXTURE0 + (t->mode == TERRAIN_GRID ? TERRAIN_HEIGHT_UNIT : TERRAIN_NODES_UNIT));
+  if(t->mode == TERRAIN_GRID) {
+    glBindTexture(GL_TEXTURE_2D, t->heightTex);
+    glActiveTexture(GL_TEXTURE0 + TERRAIN_NORMAL_UNIT);
+    glBindTexture(GL_TEXTURE_2D, t->normalTex);
+  } else
+    glBindTexture(GL_TEXTURE_BUFFER, t->nodeTex);
+  glActiveTexture(GL_TEXTURE0);
+  glUniform1f(t->skirtLoc, t->skirt);
+  glUniform1f(t->morphLoc, lodScale);
+  if(t->mode != TERRAIN_GRID)
+    glUniform4i(t->gridLoc, t->tile, t->nvertices, t->hm->w - 1, t->hm->h - 1);
+}
+
+static void drawEnd(const terrain_t * t) {
+  if(t->mode == TERRAIN_GRID) {
+    glActiveTexture(GL_TEXTURE0 + TERRAIN_NORMAL_UNIT);
+    glBindTexture(GL_TEXTURE_2D, 0);
+  }
+  glActiveTexture(GL_TEXTURE0 + (t->mode == TERRAIN_GRID ? TERRAIN_HEIGHT_UNIT : TERRAIN_NODES_UNIT));
+  glBindTexture(t->mode == TERRAIN_GRID ? GL_TEXTURE_2D : GL_TEXTURE_BUFFER, 0);
+  glActiveTexture(GL_TEXTURE0);
+  glBindVertexArray(0);
+}
+
+/*!\brief dessin, en un appel, des nœuds de la sélection s ; le
+ * programme et les matrices (incluant la mise à l'échelle de la
+ * heightMap) doivent être en place, ainsi que skirtLoc, morphLoc et, en
+ * mode TERRAIN_MESHES, gridLoc */
+extern void terrainDraw(const terrain_t * t, const tselection_t * s) {
+  if(!s->nselected)
+    return;
+  assert(s->mode == t->mode);
+  if(t->mode == TERRAIN_GRID) {
+    /* réallocation (orphelinage) pour ne pas attendre le GPU */
+    glBindBuffer(GL_ARRAY_BUFFER, t->ibuffer);
+    glBufferData(GL_ARRAY_BUFFER, s->nselected * TERRAIN_INSTANCE_SIZE * sizeof *s->instances, NULL, GL_STREAM_DRAW);
+    resTrack(RES_BUFFER, t->ibuffer, RES_TERRAIN, s->nselected * TERRAIN_INSTANCE_SIZE * sizeof *s->instances);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, s->nselected * TERRAIN_INSTANCE_SIZE * sizeof *s->instances, s->instances);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+  }
+  drawBegin(t, s->lodScale);
+  if(t->mode == TERRAIN_GRID)
+    glDrawElementsInstanced(GL_TRIANGLES, t->nindices, GL_UNSIGNED_SHORT, (const GLvoid *)0, s->nselected);
+  else
+    glMultiDrawElementsBaseVertex(GL_TRIANGLES, s->counts, GL_UNSIGNED_SHORT, s->offsets, s->nselected, s->basevertex);
+  drawEnd(t);
+}
+
+/*!\brief dessin des nœuds choisis sur le GPU (cf. gpucull.h) : la
+ * commande indirecte unique de la grille, dont les instances sont déjà
+ * dans l'instance buffer, ou une commande par nœud des maillages (nulle
+ * pour un nœud écarté), lues dans le buffer commands. Mêmes
+ * prérequis que terrainDraw. */
+extern void terrainDrawIndirect(const terrain_t * t, GLuint commands, GLfloat lodScale) {
+  drawBegin(t, lodScale);
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commands);
+  if(t->mode == TERRAIN_GRID)
+    glDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_SHORT, (const GLvoid *)0);
+  else
+    glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_SHORT, (const GLvoid *)0, t->nnodes, 0);
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+  drawEnd(t);
+}
+
+/*!\brief dessin de toute la carte en patchs de tessellation
+ * (TERRAIN_GRID, npatches non nul), sans sélection : une arête vue sous
+ * pixels pixels reçoit un sommet par pixels pixels ; kscreen comme pour
+ * terrainSelect. Le programme actif (shaders/patch.*) et ses
+ * emplacements tessLoc et boundsLoc sont fixés par l'appelant. */
+extern void terrainDrawPatches(const terrain_t * t, GLfloat kscreen, GLfloat pixels) {
+  assert(t->mode == TERRAIN_GRID && t->npatches);
+  glBindVertexArray(t->patchVao);
+  glActiveTexture(GL_TEXTURE0 + TERRAIN_HEIGHT_UNIT);
+  glBindTexture(GL_TEXTURE_2D, t->heightTex);
+  glActiveTexture(GL_TEXTURE0);
+  glUniform4f(t->tessLoc, kscreen, pixels, TERRAIN_DETAIL, 0.0f);
+  /* altitudes extrêmes (modèle) de la carte, détail compris, pour
+   * l'élimination des patchs hors du frustum */
+  glUniform2f(t->boundsLoc, t->nodes[0].bmin[1] / t->hm->scale_y - TERRAIN_DETAIL,
+              t->nodes[0].bmax[1] / t->hm->scale_y + TERRAIN_DETAIL);
+  glPatchParameteri(GL_PATCH_VERTICES, 4);
+  glDrawArrays(GL_PATCHES, 0, 4 * t->npatches);
+  glActiveTexture(GL_TEXTURE0 + TERRAIN_HEIGHT_UNIT);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glActiveTexture(GL_TEXTURE0);
+  glBindVertexArray(0);
+}
+
+extern void terrainDelete(terrain_t * t) {
+  int i;
+  glDeleteVertexArrays(1, &t->vao);
+  resDeleteBuffers(1, &t->vbo);
+  if(t->mode == TERRAIN_GRID) {
+    resDeleteBuffers(1, &t->ibuffer);
+    glDeleteVertexArrays(1, &t->patchVao);
+    resDeleteBuffers(1, &t->patchVbo);
+    resDeleteTextures(1, &t->heightTex);
+    resDeleteTextures(1, &t->normalTex);
+  } else {
+    glDeleteTextures(1, &t->nodeTex);
+    resDeleteBuffers(1, &t->nodeBuffer);
+  }
+  resDeleteBuffers(1, &t->ibo);
+  glDeleteVertexArrays(1, &t->nextVao);
+  resDeleteBuffers(1, &t->nextVbo);
+  resDeleteTextures(1, &t->nextTex);
+  resDeleteBuffers(1, &t->ring);
+  for(i = 0; i < TERRAIN_RING_SEGMENTS; i++)
+    if(t->fences[i])
+      glDeleteSync(t->fences[i]);
+  resUntrack(RES_HEAP, (uintptr_t)t->staging);
+  free(t->staging);
+  free(t->nodes);
+  free(t->next);
+  hpyramidDelete(t->nextPyramid);
+  hpyramidDelete(t->pyramid);
+  free(t);
+}
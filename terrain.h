@@ -0,0 +1,266 @@
+/*!\file terrain.h
+ *
+ * \brief rendu de terrain par tuiles (chunked LOD) organisées en
+ * quadtree. Chaque nœud du quadtree couvre size x size quads de la
+ * heightMap et possède un maillage de tile x tile quads échantillonnant
+ * la heightMap avec un pas de 2^level. Le niveau de détail de chaque
+ * région est choisi selon l'erreur géométrique du nœud projetée à
+ * l'écran ; les fissures entre niveaux différents sont masquées par des
+ * jupes (skirts) descendant sous les bords de chaque tuile.
+ *
+ * La sélection élimine les nœuds hors du frustum (test de boîte
+ * englobante contre les 6 plans de projection x vue) et ceux cachés
+ * par le relief déjà retenu : le quadtree est parcouru d'avant en
+ * arrière et un horizon angulaire, alimenté par l'altitude minimale
+ * des tuiles dessinées, rejette les nœuds dont l'altitude maximale
+ * reste dessous.
+ *
+ * Deux modes de stockage des sommets : un maillage par nœud
+ * (TERRAIN_MESHES, altitudes et normales précalculées, 8 octets par
+ * sommet, shaders/mesh.vs) ou une grille
+ * plate unique partagée par tous les nœuds (TERRAIN_GRID), déplacée
+ * dans le vertex shader (shaders/terrain.vs) par lecture d'une texture
+ * d'altitudes et d'une texture de normales, calculée sur le GPU à
+ * partir de la première (gpuGenNormals, cf. gpugen.h) ; modifier le
+ * relief revient alors à mettre les textures à jour. Des altitudes
+ * déjà générées sur le GPU y sont copiées sans repasser par la mémoire
+ * centrale (terrainRefreshTextures).
+ *
+ * Quel que soit le nombre de tuiles retenues, le dessin tient en un
+ * appel : glMultiDrawElementsBaseVertex sur le vertex buffer unique
+ * des maillages, ou glDrawElementsInstanced de la grille avec un
+ * instance buffer (origine, pas, morphing) écrit à chaque sélection.
+ * Les nœuds retenus le sont d'avant en arrière (parcours du quadtree,
+ * enfant du côté de l'œil d'abord) et dessinés dans cet ordre : le test
+ * de profondeur précoce rejette ainsi l'essentiel des fragments cachés,
+ * sans tri supplémentaire.
+ *
+ * Pour éviter les sauts (popping) au changement de niveau, chaque
+ * sommet est déformé dans le vertex shader vers l'altitude qu'il aurait
+ * sur le maillage du parent (milieu de l'arête du parent qui le porte)
+ * selon sa distance d à l'œil : rien pour d <= error x lodScale, où le
+ * nœud vient d'être retenu, tout pour d >= perror x lodScale, où son
+ * parent le serait. Juste après une subdivision les enfants reproduisent
+ * donc exactement le parent.
+ *
+ * Une mise à jour du relief peut être étalée : terrainPrepare (tout le
+ * travail CPU, exécutable dans un thread de travail) puis terrainUpload
+ * à chaque frame, qui transfère au plus un budget d'octets par un
+ * tampon de transfert à barrières et bascule vers le nouvel état une
+ * fois complet ; le dessin continue entre-temps avec l'ancien.
+ *
+ * Une retouche locale du relief (cratère, sculpture, cf.
+ * heightmapBrush) ne passe pas par cette reconstruction complète : les
+ * rectangles d'échantillons modifiés sont accumulés (terrainDirty) puis
+ * appliqués (terrainFlush) aux seules cellules de la pyramide, aux seuls
+ * nœuds dont la région les touche (bornes, altitudes minimales, erreur)
+ * et aux seules lignes de sommets concernées, normales comprises, avec
+ * une bordure d'un échantillon (pentes) et d'un pas du nœud (altitude
+ * sur le parent) ; le transfert se limite à ces lignes
+ * (glBufferSubData) ou au rectangle de la texture d'altitudes
+ * (glTexSubImage2D, normales recalculées sur ce rectangle élargi d'un
+ * échantillon). Le coût suit la taille de la retouche, pas celle
+ * de la carte. L'erreur d'un nœud n'y fait que croître : un creux comblé
+ * laisse une erreur surestimée (tuile plus fine que nécessaire) jusqu'à
+ * la prochaine reconstruction.
+ *
+ * En mode TERRAIN_GRID, si le pilote dispose des shaders de
+ * tessellation, la texture d'altitudes peut aussi être dessinée sans
+ * quadtree ni sélection (terrainDrawPatches) : une grille fixe de
+ * patchs de TERRAIN_PATCH x TERRAIN_PATCH échantillons couvre la carte
+ * et chaque arête est subdivisée selon sa longueur projetée
+ * (shaders/patch.tcs), pour une densité de triangles à peu près
+ * constante à l'écran ; deux patchs voisins calculent le même facteur
+ * sur leur arête commune, sans fissure ni jupe. Là où la subdivision
+ * dépasse la résolution de la carte, un détail fBm (bruit de noise.h)
+ * d'amplitude TERRAIN_DETAIL est ajouté au relief (shaders/patch.tes).
+ *
+ * Le résultat d'une sélection (nœuds retenus, paramètres du dessin,
+ * statistiques) est écrit dans un tselection_t fourni par l'appelant et
+ * non dans le terrain : la sélection d'une frame peut ainsi tourner dans
+ * un thread de travail pendant que le thread GL dessine la précédente
+ * avec la sienne. Une sélection peut aussi être découpée en parties
+ * (terrainSelectPart), chacune couvrant une plage de sous-arbres du
+ * quadtree dans l'ordre d'avant en arrière, calculées en parallèle puis
+ * réunies (terrainSelectMerge) ; chaque partie n'ayant que son propre
+ * horizon, l'élimination sous l'horizon est moins efficace qu'en une
+ * partie. Les parties ne font que lire le terrain ; terrainSelectMerge
+ * (et donc terrainSelect) modifie tau quand un budget est fixé. Les
+ * sélections doivent donc être sérialisées entre elles, parties mises
+ * à part, et ne pas chevaucher une modification du terrain
+ * (terrainUpload, terrainFlush, terrainRefresh).
+ *
+ * \author Farès BELHADJ, amsi@ai.univ-paris8.fr
+ * \date October 14 2026
+ */
+#ifndef _TERRAIN_H
+#define _TERRAIN_H
+
+#include "heightmap.h"
+#include "hpyramid.h"
+
+/*!\brief nombre de cellules par côté d'un nœud retenues pour
+ * l'horizon (puissance de 2 divisant la taille des tuiles) */
+#define TERRAIN_CELLS 8
+/*!\brief unité de texture de la texture d'altitudes (mode
+ * TERRAIN_GRID) */
+#define TERRAIN_HEIGHT_UNIT 3
+/*!\brief unité de texture de la texture buffer des nœuds (mode
+ * TERRAIN_MESHES) */
+#define TERRAIN_NODES_UNIT 4
+/*!\brief unité de texture de la texture de normales (mode
+ * TERRAIN_GRID) */
+#define TERRAIN_NORMAL_UNIT 14
+/*!\brief nombre et taille (octets) des segments du tampon de transfert
+ * de terrainUpload */
+#define TERRAIN_RING_SEGMENTS 3
+#define TERRAIN_RING_SEGMENT (1 << 20)
+/*!\brief nombre de rectangles modifiés suivis entre deux terrainFlush,
+ * les plus proches étant fusionnés au-delà */
+#define TERRAIN_DIRTY_RECTS 8
+/*!\brief nombre de flottants par instance (TERRAIN_GRID) : origine (x0,
+ * z0) et pas en échantillons, erreurs du nœud et de son parent
+ * (morphing) */
+#define TERRAIN_INSTANCE_SIZE 5
+/*!\brief échantillons par côté d'un patch de tessellation (facteur
+ * maximal 64 : jusqu'à 4 sommets par échantillon) */
+#define TERRAIN_PATCH 16
+/*!\brief amplitude (altitude modèle) du détail sous l'échantillon des
+ * patchs */
+#define TERRAIN_DETAIL 0.004f
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  typedef struct tnode_t tnode_t;
+  /*!\brief nœud du quadtree de terrain */
+  struct tnode_t {
+    int level;                /* 0 pour le niveau le plus fin */
+    int x0, z0, size;         /* région couverte, en échantillons */
+    GLfloat bmin[3], bmax[3]; /* boîte englobante (monde) */
+    GLfloat error;            /* erreur géométrique (monde) */
+    GLfloat perror;           /* celle du parent (la sienne pour la racine) */
+    GLfloat cellmin[TERRAIN_CELLS * TERRAIN_CELLS]; /* altitudes minimales (monde) */
+    int children[4];          /* indices dans les nœuds, -1 si absent */
+  };
+
+  typedef struct tstats_t tstats_t;
+  /*!\brief statistiques d'une sélection : nœuds visités, rejetés par
+   * le frustum, rejetés par l'horizon, dessinés */
+  struct tstats_t {
+    int visited, frustum_culled, horizon_culled, drawn, triangles;
+  };
+
+  /*!\brief tests de visibilité actifs (champ culling de terrain_t) ;
+   * l'occlusion Hi-Z n'est faite que par le choix sur GPU (cf.
+   * gpucull.h), l'horizon que par terrainSelect */
+  enum tculling_t {
+    TERRAIN_CULL_NONE      = 0,
+    TERRAIN_CULL_FRUSTUM   = 1,
+    TERRAIN_CULL_HORIZON   = 2,
+    TERRAIN_CULL_OCCLUSION = 4,
+    TERRAIN_CULL_ALL       = 7
+  };
+
+  /*!\brief stockage des sommets (champ mode de terrain_t) */
+  enum tmode_t {
+    TERRAIN_MESHES = 0,
+    TERRAIN_GRID   = 1
+  };
+
+  typedef struct terrain_t terrain_t;
+  /*!\brief terrain : quadtree, maillages et sélection courante */
+  struct terrain_t {
+    heightmap_t * hm;
+    hpyramid_t * pyramid;     /* altitudes min/max, bornes des nœuds et picking */
+    int tile, levels;
+    int cellshift;            /* log2(tile / TERRAIN_CELLS) */
+    int mode;                 /* tmode_t */
+    int nnodes;
+    tnode_t * nodes;          /* nodes[0] est la racine */
+    GLuint ibo;
+    GLsizei nindices;
+    GLfloat acmr, acmrRows;   /* ACMR de l'index buffer, et ligne par ligne (cf. vcache.h) */
+    GLfloat skirt;            /* abaissement des jupes (modèle) */
+    GLsizei nvertices;        /* sommets par tuile */
+    GLuint vao, vbo;          /* maillages à la suite ou grille partagée */
+    GLuint heightTex;         /* altitudes (TERRAIN_GRID) */
+    GLuint normalTex;         /* normales (TERRAIN_GRID) */
+    GLuint ibuffer;           /* instance buffer (TERRAIN_GRID) */
+    GLint skirtLoc;           /* uniforme skirt du programme */
+    GLint morphLoc;           /* uniforme morph du programme */
+    GLint gridLoc;            /* uniforme grid du programme (TERRAIN_MESHES) */
+    GLuint nodeBuffer, nodeTex; /* origine, pas et erreurs des nœuds (TERRAIN_MESHES) */
+    GLuint patchVao, patchVbo; /* patchs de tessellation (TERRAIN_GRID) */
+    GLsizei npatches;         /* 0 sans shaders de tessellation */
+    GLint tessLoc;            /* uniforme tess du programme de patchs */
+    GLint boundsLoc;          /* uniforme bounds du programme de patchs */
+    GLsizeiptr vbytes;        /* mémoire des sommets (et altitudes en TERRAIN_GRID) */
+    /* état suivant, préparé par terrainPrepare et transféré par terrainUpload */
+    tnode_t * next;           /* quadtree */
+    hpyramid_t * nextPyramid;
+    GLfloat nextSkirt;
+    const GLfloat * nextData; /* altitudes */
+    GLushort * staging;       /* sommets (TERRAIN_MESHES) */
+    GLsizeiptr staged, uploaded; /* octets à transférer, déjà transférés */
+    GLuint nextVao, nextVbo;  /* maillages en cours de transfert */
+    GLuint nextTex;           /* altitudes en cours de transfert */
+    GLuint ring;              /* tampon de transfert */
+    GLubyte * ringPtr;        /* sa projection persistante, ou NULL */
+    GLsync fences[TERRAIN_RING_SEGMENTS];
+    int segment;              /* prochain segment à remplir */
+    int ndirty;               /* rectangles modifiés (x0, z0, x1, z1 inclus) */
+    int dirty[TERRAIN_DIRTY_RECTS][4];
+    GLsizeiptr edited;        /* octets transférés par le dernier terrainFlush */
+    unsigned int revision;    /* incrémenté à chaque changement des nœuds courants */
+    GLfloat tau;              /* erreur écran tolérée (pixels) */
+    GLfloat tau_min;          /* qualité visée quand le budget le permet */
+    int budget;               /* triangles par frame, 0 pour ne pas réguler */
+    int culling;              /* combinaison de tculling_t */
+    int nbins;                /* secteurs d'azimut de l'horizon */
+  };
+
+  typedef struct tselection_t tselection_t;
+  /*!\brief résultat d'une sélection, lu par terrainDraw ; alloué pour
+   * un terrain (terrainSelectionNew) et valable tant que son nombre de
+   * nœuds et son mode ne changent pas */
+  struct tselection_t {
+    int mode;
+    int nselected;
+    int * selected;
+    GLfloat * instances;      /* origine, pas et morphing par tuile retenue (TERRAIN_GRID) */
+    GLsizei * counts;         /* paramètres du multi-draw (TERRAIN_MESHES) */
+    const GLvoid ** offsets;
+    GLint * basevertex;
+    GLfloat * horizon;        /* pente d'horizon par secteur d'azimut */
+    GLfloat tau;              /* erreur écran tolérée pour cette sélection */
+    GLfloat lodScale;         /* kscreen / tau */
+    tstats_t stats;
+  };
+
+  extern terrain_t * terrainNew(heightmap_t * hm, int tile, int mode);
+  extern void        terrainRefresh(terrain_t * t);
+  extern void        terrainRefreshTextures(terrain_t * t, GLuint heightTex, GLuint normalTex);
+  extern void        terrainPrepare(terrain_t * t, const GLfloat * data);
+  extern int         terrainUpload(terrain_t * t, GLsizeiptr budget);
+  extern void        terrainDirty(terrain_t * t, int x0, int z0, int x1, int z1);
+  extern int         terrainFlush(terrain_t * t);
+  extern tselection_t * terrainSelectionNew(const terrain_t * t);
+  extern void        terrainSelectionDelete(tselection_t * s);
+  extern void        terrainSelect(terrain_t * t, tselection_t * s, const GLfloat eye[3], GLfloat kscreen,
+                                   const GLfloat * viewProjection);
+  extern void        terrainSelectPart(const terrain_t * t, tselection_t * s, int part, int nparts,
+                                       const GLfloat eye[3], GLfloat kscreen, const GLfloat * viewProjection);
+  extern void        terrainSelectMerge(terrain_t * t, tselection_t * s, tselection_t * const * parts, int nparts,
+                                        GLfloat kscreen);
+  extern void        terrainDraw(const terrain_t * t, const tselection_t * s);
+  extern void        terrainDrawIndirect(const terrain_t * t, GLuint commands, GLfloat lodScale);
+  extern void        terrainDrawPatches(const terrain_t * t, GLfloat kscreen, GLfloat pixels);
+  extern void        terrainDelete(terrain_t * t);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
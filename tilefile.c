@@ -0,0 +1,465 @@
+/*!\file tilefile.c
+ *
+ * \brief heightMap sur disque en tuiles, projetée en mémoire et
+ * chargée par fenêtre, cf. tilefile.h.
+ *
+ * \author Farès BELHADJ, amsi@ai.univ-paris8.fr
+ * \date October 14 2026
+ */
+#include "tilefile.h"
+#include "resources.h"
+#include <SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/*!\brief taille de l'en-tête : magic et 5 uint32_t */
+#define HEADER_SIZE 24
+/*!\brief alignement des données de chaque tuile */
+#define TILE_ALIGN 8
+
+typedef struct entry_t entry_t;
+/*!\brief entrée de l'index : position et taille des données d'une tuile */
+struct entry_t {
+  uint64_t offset;
+  uint32_t size, pad;
+};
+
+/*!\brief cache des tuiles compressées décodées : une entrée par tuile
+ * du monde, chaînée de la plus récente à la plus ancienne ; protégé
+ * par son verrou, tilefileLoad tournant dans plusieurs threads */
+struct tfcache_t {
+  SDL_mutex * lock;
+  unsigned short ** tiles;   /* altitudes quantifiées, NULL si absente */
+  int * prev, * next;        /* chaînage, -1 aux bouts */
+  int first, last;           /* plus récente, plus ancienne */
+  size_t bytes;
+  int count, hits, misses;
+};
+
+static const char _magic[4] = { 'H', 'T', 'F', '1' };
+
+static tfcache_t * cacheNew(int ntiles);
+
+static inline const entry_t * entry(const tilefile_t * tf, int tz, int tx) {
+  return (const entry_t *)(tf->map + HEADER_SIZE) + tz * tf->ntx + tx;
+}
+
+/*!\brief dimensions de la tuile (tz, tx), tronquée au bord du monde */
+static inline void tileDims(int w, int h, int tile, int tz, int tx, int * tw, int * th) {
+  *tw = w - tx * tile < tile ? w - tx * tile : tile;
+  *th = h - tz * tile < tile ? h - tz * tile : tile;
+}
+
+/*!\brief prédiction par gradient de l'échantillon (i, j) d'une tuile
+ * de largeur tw à partir de ses voisins déjà codés */
+static inline int predict(const unsigned short * q, int tw, int i, int j) {
+  int p;
+  if(i == 0)
+    return j ? q[j - 1] : 0;
+  if(j == 0)
+    return q[(i - 1) * tw];
+  p = q[i * tw + j - 1] + q[(i - 1) * tw + j] - q[(i - 1) * tw + j - 1];
+  return p < 0 ? 0 : (p > 65535 ? 65535 : p);
+}
+
+/*!\brief compression de n = tw x th altitudes quantifiées dans out
+ * (au plus 3 octets par échantillon). Retourne la taille produite. */
+static size_t encode(const unsigned short * q, int tw, int th, unsigned char * out) {
+  int i, j, r;
+  unsigned int z;
+  unsigned char * p = out;
+  for(i = 0; i < th; i++)
+    for(j = 0; j < tw; j++) {
+      r = q[i * tw + j] - predict(q, tw, i, j);
+      z = ((unsigned int)r << 1) ^ (unsigned int)(r >> 31);
+      for(; z >= 0x80; z >>= 7)
+        *p++ = (unsigned char)(z | 0x80);
+      *p++ = (unsigned char)z;
+    }
+  return p - out;
+}
+
+static void decode(const unsigned char * p, size_t size, int tw, int th, unsigned short * q) {
+  int i, j, s, r;
+  unsigned int z;
+  const unsigned char * end = p + size;
+  for(i = 0; i < th; i++)
+    for(j = 0; j < tw; j++) {
+      for(z = 0, s = 0; p < end; s += 7) {
+        z |= (unsigned int)(*p & 0x7F) << s;
+        if(!(*p++ & 0x80))
+          break;
+      }
+      r = (int)(z >> 1) ^ -(int)(z & 1);
+      q[i * tw + j] = (unsigned short)(predict(q, tw, i, j) + r);
+    }
+}
+
+/*!\brief écriture dans path de la heightMap data (w x h altitudes dans
+ * [0, 1]) en tuiles de tile x tile échantillons ; flags est une
+ * combinaison de TILEFILE_COMPRESSED. Retourne 0 en cas d'erreur. */
+extern int tilefileBake(const char * path, const GLfloat * data, int w, int h, int tile, int flags) {
+  int ntx = (w + tile - 1) / tile, ntz = (h + tile - 1) / tile, tx, tz, tw, th, i, j, ok;
+  uint32_t header[5] = { 0x01020304, w, h, tile, flags };
+  uint64_t offset = HEADER_SIZE + ntx * ntz * (uint64_t)sizeof(entry_t);
+  static const unsigned char zeros[TILE_ALIGN] = {0};
+  unsigned short * q;
+  unsigned char * buffer;
+  entry_t * index;
+  size_t size, raw;
+  GLfloat v;
+  FILE * f;
+  assert(tile > 0 && w > 0 && h > 0);
+  if(!(f = fopen(path, "wb"))) {
+    fprintf(stderr, "%s : création impossible\n", path);
+    return 0;
+  }
+  q = malloc(tile * tile * sizeof *q);
+  buffer = malloc(3 * tile * tile);
+  index = calloc(ntx * ntz, sizeof *index);
+  assert(q && buffer && index);
+  fwrite(_magic, 1, sizeof _magic, f);
+  fwrite(header, sizeof *header, 5, f);
+  fwrite(index, sizeof *index, ntx * ntz, f);
+  for(tz = 0; tz < ntz; tz++)
+    for(tx = 0; tx < ntx; tx++) {
+      tileDims(w, h, tile, tz, tx, &tw, &th);
+      for(i = 0; i < th; i++)
+        for(j = 0; j < tw; j++) {
+          v = data[(tz * tile + i) * w + tx * tile + j];
+          v = v < 0.0f ? 0.0f : (v > 1.0f ? 1.0f : v);
+          q[i * tw + j] = (unsigned short)(v * 65535.0f + 0.5f);
+        }
+      raw = 2 * (size_t)tw * th;
+      size = (flags & TILEFILE_COMPRESSED) ? encode(q, tw, th, buffer) : raw;
+      /* une tuile que la compression ne réduit pas reste brute */
+      if(size >= raw) {
+        size = raw;
+        fwrite(q, 1, raw, f);
+      } else
+        fwrite(buffer, 1, size, f);
+      index[tz * ntx + tx].offset = offset;
+      index[tz * ntx + tx].size = (uint32_t)size;
+      fwrite(zeros, 1, (TILE_ALIGN - size % TILE_ALIGN) % TILE_ALIGN, f);
+      offset += size + (TILE_ALIGN - size % TILE_ALIGN) % TILE_ALIGN;
+    }
+  fseek(f, HEADER_SIZE, SEEK_SET);
+  fwrite(index, sizeof *index, ntx * ntz, f);
+  ok = !ferror(f);
+  ok = !fclose(f) && ok;
+  if(!ok)
+    fprintf(stderr, "%s : erreur d'écriture\n", path);
+  free(q);
+  free(buffer);
+  free(index);
+  return ok;
+}
+
+/*!\brief projection en mémoire du fichier path ; retourne NULL (avec
+ * un message) s'il est illisible ou mal formé */
+extern tilefile_t * tilefileOpen(const char * path) {
+  int fd, k;
+  uint32_t header[5];
+  struct stat st;
+  const entry_t * e;
+  tilefile_t * tf;
+  void * map;
+  if((fd = open(path, O_RDONLY)) < 0) {
+    fprintf(stderr, "%s : ouverture impossible\n", path);
+    return NULL;
+  }
+  if(fstat(fd, &st) < 0 || st.st_size < HEADER_SIZE ||
+     (map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0)) == MAP_FAILED) {
+    fprintf(stderr, "%s : projection en mémoire impossible\n", path);
+    close(fd);
+    return NULL;
+  }
+  memcpy(header, (const unsigned char *)map + sizeof _magic, sizeof header);
+  tf = malloc(sizeof *tf);
+  assert(tf);
+  tf->fd = fd;
+  tf->map = map;
+  tf->size = st.st_size;
+  tf->w = header[1];
+  tf->h = header[2];
+  tf->tile = header[3];
+  tf->flags = header[4];
+  tf->scratch = NULL;
+  tf->plan = NULL;
+  tf->cache = NULL;
+  if(memcmp(map, _magic, sizeof _magic) || header[0] != 0x01020304 || !tf->w || !tf->h || !tf->tile) {
+    fprintf(stderr, "%s : format inconnu\n", path);
+    tilefileClose(tf);
+    return NULL;
+  }
+  tf->ntx = (tf->w + tf->tile - 1) / tf->tile;
+  tf->ntz = (tf->h + tf->tile - 1) / tf->tile;
+  for(k = 0, e = entry(tf, 0, 0); HEADER_SIZE + tf->ntx * tf->ntz * sizeof(entry_t) <= tf->size && k < tf->ntx * tf->ntz; k++)
+    if(e[k].offset + e[k].size > tf->size || e[k].offset % TILE_ALIGN)
+      break;
+  if(k < tf->ntx * tf->ntz) {
+    fprintf(stderr, "%s : fichier tronqué ou corrompu\n", path);
+    tilefileClose(tf);
+    return NULL;
+  }
+  tf->scratch = malloc(tf->tile * tf->tile * sizeof *tf->scratch);
+  tf->plan = malloc(tf->ntx * tf->ntz * sizeof *tf->plan);
+  assert(tf->scratch && tf->plan);
+  tf->cache = cacheNew(tf->ntx * tf->ntz);
+  tf->ox = tf->oz = -1;
+  return tf;
+}
+
+/*!\brief taille (octets) des données de la tuile (tz, tx) */
+extern size_t tilefileTileSize(const tilefile_t * tf, int tz, int tx) {
+  return entry(tf, tz, tx)->size;
+}
+
+static tfcache_t * cacheNew(int ntiles) {
+  tfcache_t * c = malloc(sizeof *c);
+  assert(c);
+  c->lock = SDL_CreateMutex();
+  c->tiles = calloc(ntiles, sizeof *c->tiles);
+  c->prev = malloc(ntiles * sizeof *c->prev);
+  c->next = malloc(ntiles * sizeof *c->next);
+  assert(c->lock && c->tiles && c->prev && c->next);
+  c->first = c->last = -1;
+  c->bytes = 0;
+  c->count = c->hits = c->misses = 0;
+  return c;
+}
+
+static void cacheUnlink(tfcache_t * c, int k) {
+  if(c->prev[k] >= 0) c->next[c->prev[k]] = c->next[k]; else c->first = c->next[k];
+  if(c->next[k] >= 0) c->prev[c->next[k]] = c->prev[k]; else c->last = c->prev[k];
+}
+
+static void cachePush(tfcache_t * c, int k) {
+  c->prev[k] = -1;
+  c->next[k] = c->first;
+  if(c->first >= 0) c->prev[c->first] = k; else c->last = k;
+  c->first = k;
+}
+
+/*!\brief éviction de la tuile k, verrou pris */
+static void cacheEvict(tfcache_t * c, int k, size_t n) {
+  cacheUnlink(c, k);
+  resUntrack(RES_HEAP, (uintptr_t)c->tiles[k]);
+  free(c->tiles[k]);
+  c->tiles[k] = NULL;
+  c->bytes -= n;
+  c->count--;
+}
+
+/*!\brief copie dans dst des n altitudes de la tuile k si elle est en
+ * cache, qui devient la plus récente ; retourne 0 sinon */
+static int cacheGet(tfcache_t * c, int k, unsigned short * dst, int n) {
+  int hit;
+  SDL_LockMutex(c->lock);
+  if((hit = c->tiles[k] != NULL)) {
+    memcpy(dst, c->tiles[k], n * sizeof *dst);
+    cacheUnlink(c, k);
+    cachePush(c, k);
+    c->hits++;
+  } else
+    c->misses++;
+  SDL_UnlockMutex(c->lock);
+  return hit;
+}
+
+/*!\brief ajout d'une copie des n altitudes décodées de la tuile k,
+ * comptée pour une tuile entière (tile x tile) même au bord du monde,
+ * puis éviction des plus anciennes au-delà du budget */
+static void cachePut(const tilefile_t * tf, tfcache_t * c, int k, const unsigned short * src, int n) {
+  size_t budget = resBudget(RES_TILES), bytes = n * sizeof *src, full = tf->tile * (size_t)tf->tile * sizeof *src;
+  if(full > budget)
+    return;
+  SDL_LockMutex(c->lock);
+  if(!c->tiles[k] && (c->tiles[k] = malloc(full))) {
+    memcpy(c->tiles[k], src, bytes);
+    resTrack(RES_HEAP, (uintptr_t)c->tiles[k], RES_TILES, full);
+    cachePush(c, k);
+    c->bytes += full;
+    c->count++;
+    while(c->bytes > budget && c->last >= 0)
+      cacheEvict(c, c->last, full);
+  }
+  SDL_UnlockMutex(c->lock);
+}
+
+static void cacheFree(tilefile_t * tf) {
+  tfcache_t * c = tf->cache;
+  if(!c)
+    return;
+  while(c->last >= 0)
+    cacheEvict(c, c->last, tf->tile * (size_t)tf->tile * sizeof **c->tiles);
+  SDL_DestroyMutex(c->lock);
+  free(c->tiles);
+  free(c->prev);
+  free(c->next);
+  free(c);
+  tf->cache = NULL;
+}
+
+/*!\brief tuiles en cache, et tuiles compressées trouvées ou non en
+ * cache depuis l'ouverture */
+extern void tilefileCacheStats(const tilefile_t * tf, int * tiles, int * hits, int * misses) {
+  SDL_LockMutex(tf->cache->lock);
+  *tiles = tf->cache->count;
+  *hits = tf->cache->hits;
+  *misses = tf->cache->misses;
+  SDL_UnlockMutex(tf->cache->lock);
+}
+
+/*!\brief altitudes quantifiées de la tuile (tz, tx), lues dans le
+ * fichier projeté si elle est brute, copiées du cache ou décodées dans
+ * scratch (tile x tile) sinon */
+static const unsigned short * quantized(const tilefile_t * tf, int tz, int tx, unsigned short * scratch, int * tw, int * th) {
+  const entry_t * e = entry(tf, tz, tx);
+  const unsigned char * src = tf->map + e->offset;
+  int k = tz * tf->ntx + tx;
+  tileDims(tf->w, tf->h, tf->tile, tz, tx, tw, th);
+  if(e->size == 2 * (size_t)*tw * *th)
+    return (const unsigned short *)src;
+  if(!cacheGet(tf->cache, k, scratch, *tw * *th)) {
+    decode(src, e->size, *tw, *th, scratch);
+    cachePut(tf, tf->cache, k, scratch, *tw * *th);
+  }
+  return scratch;
+}
+
+/*!\brief décodage de la tuile (tz, tx) dans dst, lignes de stride
+ * flottants */
+extern void tilefileTile(tilefile_t * tf, int tz, int tx, GLfloat * dst, int stride) {
+  int tw, th, i, j;
+  const unsigned short * q = quantized(tf, tz, tx, tf->scratch, &tw, &th);
+  for(i = 0; i < th; i++)
+    for(j = 0; j < tw; j++)
+      dst[i * stride + j] = q[i * tw + j] * (1.0f / 65535.0f);
+}
+
+/*!\brief conseil advice au système pour les pages des tuiles [tz0,
+ * tz1[ x [tx0, tx1[ (bornées au monde) */
+static void advise(const tilefile_t * tf, int tz0, int tz1, int tx0, int tx1, int advice) {
+  int tz;
+  const entry_t * a, * b;
+  uintptr_t page = sysconf(_SC_PAGESIZE), start, end;
+  tz0 = tz0 < 0 ? 0 : tz0; tz1 = tz1 > tf->ntz ? tf->ntz : tz1;
+  tx0 = tx0 < 0 ? 0 : tx0; tx1 = tx1 > tf->ntx ? tf->ntx : tx1;
+  /* les tuiles d'une ligne de tuiles sont contiguës dans le fichier */
+  for(tz = tz0; tz < tz1 && tx0 < tx1; tz++) {
+    a = entry(tf, tz, tx0);
+    b = entry(tf, tz, tx1 - 1);
+    start = (uintptr_t)(tf->map + a->offset) & ~(page - 1);
+    end = (uintptr_t)(tf->map + b->offset + b->size);
+    madvise((void *)start, end - start, advice);
+  }
+}
+
+/*!\brief libération des pages des tuiles du rectangle [tz0, tz1[ x
+ * [tx0, tx1[ hors du rectangle [nz0, nz1[ x [nx0, nx1[ */
+static void release(const tilefile_t * tf, int tx0, int tx1, int tz0, int tz1, int nx0, int nx1, int nz0, int nz1) {
+  int tz;
+  for(tz = tz0; tz < tz1; tz++)
+    if(tz < nz0 || tz >= nz1)
+      advise(tf, tz, tz + 1, tx0, tx1, MADV_DONTNEED);
+    else {
+      advise(tf, tz, tz + 1, tx0, tx1 < nx0 ? tx1 : nx0, MADV_DONTNEED);
+      advise(tf, tz, tz + 1, tx0 > nx1 ? tx0 : nx1, tx1, MADV_DONTNEED);
+    }
+}
+
+/*!\brief préparation, dans m, du recentrage de la fenêtre hm sur
+ * l'échantillon (x, z) du monde lorsqu'il s'éloigne de plus d'une
+ * tuile du centre (ou du premier chargement) ; l'origine reste alignée
+ * sur les tuiles et la fenêtre dans le monde. Retourne 0 si la fenêtre
+ * n'a pas à bouger. */
+extern int tilefilePlan(const tilefile_t * tf, const heightmap_t * hm, int x, int z, tfmove_t * m) {
+  int T = tf->tile, w = hm->w, h = hm->h, ox = tf->ox, oz = tf->oz, dx, dz, tx, tz, x0, x1, z0, z1;
+  assert(w <= tf->w && h <= tf->h);
+  if(ox >= 0 && abs(x - (ox + w / 2)) <= T && abs(z - (oz + h / 2)) <= T)
+    return 0;
+  ox = (x - w / 2) / T * T;
+  oz = (z - h / 2) / T * T;
+  ox = ox < 0 ? 0 : (ox > tf->w - w ? tf->w - w : ox);
+  oz = oz < 0 ? 0 : (oz > tf->h - h ? tf->h - h : oz);
+  if(ox == tf->ox && oz == tf->oz)
+    return 0;
+  m->tiles = tf->plan;
+  m->ox = ox;
+  m->oz = oz;
+  m->i0 = m->i1 = m->j0 = m->j1 = 0;
+  dx = ox - tf->ox;
+  dz = oz - tf->oz;
+  if(tf->ox >= 0 && abs(dx) < w && abs(dz) < h) {
+    m->i0 = dz < 0 ? -dz : 0; m->i1 = dz > 0 ? h - dz : h;
+    m->j0 = dx < 0 ? -dx : 0; m->j1 = dx > 0 ? w - dx : w;
+  }
+  /* tuiles touchant la fenêtre hors de la région conservée */
+  for(m->ntiles = 0, tz = oz / T; tz * T < oz + h; tz++)
+    for(tx = ox / T; tx * T < ox + w; tx++) {
+      x0 = tx * T - ox; x1 = x0 + T; x0 = x0 < 0 ? 0 : x0; x1 = x1 > w ? w : x1;
+      z0 = tz * T - oz; z1 = z0 + T; z0 = z0 < 0 ? 0 : z0; z1 = z1 > h ? h : z1;
+      if(x0 < m->j0 || x1 > m->j1 || z0 < m->i0 || z1 > m->i1)
+        tf->plan[m->ntiles++] = tz * tf->ntx + tx;
+    }
+  return 1;
+}
+
+/*!\brief copie dans dst, fenêtre d'arrivée de m, de la région
+ * conservée lue dans src, fenêtre courante */
+extern void tilefileKeep(const tilefile_t * tf, const tfmove_t * m, const GLfloat * src, heightmap_t * dst) {
+  int i, w = dst->w, dx = m->ox - tf->ox, dz = m->oz - tf->oz;
+  for(i = m->i0; i < m->i1; i++)
+    memcpy(&dst->data[i * w + m->j0], &src[(i + dz) * w + m->j0 + dx], (m->j1 - m->j0) * sizeof *src);
+}
+
+/*!\brief décodage de la k-ième tuile de m dans dst, hors de la région
+ * conservée ; scratch reçoit tile x tile altitudes quantifiées. Les
+ * appels pour des k différents et tilefileKeep écrivent des
+ * échantillons disjoints et peuvent être concurrents. */
+extern void tilefileLoad(const tilefile_t * tf, const tfmove_t * m, int k, unsigned short * scratch, heightmap_t * dst) {
+  int w = dst->w, h = dst->h, T = tf->tile, tz = m->tiles[k] / tf->ntx, tx = m->tiles[k] % tf->ntx;
+  int i, j, tw, th, x0, x1, z0, z1, a, b;
+  GLfloat * d = dst->data;
+  const unsigned short * q = quantized(tf, tz, tx, scratch, &tw, &th);
+  x0 = tx * T - m->ox; x1 = x0 + T; x0 = x0 < 0 ? 0 : x0; x1 = x1 > w ? w : x1;
+  z0 = tz * T - m->oz; z1 = z0 + T; z0 = z0 < 0 ? 0 : z0; z1 = z1 > h ? h : z1;
+  for(i = z0; i < z1; i++) {
+    /* dans les lignes conservées, seules les colonnes hors de [j0, j1[ */
+    a = i >= m->i0 && i < m->i1 ? (m->j0 > x0 ? m->j0 : x0) : x1;
+    b = i >= m->i0 && i < m->i1 ? (m->j1 < x1 ? m->j1 : x1) : x1;
+    for(j = x0; j < x1; j++)
+      if(j < a || j >= b)
+        d[i * w + j] = q[(m->oz + i - tz * T) * tw + m->ox + j - tx * T] * (1.0f / 65535.0f);
+  }
+}
+
+/*!\brief la fenêtre de m devient la fenêtre courante ; les tuiles de
+ * la fenêtre élargie d'une couronne sont annoncées au système, celles
+ * de l'ancienne fenêtre élargie qui en sortent sont libérées */
+extern void tilefileCommit(tilefile_t * tf, const tfmove_t * m, const heightmap_t * hm) {
+  int T = tf->tile, w = hm->w, h = hm->h, ox = m->ox, oz = m->oz;
+  if(tf->ox >= 0)
+    release(tf, tf->ox / T - 1, (tf->ox + w - 1) / T + 2, tf->oz / T - 1, (tf->oz + h - 1) / T + 2,
+            ox / T - 1, (ox + w - 1) / T + 2, oz / T - 1, (oz + h - 1) / T + 2);
+  advise(tf, oz / T - 1, (oz + h - 1) / T + 2, ox / T - 1, (ox + w - 1) / T + 2, MADV_WILLNEED);
+  tf->ox = ox;
+  tf->oz = oz;
+}
+
+extern void tilefileClose(tilefile_t * tf) {
+  munmap((void *)tf->map, tf->size);
+  close(tf->fd);
+  cacheFree(tf);
+  free(tf->scratch);
+  free(tf->plan);
+  free(tf);
+}
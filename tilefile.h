@@ -0,0 +1,102 @@
+/*!\file tilefile.h
+ *
+ * \brief heightMap sur disque découpée en tuiles, projetée en mémoire
+ * (mmap) et chargée par fenêtre autour de la caméra : la taille du
+ * monde n'est plus bornée par la mémoire vive et le démarrage n'attend
+ * plus la génération.
+ *
+ * Format (ordre des octets de la machine, vérifié à l'ouverture) :
+ * - en-tête : "HTF1", 0x01020304, w, h, tile, flags (uint32_t) ;
+ * - index : pour chacune des ntx x ntz tuiles (ligne de tuiles par
+ *   ligne de tuiles), offset (uint64_t) et taille (uint32_t, suivi de
+ *   4 octets de remplissage) de ses données ;
+ * - données : la tuile (tz, tx) couvre les échantillons [tz tile, tz
+ *   tile + th[ x [tx tile, tx tile + tw[, tw et th étant tronqués au
+ *   bord du monde. Altitudes quantifiées sur 16 bits (0 à 65535 pour [0,
+ *   1]), brutes (2 tw th octets) ou, si TILEFILE_COMPRESSED et que le
+ *   gain est réel, résidus d'une prédiction par gradient (gauche + haut
+ *   - haut gauche) codés en zigzag puis en entiers de taille variable
+ *   (7 bits par octet) ; une tuile est brute si et seulement si sa
+ *   taille vaut 2 tw th.
+ *
+ * La fenêtre est une heightmap_t de taille fixe dont l'origine, dans le
+ * monde, suit la caméra par pas d'une tuile. Un déplacement est
+ * préparé (tilefilePlan), réalisé dans une seconde fenêtre par copie
+ * de la partie commune (tilefileKeep) et décodage des seules tuiles
+ * entrantes (tilefileLoad), éventuellement en parallèle puisque ces
+ * appels ne modifient pas le fichier ouvert, puis validé
+ * (tilefileCommit) : les tuiles voisines de la fenêtre sont alors
+ * annoncées au système (MADV_WILLNEED), celles qui s'en éloignent
+ * libérées (MADV_DONTNEED).
+ *
+ * Les tuiles compressées décodées sont gardées dans un cache en
+ * mémoire centrale (catégorie RES_TILES du registre, cf. resources.h)
+ * : une tuile qui revient dans la fenêtre n'est pas décodée de
+ * nouveau. Le cache évince les tuiles les moins récemment utilisées
+ * dès qu'il dépasse resBudget(RES_TILES) ; sans budget, il est
+ * inactif. Les tuiles brutes sont lues dans le fichier projeté, dont
+ * les pages sont gérées par le système.
+ *
+ * \author Farès BELHADJ, amsi@ai.univ-paris8.fr
+ * \date October 14 2026
+ */
+#ifndef _TILEFILE_H
+#define _TILEFILE_H
+
+#include "heightmap.h"
+#include <stddef.h>
+
+/*!\brief flag de tilefileBake : compression des tuiles */
+#define TILEFILE_COMPRESSED 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  typedef struct tfmove_t tfmove_t;
+  /*!\brief déplacement de fenêtre préparé par tilefilePlan : nouvelle
+   * origine, région conservée [i0, i1[ x [j0, j1[ (coordonnées de la
+   * nouvelle fenêtre, vide au premier chargement) et indices tz ntx +
+   * tx des tuiles à décoder */
+  struct tfmove_t {
+    int ox, oz;
+    int i0, i1, j0, j1;
+    int ntiles;
+    const int * tiles;
+  };
+
+  /*!\brief cache LRU des tuiles décodées, cf. tilefile.c */
+  typedef struct tfcache_t tfcache_t;
+
+  typedef struct tilefile_t tilefile_t;
+  /*!\brief fichier de tuiles ouvert et fenêtre courante */
+  struct tilefile_t {
+    int w, h;                  /* échantillons du monde */
+    int tile, ntx, ntz;        /* côté et nombre de tuiles */
+    int flags;
+    int fd;
+    const unsigned char * map; /* fichier projeté */
+    size_t size;
+    int ox, oz;                /* origine de la fenêtre, -1 avant chargement */
+    unsigned short * scratch;  /* altitudes quantifiées d'une tuile */
+    int * plan;                /* tuiles du déplacement en préparation */
+    tfcache_t * cache;         /* tuiles compressées décodées récemment */
+  };
+
+  extern int          tilefileBake(const char * path, const GLfloat * data, int w, int h, int tile, int flags);
+  extern tilefile_t * tilefileOpen(const char * path);
+  extern void         tilefileTile(tilefile_t * tf, int tz, int tx, GLfloat * dst, int stride);
+  extern size_t       tilefileTileSize(const tilefile_t * tf, int tz, int tx);
+  extern int          tilefilePlan(const tilefile_t * tf, const heightmap_t * hm, int x, int z, tfmove_t * m);
+  extern void         tilefileKeep(const tilefile_t * tf, const tfmove_t * m, const GLfloat * src, heightmap_t * dst);
+  extern void         tilefileLoad(const tilefile_t * tf, const tfmove_t * m, int k, unsigned short * scratch,
+                                   heightmap_t * dst);
+  extern void         tilefileCommit(tilefile_t * tf, const tfmove_t * m, const heightmap_t * hm);
+  extern void         tilefileCacheStats(const tilefile_t * tf, int * tiles, int * hits, int * misses);
+  extern void         tilefileClose(tilefile_t * tf);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
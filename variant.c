@@ -0,0 +1,309 @@
+/*!\file variant.c
+ *
+ * \brief variantes de programmes GLSL par \#define et cache de leurs
+ * binaires, cf. variant.h.
+ *
+ * \author Farès BELHADJ, amsi@ai.univ-paris8.fr
+ * \date October 14 2026
+ */
+#include "variant.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+/*!\brief nombre maximal de shaders d'une variante */
+#define MAX_SHADERS 6
+
+typedef struct variant_t variant_t;
+/*!\brief une variante construite : clé (defines puis shaders, séparés
+ * par '|') et programme */
+struct variant_t {
+  char * key;
+  GLuint id;
+};
+
+static variant_t _variants[VARIANT_MAX];
+static int _nvariants = 0;
+/*!\brief répertoire du cache des binaires, NULL s'il est désactivé */
+static char * _dir = NULL;
+/*!\brief variantes compilées et relues du cache disque */
+static int _compiled = 0, _loaded = 0;
+
+/*!\brief type GL du shader désigné par spec ("<vs>chemin"), chemin
+ * dans *path ; 0 si le préfixe est inconnu */
+static GLenum shaderType(const char * spec, const char ** path) {
+  static const struct { const char * tag; GLenum type; } types[] = {
+    { "<vs>", GL_VERTEX_SHADER }, { "<fs>", GL_FRAGMENT_SHADER }, { "<gs>", GL_GEOMETRY_SHADER },
+    { "<tcs>", GL_TESS_CONTROL_SHADER }, { "<tes>", GL_TESS_EVALUATION_SHADER },
+    { "<cs>", GL_COMPUTE_SHADER }
+  };
+  size_t i, n;
+  for(i = 0; i < sizeof types / sizeof *types; i++)
+    if(!strncmp(spec, types[i].tag, n = strlen(types[i].tag))) {
+      *path = spec + n;
+      return types[i].type;
+    }
+  return 0;
+}
+
+/*!\brief contenu du fichier path terminé par '\\0', NULL si illisible */
+static char * readFile(const char * path) {
+  FILE * f = fopen(path, "rb");
+  char * s = NULL;
+  long n;
+  if(!f)
+    return NULL;
+  if(fseek(f, 0, SEEK_END) == 0 && (n = ftell(f)) >= 0 && (s = malloc(n + 1))) {
+    rewind(f);
+    if(fread(s, 1, n, f) != (size_t)n) {
+      free(s);
+      s = NULL;
+    } else
+      s[n] = '\0';
+  }
+  fclose(f);
+  return s;
+}
+
+/*!\brief texte GLSL des defines : "A B=2" donne "#define A 1\\n#define
+ * B 2\\n" ; à libérer */
+static char * defineBlock(const char * defines) {
+  char * s = malloc(4 * strlen(defines) + 16), * d = s;
+  const char * p = defines;
+  while(*p) {
+    const char * e;
+    if(*p == ' ') {
+      p++;
+      continue;
+    }
+    d += sprintf(d, "#define ");
+    for(e = p; *e && *e != ' ' && *e != '='; e++)
+      *d++ = *e;
+    *d++ = ' ';
+    if(*e == '=')
+      for(e++; *e && *e != ' '; e++)
+        *d++ = *e;
+    else
+      *d++ = '1';
+    *d++ = '\n';
+    p = e;
+  }
+  *d = '\0';
+  return s;
+}
+
+/*!\brief FNV-1a 64 bits de s, poursuivant h */
+static unsigned long long hash(unsigned long long h, const char * s) {
+  for(; *s; s++)
+    h = (h ^ (unsigned char)*s) * 0x100000001b3ULL;
+  return (h ^ 0xFF) * 0x100000001b3ULL;
+}
+
+/*!\brief l'extension name est-elle disponible ? */
+static int hasExtension(const char * name) {
+  GLint i, n = 0;
+  glGetIntegerv(GL_NUM_EXTENSIONS, &n);
+  for(i = 0; i < n; i++)
+    if(!strcmp((const char *)glGetStringi(GL_EXTENSIONS, i), name))
+      return 1;
+  return 0;
+}
+
+/*!\brief active le cache disque des binaires dans le répertoire dir,
+ * créé au besoin ; NULL le désactive. Sans GL_ARB_get_program_binary
+ * (ou sans aucun format de binaire) le cache reste désactivé. */
+extern void variantCacheDir(const char * dir) {
+  GLint formats = 0;
+  free(_dir);
+  _dir = NULL;
+  if(!dir || !hasExtension("GL_ARB_get_program_binary"))
+    return;
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+  if(formats <= 0)
+    return;
+  mkdir(dir, 0755);
+  _dir = strdup(dir);
+}
+
+/*!\brief relecture du binaire de file dans id ; 0 si absent, tronqué
+ * ou refusé par le pilote (mise à jour par exemple) */
+static int loadBinary(GLuint id, const char * file) {
+  FILE * f = fopen(file, "rb");
+  GLenum format;
+  GLint length, status = GL_FALSE;
+  void * data;
+  if(!f)
+    return 0;
+  if(fread(&format, sizeof format, 1, f) == 1 && fread(&length, sizeof length, 1, f) == 1 &&
+     length > 0 && (data = malloc(length))) {
+    if(fread(data, 1, length, f) == (size_t)length) {
+      glProgramBinary(id, format, data, length);
+      glGetProgramiv(id, GL_LINK_STATUS, &status);
+    }
+    free(data);
+  }
+  fclose(f);
+  return status == GL_TRUE;
+}
+
+static void saveBinary(GLuint id, const char * file) {
+  GLenum format;
+  GLint length = 0;
+  void * data;
+  FILE * f;
+  glGetProgramiv(id, GL_PROGRAM_BINARY_LENGTH, &length);
+  if(length <= 0 || !(data = malloc(length)))
+    return;
+  glGetProgramBinary(id, length, &length, &format, data);
+  if((f = fopen(file, "wb"))) {
+    fwrite(&format, sizeof format, 1, f);
+    fwrite(&length, sizeof length, 1, f);
+    fwrite(data, 1, length, f);
+    fclose(f);
+  }
+  free(data);
+}
+
+/*!\brief compilation des n shaders (types et sources complètes, defines
+ * de block compris) et édition des liens dans id ; 0 en cas d'erreur,
+ * journal affiché */
+static int build(GLuint id, int n, const GLenum * types, char ** sources, const char ** paths, const char * block) {
+  GLuint shaders[MAX_SHADERS];
+  GLint status, i, ok = 1;
+  char log[4096];
+  for(i = 0; i < n; i++) {
+    const GLchar * parts[4] = { sources[i], block, "#line 1\n", sources[i] };
+    GLint lengths[4] = { 0, -1, -1, -1 };
+    char * eol;
+    /* defines après la ligne #version, numéros de ligne préservés */
+    if(!strncmp(sources[i], "#version", 8) && (eol = strchr(sources[i], '\n'))) {
+      lengths[0] = eol + 1 - sources[i];
+      parts[2] = "#line 2\n";
+      parts[3] = eol + 1;
+    }
+    shaders[i] = glCreateShader(types[i]);
+    glShaderSource(shaders[i], 4, parts, lengths);
+    glCompileShader(shaders[i]);
+    glGetShaderiv(shaders[i], GL_COMPILE_STATUS, &status);
+    if(status != GL_TRUE) {
+      glGetShaderInfoLog(shaders[i], sizeof log, NULL, log);
+      fprintf(stderr, "%s (%s) : %s\n", paths[i], block, log);
+      ok = 0;
+    }
+    glAttachShader(id, shaders[i]);
+  }
+  if(ok) {
+    if(_dir)
+      glProgramParameteri(id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(id);
+    glGetProgramiv(id, GL_LINK_STATUS, &status);
+    if(status != GL_TRUE) {
+      glGetProgramInfoLog(id, sizeof log, NULL, log);
+      fprintf(stderr, "édition des liens (%s) : %s\n", block, log);
+      ok = 0;
+    }
+  }
+  for(i = 0; i < n; i++) {
+    glDetachShader(id, shaders[i]);
+    glDeleteShader(shaders[i]);
+  }
+  return ok;
+}
+
+/*!\brief programme des shaders donnés (liste terminée par NULL, cf.
+ * variant.h) compilés avec les defines, séparés par des espaces, de
+ * defines ("" pour aucun). Une variante déjà construite est rendue
+ * telle quelle ; 0 en cas d'erreur. */
+extern GLuint variantProgram(const char * defines, const char * shader, ...) {
+  GLenum types[MAX_SHADERS];
+  char * sources[MAX_SHADERS], * key, * block, file[1024];
+  const char * paths[MAX_SHADERS], * s;
+  unsigned long long h = 0xcbf29ce484222325ULL;
+  size_t len = strlen(defines) + 1;
+  int i, n = 0, ok = 1, loaded = 0;
+  GLuint id;
+  va_list ap;
+  va_start(ap, shader);
+  for(s = shader; s && n < MAX_SHADERS; s = va_arg(ap, const char *)) {
+    if(!(types[n] = shaderType(s, &paths[n]))) {
+      fprintf(stderr, "%s : type de shader inconnu\n", s);
+      ok = 0;
+    }
+    sources[n++] = (char *)s;
+    len += strlen(s) + 1;
+  }
+  va_end(ap);
+  if(!ok)
+    return 0;
+  /* variante déjà construite ? */
+  key = malloc(len);
+  strcpy(key, defines);
+  for(i = 0; i < n; i++)
+    strcat(strcat(key, "|"), sources[i]);
+  for(i = 0; i < _nvariants; i++)
+    if(!strcmp(_variants[i].key, key)) {
+      free(key);
+      return _variants[i].id;
+    }
+  if(_nvariants == VARIANT_MAX) {
+    fprintf(stderr, "variantProgram : plus de %d variantes\n", VARIANT_MAX);
+    free(key);
+    return 0;
+  }
+  for(i = 0; i < n; i++)
+    if(!(sources[i] = readFile(paths[i]))) {
+      fprintf(stderr, "%s : lecture impossible\n", paths[i]);
+      ok = 0;
+    }
+  block = defineBlock(defines);
+  id = glCreateProgram();
+  if(ok && _dir) {
+    /* clé du binaire : pilote, defines et texte de chaque source */
+    h = hash(h, (const char *)glGetString(GL_VENDOR));
+    h = hash(h, (const char *)glGetString(GL_RENDERER));
+    h = hash(h, (const char *)glGetString(GL_VERSION));
+    h = hash(h, block);
+    for(i = 0; i < n; i++)
+      h = hash(hash(h, paths[i]), sources[i]);
+    snprintf(file, sizeof file, "%s/%016llx.bin", _dir, h);
+    if((loaded = loadBinary(id, file)))
+      _loaded++;
+  }
+  if(ok && !loaded && (ok = build(id, n, types, sources, paths, block))) {
+    _compiled++;
+    if(_dir)
+      saveBinary(id, file);
+  }
+  for(i = 0; i < n; i++)
+    free(sources[i]);
+  free(block);
+  if(!ok) {
+    glDeleteProgram(id);
+    free(key);
+    return 0;
+  }
+  _variants[_nvariants].key = key;
+  _variants[_nvariants++].id = id;
+  return id;
+}
+
+/*!\brief nombre de variantes compilées et relues du cache disque
+ * depuis le début de l'exécution */
+extern void variantStats(int * compiled, int * loaded) {
+  *compiled = _compiled;
+  *loaded = _loaded;
+}
+
+extern void variantFree(void) {
+  int i;
+  for(i = 0; i < _nvariants; i++) {
+    glDeleteProgram(_variants[i].id);
+    free(_variants[i].key);
+  }
+  _nvariants = 0;
+  free(_dir);
+  _dir = NULL;
+}
@@ -0,0 +1,42 @@
+/*!\file variant.h
+ *
+ * \brief variantes spécialisées à la compilation d'un même programme
+ * GLSL : les sources sont compilées précédées de \#define (par exemple
+ * "TERRAIN", "WATER", "OCTAVES=8", "NOISE_BACKEND=1") au lieu de
+ * brancher par fragment sur un uniform. Chaque variante n'est compilée
+ * qu'une fois par exécution (cache en mémoire, clé : defines et
+ * shaders) et, si un répertoire de cache est donné et que le pilote
+ * sait relire ses binaires (GL_ARB_get_program_binary), une seule fois
+ * tout court : le binaire lié est conservé sur disque sous une clé qui
+ * couvre aussi le texte des sources et le pilote, et relu aux
+ * exécutions suivantes.
+ *
+ * Les shaders sont désignés comme pour gl4duCreateProgram
+ * ("<vs>shaders/basic.vs", "<fs>...", "<gs>...", "<tcs>...",
+ * "<tes>...", "<cs>...") ; les defines sont insérés après la ligne \#version.
+ *
+ * \author Farès BELHADJ, amsi@ai.univ-paris8.fr
+ * \date October 14 2026
+ */
+#ifndef _VARIANT_H
+#define _VARIANT_H
+
+#include <GL4D/gl4dummies.h>
+
+/*!\brief nombre maximal de variantes en cache */
+#define VARIANT_MAX 64
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  extern void   variantCacheDir(const char * dir);
+  extern GLuint variantProgram(const char * defines, const char * shader, ...);
+  extern void   variantStats(int * compiled, int * loaded);
+  extern void   variantFree(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,156 @@
+/*!\file vcache.c
+ *
+ * \brief ordre des triangles favorable au cache des sommets, cf.
+ * vcache.h.
+ *
+ * À chaque étape on émet, parmi les triangles non émis touchant un
+ * sommet du cache modélisé, celui de meilleur score (somme des scores
+ * de ses sommets) ; le score d'un sommet croît avec sa fraîcheur dans
+ * le cache et avec le petit nombre de triangles qui lui restent, pour
+ * terminer les régions entamées plutôt que d'en ouvrir d'autres. Si
+ * aucun triangle du cache ne reste, on repart du meilleur triangle non
+ * émis.
+ *
+ * \author Farès BELHADJ, amsi@ai.univ-paris8.fr
+ * \date October 14 2026
+ */
+#include "vcache.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+
+typedef struct vinfo_t vinfo_t;
+/*!\brief état d'un sommet : position dans le cache (-1 si absent),
+ * score, triangles non émis (les remaining premiers de tris) */
+struct vinfo_t {
+  int cache, remaining, ntris;
+  int * tris;
+  GLfloat score;
+};
+
+/*!\brief score d'un sommet (constantes de Forsyth) : les 3 sommets du
+ * dernier triangle ont un score fixe pour ne pas favoriser un triangle
+ * dégénéré de continuation, le reste décroît avec l'âge ; bonus de
+ * valence en 2 / sqrt(remaining) */
+static GLfloat score(const vinfo_t * v) {
+  GLfloat s = 0.0f;
+  if(!v->remaining)
+    return -1.0f;
+  if(v->cache >= 0)
+    s = v->cache < 3 ? 0.75f : powf(1.0f - (v->cache - 3) / (GLfloat)(VCACHE_LRU_SIZE - 3), 1.5f);
+  return s + 2.0f / sqrtf((GLfloat)v->remaining);
+}
+
+/*!\brief réordonnancement sur place des nindices / 3 triangles de
+ * indices, dont les sommets sont dans [0, nvertices[ */
+extern void vcacheOptimize(GLushort * indices, int nindices, int nvertices) {
+  int ntris = nindices / 3, i, j, k, c, best, emitted, n, ncache = 0, nfresh, * storage;
+  int cache[VCACHE_LRU_SIZE + 3], fresh[VCACHE_LRU_SIZE + 3];
+  vinfo_t * v = calloc(nvertices, sizeof *v);
+  GLfloat * tscore = malloc(ntris * sizeof *tscore), s;
+  char * done = calloc(ntris, 1);
+  GLushort * out = malloc(nindices * sizeof *out);
+  storage = malloc(nindices * sizeof *storage);
+  assert(v && tscore && done && out && storage);
+  /* triangles de chaque sommet */
+  for(i = 0; i < nindices; i++)
+    v[indices[i]].ntris++;
+  for(i = 0, n = 0; i < nvertices; i++) {
+    v[i].tris = storage + n;
+    n += v[i].ntris;
+    v[i].remaining = v[i].ntris;
+    v[i].ntris = 0;
+    v[i].cache = -1;
+  }
+  for(i = 0; i < nindices; i++)
+    v[indices[i]].tris[v[indices[i]].ntris++] = i / 3;
+  for(i = 0; i < nvertices; i++)
+    v[i].score = score(&v[i]);
+  for(i = 0; i < ntris; i++)
+    tscore[i] = v[indices[3 * i]].score + v[indices[3 * i + 1]].score + v[indices[3 * i + 2]].score;
+  best = -1;
+  for(emitted = 0; emitted < ntris; emitted++) {
+    /* meilleur triangle du cache, sinon meilleur non émis */
+    if(best < 0) {
+      for(s = -1.0f, i = 0; i < ntris; i++)
+        if(!done[i] && tscore[i] > s) {
+          s = tscore[i];
+          best = i;
+        }
+    }
+    done[best] = 1;
+    memcpy(&out[3 * emitted], &indices[3 * best], 3 * sizeof *out);
+    /* retrait du triangle des listes de ses sommets, qui passent en
+     * tête du cache */
+    nfresh = 0;
+    for(k = 0; k < 3; k++) {
+      vinfo_t * w = &v[indices[3 * best + k]];
+      for(j = 0; w->tris[j] != best; j++);
+      w->tris[j] = w->tris[--w->remaining];
+      w->tris[w->remaining] = best;
+      fresh[nfresh++] = indices[3 * best + k];
+    }
+    for(c = 0; c < ncache; c++)
+      if(cache[c] != fresh[0] && cache[c] != fresh[1] && cache[c] != fresh[2])
+        fresh[nfresh++] = cache[c];
+    /* les sommets sortis du cache modélisé perdent leur position */
+    for(c = VCACHE_LRU_SIZE; c < nfresh; c++) {
+      v[fresh[c]].cache = -1;
+      v[fresh[c]].score = score(&v[fresh[c]]);
+    }
+    ncache = nfresh < VCACHE_LRU_SIZE ? nfresh : VCACHE_LRU_SIZE;
+    memcpy(cache, fresh, ncache * sizeof *cache);
+    for(c = 0; c < ncache; c++) {
+      v[cache[c]].cache = c;
+      v[cache[c]].score = score(&v[cache[c]]);
+    }
+    /* nouveaux scores des triangles touchés et choix du suivant parmi
+     * eux ; ceux des sommets sortis du cache ne peuvent que baisser */
+    for(c = VCACHE_LRU_SIZE; c < nfresh; c++)
+      for(j = 0; j < v[fresh[c]].remaining; j++) {
+        i = v[fresh[c]].tris[j];
+        tscore[i] = v[indices[3 * i]].score + v[indices[3 * i + 1]].score + v[indices[3 * i + 2]].score;
+      }
+    best = -1;
+    for(c = 0, s = -1.0f; c < ncache; c++)
+      for(j = 0; j < v[cache[c]].remaining; j++) {
+        i = v[cache[c]].tris[j];
+        tscore[i] = v[indices[3 * i]].score + v[indices[3 * i + 1]].score + v[indices[3 * i + 2]].score;
+        if(tscore[i] > s) {
+          s = tscore[i];
+          best = i;
+        }
+      }
+  }
+  memcpy(indices, out, nindices * sizeof *out);
+  free(out);
+  free(done);
+  free(tscore);
+  free(storage);
+  free(v);
+}
+
+/*!\brief ACMR des triangles de indices sur un cache FIFO de
+ * VCACHE_FIFO_SIZE sommets */
+extern GLfloat vcacheACMR(const GLushort * indices, int nindices, int nvertices) {
+  int i, misses = 0, head = 0, fifo[VCACHE_FIFO_SIZE];
+  int * stamp = malloc(nvertices * sizeof *stamp);
+  assert(stamp);
+  /* stamp[v] : rang d'entrée de v dans le cache, -1 s'il n'y est pas */
+  for(i = 0; i < nvertices; i++)
+    stamp[i] = -1;
+  for(i = 0; i < VCACHE_FIFO_SIZE; i++)
+    fifo[i] = -1;
+  for(i = 0; i < nindices; i++) {
+    if(stamp[indices[i]] >= 0)
+      continue;
+    misses++;
+    if(fifo[head % VCACHE_FIFO_SIZE] >= 0)
+      stamp[fifo[head % VCACHE_FIFO_SIZE]] = -1;
+    fifo[head % VCACHE_FIFO_SIZE] = indices[i];
+    stamp[indices[i]] = head++;
+  }
+  free(stamp);
+  return misses / (GLfloat)(nindices / 3);
+}
@@ -0,0 +1,39 @@
+/*!\file vcache.h
+ *
+ * \brief ordre des triangles favorable au cache post-transformation
+ * des sommets : réordonnancement glouton de Tom Forsyth ("Linear-Speed
+ * Vertex Cache Optimisation", 2006) et mesure de l'ACMR (average cache
+ * miss ratio, sommets transformés par triangle) sur un cache FIFO
+ * simulé.
+ *
+ * L'ACMR vaut 3 sans aucune réutilisation ; une grille régulière tend
+ * vers 0,5 (deux triangles par sommet) avec un cache suffisant. Un
+ * parcours ligne par ligne d'une grille plus large que le cache
+ * retransforme chaque ligne deux fois, soit près de 1.
+ *
+ * \author Farès BELHADJ, amsi@ai.univ-paris8.fr
+ * \date October 14 2026
+ */
+#ifndef _VCACHE_H
+#define _VCACHE_H
+
+#include <GL4D/gl4dummies.h>
+
+/*!\brief taille du cache LRU modélisé par vcacheOptimize */
+#define VCACHE_LRU_SIZE 32
+/*!\brief taille du cache FIFO simulé par vcacheACMR, prudente pour
+ * ne pas surestimer les GPU anciens */
+#define VCACHE_FIFO_SIZE 16
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  extern void    vcacheOptimize(GLushort * indices, int nindices, int nvertices);
+  extern GLfloat vcacheACMR(const GLushort * indices, int nindices, int nvertices);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
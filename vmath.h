@@ -0,0 +1,99 @@
+/*!\file vmath.h
+ *
+ * \brief quelques opérations sur les matrices 4x4 rangées par lignes
+ * (convention GL4Dummies) utilisées côté CPU.
+ *
+ * \author Farès BELHADJ, amsi@ai.univ-paris8.fr
+ * \date October 14 2026
+ */
+#ifndef _VMATH_H
+#define _VMATH_H
+
+#include <GL4D/gl4dummies.h>
+#include <math.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  /*!\brief produit r = a x b ; r doit être distinct de a et b */
+  static inline void mat4Mult(GLfloat * r, const GLfloat * a, const GLfloat * b) {
+    int i, j;
+    for(i = 0; i < 4; i++)
+      for(j = 0; j < 4; j++)
+        r[4 * i + j] = a[4 * i] * b[j] + a[4 * i + 1] * b[4 + j] + a[4 * i + 2] * b[8 + j] + a[4 * i + 3] * b[12 + j];
+  }
+
+  /*!\brief matrice des normales n (3x3) de m : inverse transposée de
+   * la partie 3x3 de m, soit ses cofacteurs divisés par son
+   * déterminant */
+  static inline void mat4NormalMatrix(GLfloat * n, const GLfloat * m) {
+    int i;
+    GLfloat det;
+    n[0] = m[5] * m[10] - m[6] * m[9];
+    n[1] = m[6] * m[8]  - m[4] * m[10];
+    n[2] = m[4] * m[9]  - m[5] * m[8];
+    n[3] = m[2] * m[9]  - m[1] * m[10];
+    n[4] = m[0] * m[10] - m[2] * m[8];
+    n[5] = m[1] * m[8]  - m[0] * m[9];
+    n[6] = m[1] * m[6]  - m[2] * m[5];
+    n[7] = m[2] * m[4]  - m[0] * m[6];
+    n[8] = m[0] * m[5]  - m[1] * m[4];
+    det = m[0] * n[0] + m[1] * n[1] + m[2] * n[2];
+    for(i = 0; i < 9; i++)
+      n[i] /= det;
+  }
+
+  /*!\brief matrice de vue m de l'œil e visant c, verticale u, comme
+   * gl4duLookAtf appliquée à l'identité ; utilisable hors du thread GL
+   * (pile de matrices de GL4Dummies non partagée) */
+  static inline void mat4LookAt(GLfloat * m, const GLfloat e[3], const GLfloat c[3], const GLfloat u[3]) {
+    int i;
+    GLfloat f[3], s[3], v[3], n;
+    for(i = 0; i < 3; i++)
+      f[i] = c[i] - e[i];
+    n = sqrtf(f[0] * f[0] + f[1] * f[1] + f[2] * f[2]);
+    for(i = 0; i < 3; i++)
+      f[i] /= n;
+    s[0] = f[1] * u[2] - f[2] * u[1];
+    s[1] = f[2] * u[0] - f[0] * u[2];
+    s[2] = f[0] * u[1] - f[1] * u[0];
+    n = sqrtf(s[0] * s[0] + s[1] * s[1] + s[2] * s[2]);
+    for(i = 0; i < 3; i++)
+      s[i] /= n;
+    v[0] = s[1] * f[2] - s[2] * f[1];
+    v[1] = s[2] * f[0] - s[0] * f[2];
+    v[2] = s[0] * f[1] - s[1] * f[0];
+    for(i = 0; i < 3; i++) {
+      m[i] = s[i];
+      m[4 + i] = v[i];
+      m[8 + i] = -f[i];
+      m[12 + i] = 0.0f;
+    }
+    m[3]  = -(s[0] * e[0] + s[1] * e[1] + s[2] * e[2]);
+    m[7]  = -(v[0] * e[0] + v[1] * e[1] + v[2] * e[2]);
+    m[11] =   f[0] * e[0] + f[1] * e[1] + f[2] * e[2];
+    m[15] = 1.0f;
+  }
+
+  /*!\brief projection perspective m du frustum (l, r, b, t) au plan
+   * proche n, plan lointain f, comme gl4duFrustumf appliquée à
+   * l'identité */
+  static inline void mat4Frustum(GLfloat * m, GLfloat l, GLfloat r, GLfloat b, GLfloat t, GLfloat n, GLfloat f) {
+    int i;
+    for(i = 0; i < 16; i++)
+      m[i] = 0.0f;
+    m[0]  = 2.0f * n / (r - l);
+    m[2]  = (r + l) / (r - l);
+    m[5]  = 2.0f * n / (t - b);
+    m[6]  = (t + b) / (t - b);
+    m[10] = -(f + n) / (f - n);
+    m[11] = -2.0f * f * n / (f - n);
+    m[14] = -1.0f;
+  }
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,211 @@
+/*!\file water.c
+ *
+ * \brief précalcul (render-to-texture) de la surface animée de
+ * l'eau. Le champ de hauteur alt() (octaves de bruit, jusqu'à la
+ * limite de Nyquist de la carte) puis son gradient de Sobel sont rendus
+ * dans des textures une fois par pas d'animation ; le fragment d'eau
+ * n'a plus qu'à lire la carte de perturbation obtenue au lieu d'évaluer
+ * 72 fois le bruit.
+ *
+ * Deux cartes sont maintenues, aux pas k et k + 1 de l'animation, et
+ * interpolées selon la position de cycle entre ces deux pas : la
+ * période de précalcul peut ainsi être bien plus longue qu'une frame
+ * sans que l'animation ne saccade.
+ *
+ * \author Farès BELHADJ, amsi@ai.univ-paris8.fr
+ * \date October 14 2026
+ */
+#include "noise.h"
+#include "variant.h"
+#include "resources.h"
+#include <GL4D/gl4du.h>
+#include <GL4D/gl4dg.h>
+#include <stdio.h>
+#include <math.h>
+#include <assert.h>
+
+/*!\brief nombre maximal d'octaves du champ de hauteur */
+#define WATER_OCTAVES 8
+/*!\brief fréquence de la première octave (périodes sur la largeur de la
+ * carte) et rapport de fréquence entre deux octaves, cf. alt() dans
+ * shaders/water.fs */
+#define WATER_FREQUENCY 100.0f
+#define WATER_LACUNARITY 2.2f
+
+/*!\brief spécialisation du champ de hauteur : nombre d'octaves de bruit */
+static char _defines[32];
+
+/*!\brief résolution (en texels) des textures précalculées */
+static int _size = 0;
+/*!\brief période (en secondes de cycle) entre deux pas précalculés */
+static GLfloat _period = 1.0f / 30.0f;
+/*!\brief framebuffer utilisé pour le précalcul */
+static GLuint _fbo = 0;
+/*!\brief quad plein écran du précalcul */
+static GLuint _quad = 0;
+/*!\brief programmes GLSL : champ de hauteur et gradient de Sobel */
+static GLuint _heightPId = 0, _normalPId = 0;
+/*!\brief emplacement de l'uniforme cycle de _heightPId */
+static GLint _cycleLoc = -1;
+/*!\brief texture intermédiaire du champ de hauteur */
+static GLuint _heightTexId = 0;
+/*!\brief cartes de perturbation aux pas _step et _step + 1 */
+static GLuint _mapTexId[2] = {0, 0};
+/*!\brief pas d'animation associé à _mapTexId[0], -1 si aucun */
+static int _step = -1;
+
+/*!\brief texture _size x _size, de texel octets par texel */
+static GLuint genTexture(GLint internalFormat, GLenum format, int texel) {
+  GLuint id;
+  glGenTextures(1, &id);
+  glBindTexture(GL_TEXTURE_2D, id);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, _size, _size, 0, format, GL_FLOAT, NULL);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  resTrack(RES_TEXTURE, id, RES_WATER, texel * (size_t)_size * _size);
+  return id;
+}
+
+/*!\brief création des programmes, textures et framebuffer du
+ * précalcul ; size est la résolution des cartes produites. Nécessite
+ * que initNoiseTextures ait été appelée. */
+extern void initWater(int size) {
+  int octaves;
+  if(_fbo)
+    return;
+  _size = size;
+  /* octaves jusqu'à une période d'environ deux texels : au-delà, la
+   * carte les replierait en basses fréquences */
+  for(octaves = 1; octaves < WATER_OCTAVES && WATER_FREQUENCY * powf(WATER_LACUNARITY, octaves) <= size / 2.0f; octaves++);
+  snprintf(_defines, sizeof _defines, "OCTAVES=%d", octaves);
+  _heightPId = noiseProgram(_defines, "<vs>shaders/water.vs", "<fs>shaders/water.fs");
+  _normalPId = variantProgram("", "<vs>shaders/water.vs", "<fs>shaders/waternormal.fs", NULL);
+  /* emplacements et samplers résolus une fois pour toutes */
+  _cycleLoc = glGetUniformLocation(_heightPId, "cycle");
+  glUseProgram(_normalPId);
+  glUniform1i(glGetUniformLocation(_normalPId, "height"), 0);
+  glUseProgram(0);
+  _quad = gl4dgGenQuadf();
+  resTrackGeometry(_quad, RES_WATER);
+  _heightTexId = genTexture(GL_R32F, GL_RED, 4);
+  _mapTexId[0] = genTexture(GL_RG16F, GL_RG, 4);
+  _mapTexId[1] = genTexture(GL_RG16F, GL_RG, 4);
+  glGenFramebuffers(1, &_fbo);
+  _step = -1;
+}
+
+/*!\brief reprend le programme du champ de hauteur avec le backend de
+ * bruit courant (cf. setNoiseBackend) et force un nouveau précalcul */
+extern void rebuildWater(void) {
+  if(!_fbo)
+    return;
+  _heightPId = noiseProgram(_defines, "<vs>shaders/water.vs", "<fs>shaders/water.fs");
+  _cycleLoc = glGetUniformLocation(_heightPId, "cycle");
+  glUseProgram(0);
+  _step = -1;
+}
+
+/*!\brief modifie la période de précalcul (en secondes de cycle). Une
+ * période nulle ou négative force un précalcul à chaque appel de
+ * updateWater. */
+extern void setWaterPeriod(GLfloat period) {
+  _period = period;
+  _step = -1;
+}
+
+/*!\brief rendu de la carte de perturbation de l'instant cycle dans
+ * mapTexId */
+static void bake(GLuint mapTexId, GLfloat cycle) {
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _heightTexId, 0);
+  glUseProgram(_heightPId);
+  glUniform1f(_cycleLoc, cycle);
+  gl4dgDraw(_quad);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, mapTexId, 0);
+  glUseProgram(_normalPId);
+  glBindTexture(GL_TEXTURE_2D, _heightTexId);
+  gl4dgDraw(_quad);
+  glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+/*!\brief met à jour les cartes si cycle a franchi un pas
+ * d'animation. Ne produit qu'une carte par pas franchi (la suivante),
+ * deux en cas de saut. L'état GL modifié est restauré. */
+extern void updateWater(GLfloat cycle) {
+  GLint vp[4], pId, pm[2], fb;
+  GLboolean depth, blend;
+  GLuint t;
+  int step = _period > 0.0f ? (int)floor(cycle / _period) : _step + 1;
+  if(step == _step)
+    return;
+  glGetIntegerv(GL_VIEWPORT, vp);
+  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &fb);
+  glGetIntegerv(GL_CURRENT_PROGRAM, &pId);
+  glGetIntegerv(GL_POLYGON_MODE, pm);
+  depth = glIsEnabled(GL_DEPTH_TEST);
+  blend = glIsEnabled(GL_BLEND);
+  glDisable(GL_DEPTH_TEST);
+  glDisable(GL_BLEND);
+  glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+  glBindFramebuffer(GL_FRAMEBUFFER, _fbo);
+  glViewport(0, 0, _size, _size);
+  if(_period <= 0.0f) {
+    bake(_mapTexId[0], cycle);
+  } else if(_step >= 0 && step == _step + 1) {
+    t = _mapTexId[0]; _mapTexId[0] = _mapTexId[1]; _mapTexId[1] = t;
+    bake(_mapTexId[1], (step + 1) * _period);
+  } else {
+    bake(_mapTexId[0], step * _period);
+    bake(_mapTexId[1], (step + 1) * _period);
+  }
+  _step = step;
+  glBindFramebuffer(GL_FRAMEBUFFER, fb);
+  glViewport(vp[0], vp[1], vp[2], vp[3]);
+  glPolygonMode(GL_FRONT_AND_BACK, pm[0]);
+  if(depth) glEnable(GL_DEPTH_TEST);
+  if(blend) glEnable(GL_BLEND);
+  glUseProgram(pId);
+}
+
+/*!\brief position de cycle entre les deux cartes courantes, à
+ * transmettre en waterBlend */
+extern GLfloat waterBlend(GLfloat cycle) {
+  GLfloat blend = _period > 0.0f ? cycle / _period - _step : 0.0f;
+  return blend < 0.0f ? 0.0f : (blend > 1.0f ? 1.0f : blend);
+}
+
+/*!\brief lie les deux cartes courantes (samplers waterMap0 et
+ * waterMap1) aux unités de texture shift et shift + 1 */
+extern void useWater(int shift) {
+  glActiveTexture(GL_TEXTURE0 + shift);
+  glBindTexture(GL_TEXTURE_2D, _mapTexId[0]);
+  glActiveTexture(GL_TEXTURE1 + shift);
+  glBindTexture(GL_TEXTURE_2D, _period > 0.0f ? _mapTexId[1] : _mapTexId[0]);
+  glActiveTexture(GL_TEXTURE0);
+}
+
+extern void unuseWater(int shift) {
+  glActiveTexture(GL_TEXTURE1 + shift);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glActiveTexture(GL_TEXTURE0 + shift);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glActiveTexture(GL_TEXTURE0);
+}
+
+extern void freeWater(void) {
+  if(_fbo) {
+    glDeleteFramebuffers(1, &_fbo);
+    _fbo = 0;
+  }
+  resDeleteTextures(1, &_heightTexId);
+  resDeleteTextures(2, _mapTexId);
+  _heightTexId = _mapTexId[0] = _mapTexId[1] = 0;
+  if(_quad) {
+    resUntrackGeometry(_quad);
+    gl4dgDelete(_quad);
+    _quad = 0;
+  }
+  _step = -1;
+}
@@ -0,0 +1,263 @@
+/*!\file waterpass.c
+ *
+ * \brief passe d'eau à résolution adaptative, cf. waterpass.h.
+ *
+ * \author Farès BELHADJ, amsi@ai.univ-paris8.fr
+ * \date October 14 2026
+ */
+#include "waterpass.h"
+#include "variant.h"
+#include "resources.h"
+#include <GL4D/gl4dg.h>
+#include <SDL.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*!\brief taille de la fenêtre et échelle courante de l'eau */
+static int _w = 0, _h = 0;
+static GLfloat _scale = 1.0f;
+/*!\brief régulateur : durée de frame lissée (ms, négative tant
+ * qu'inconnue), frames consécutives dans la cible, frames avant la
+ * prochaine baisse autorisée */
+static GLdouble _smoothed = -1.0;
+static int _calm = 0, _settle = 0;
+/*!\brief cible réduite (texture de la taille de la fenêtre dont seule
+ * la région de l'échelle courante est utilisée : changer d'échelle ne
+ * réalloue rien) */
+static GLuint _fbo = 0, _tex = 0;
+/*!\brief programme de recomposition et emplacements de ses uniformes */
+static program_t _up;
+static GLint _scaleLoc = -1, _sizeLoc = -1;
+/*!\brief mode actif entre waterPassBegin et waterPassEnd, région
+ * réduite dessinée et état GL à restaurer */
+static int _active = WATERPASS_FULL;
+static GLint _rw = 0, _rh = 0, _fb = 0, _vp[4];
+static GLboolean _depth, _blend;
+/*!\brief taux de shading variable : disponibilité, image des taux
+ * (indice 0 de la palette partout), taille de ses texels en pixels et
+ * points d'entrée de l'extension */
+static int _vrs = 0;
+static GLuint _rateTex = 0;
+static GLint _rateTexel[2] = {16, 16};
+#ifdef GL_NV_shading_rate_image
+static PFNGLBINDSHADINGRATEIMAGENVPROC _bindShadingRateImage = NULL;
+static PFNGLSHADINGRATEIMAGEPALETTENVPROC _shadingRateImagePalette = NULL;
+#endif
+
+/*!\brief l'extension name est-elle disponible ? */
+static int hasExtension(const char * name) {
+  GLint i, n = 0;
+  glGetIntegerv(GL_NUM_EXTENSIONS, &n);
+  for(i = 0; i < n; i++)
+    if(!strcmp((const char *)glGetStringi(GL_EXTENSIONS, i), name))
+      return 1;
+  return 0;
+}
+
+/*!\brief programme de recomposition, cible réduite et, si le pilote
+ * le permet, image des taux de shading, pour une fenêtre w x h */
+extern void waterPassInit(int w, int h) {
+  if(_fbo)
+    return;
+  programInit(&_up, variantProgram("", "<vs>shaders/basic.vs", "<fs>shaders/waterup.fs", NULL));
+  programSampler(&_up, "lowres", WATERPASS_UNIT);
+  _scaleLoc = glGetUniformLocation(_up.id, "scale");
+  _sizeLoc = glGetUniformLocation(_up.id, "size");
+  glUseProgram(0);
+  glGenTextures(1, &_tex);
+  glBindTexture(GL_TEXTURE_2D, _tex);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glGenFramebuffers(1, &_fbo);
+#ifdef GL_NV_shading_rate_image
+  if(hasExtension("GL_NV_shading_rate_image")) {
+    _bindShadingRateImage = (PFNGLBINDSHADINGRATEIMAGENVPROC)SDL_GL_GetProcAddress("glBindShadingRateImageNV");
+    _shadingRateImagePalette = (PFNGLSHADINGRATEIMAGEPALETTENVPROC)SDL_GL_GetProcAddress("glShadingRateImagePaletteNV");
+    _vrs = _bindShadingRateImage && _shadingRateImagePalette;
+  }
+  if(_vrs) {
+    glGetIntegerv(GL_SHADING_RATE_IMAGE_TEXEL_WIDTH_NV, &_rateTexel[0]);
+    glGetIntegerv(GL_SHADING_RATE_IMAGE_TEXEL_HEIGHT_NV, &_rateTexel[1]);
+    glGenTextures(1, &_rateTex);
+  }
+#endif
+  waterPassResize(w, h);
+}
+
+/*!\brief réallocation des cibles à la nouvelle taille de fenêtre */
+extern void waterPassResize(int w, int h) {
+  GLint fb;
+  if(!_fbo || (w == _w && h == _h))
+    return;
+  _w = w; _h = h;
+  glBindTexture(GL_TEXTURE_2D, _tex);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, _w, _h, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  resTrack(RES_TEXTURE, _tex, RES_WATER, 4 * (size_t)_w * _h);
+  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &fb);
+  glBindFramebuffer(GL_FRAMEBUFFER, _fbo);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _tex, 0);
+  glBindFramebuffer(GL_FRAMEBUFFER, fb);
+  if(_rateTex) {
+    /* un octet (indice de palette) par bloc de _rateTexel pixels */
+    int rw = (_w + _rateTexel[0] - 1) / _rateTexel[0], rh = (_h + _rateTexel[1] - 1) / _rateTexel[1];
+    GLubyte * zeros = calloc(rw * (size_t)rh, 1);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glBindTexture(GL_TEXTURE_2D, _rateTex);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8UI, rw, rh, 0, GL_RED_INTEGER, GL_UNSIGNED_BYTE, zeros);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    resTrack(RES_TEXTURE, _rateTex, RES_WATER, rw * (size_t)rh);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    free(zeros);
+  }
+}
+
+/*!\brief le mode est-il utilisable avec ce pilote ? */
+extern int waterPassSupported(int mode) {
+  return mode == WATERPASS_FULL || mode == WATERPASS_LOWRES || (mode == WATERPASS_VRS && _vrs);
+}
+
+extern const char * waterPassName(int mode) {
+  static const char * names[WATERPASS_MODES] = {"pleine résolution", "cible réduite", "taux de shading variable"};
+  return mode >= 0 && mode < WATERPASS_MODES ? names[mode] : "?";
+}
+
+/*!\brief régulation de l'échelle d'après la durée frameMs de la
+ * dernière frame et la durée visée targetMs : une baisse d'un pas dès
+ * que la durée lissée dépasse la cible de 10 % (au plus une toutes les
+ * WATERPASS_SETTLE frames), une remontée d'un pas après
+ * WATERPASS_PATIENCE frames lissées à moins de 2 % au-dessus de la
+ * cible. La marge de 2 % laisse remonter une frame calée sur la
+ * synchronisation verticale, dont la durée vaut exactement la cible. */
+extern void waterPassControl(GLdouble frameMs, GLdouble targetMs) {
+  _smoothed = _smoothed < 0.0 ? frameMs : _smoothed + WATERPASS_SMOOTHING * (frameMs - _smoothed);
+  if(_settle > 0)
+    _settle--;
+  if(_smoothed > 1.1 * targetMs) {
+    _calm = 0;
+    if(!_settle && _scale > WATERPASS_MIN_SCALE) {
+      waterPassSetScale(_scale - WATERPASS_STEP);
+      _settle = WATERPASS_SETTLE;
+    }
+  } else if(_smoothed <= 1.02 * targetMs) {
+    if(++_calm >= WATERPASS_PATIENCE && _scale < 1.0f) {
+      waterPassSetScale(_scale + WATERPASS_STEP);
+      _calm = 0;
+      _settle = WATERPASS_SETTLE;
+    }
+  } else
+    _calm = 0;
+}
+
+/*!\brief impose l'échelle, bornée à [WATERPASS_MIN_SCALE, 1] */
+extern void waterPassSetScale(GLfloat scale) {
+  _scale = scale < WATERPASS_MIN_SCALE ? WATERPASS_MIN_SCALE : (scale > 1.0f ? 1.0f : scale);
+}
+
+extern GLfloat waterPassScale(void) {
+  return _scale;
+}
+
+#ifdef GL_NV_shading_rate_image
+/*!\brief taux de shading dont la fraction d'invocations (1, 1/2, ...,
+ * 1/16) est la plus proche, en échelle logarithmique, de celle d'une
+ * cible réduite à l'échelle scale */
+static GLenum shadingRate(GLfloat scale) {
+  static const GLenum rates[] = {
+    GL_SHADING_RATE_1_INVOCATION_PER_PIXEL_NV,
+    GL_SHADING_RATE_1_INVOCATION_PER_1X2_PIXELS_NV,
+    GL_SHADING_RATE_1_INVOCATION_PER_2X2_PIXELS_NV,
+    GL_SHADING_RATE_1_INVOCATION_PER_2X4_PIXELS_NV,
+    GL_SHADING_RATE_1_INVOCATION_PER_4X4_PIXELS_NV
+  };
+  int k = (int)floor(-2.0 * log2(scale) + 0.5);
+  return rates[k < 0 ? 0 : (k > 4 ? 4 : k)];
+}
+#endif
+
+/*!\brief prépare le dessin de l'eau (programme, matrices et cartes à
+ * la charge de l'appelant) selon mode : rien à pleine résolution ou à
+ * l'échelle 1, la cible réduite effacée avec profondeur et mélange
+ * coupés, ou le taux de shading de l'échelle courante */
+extern void waterPassBegin(int mode) {
+  GLfloat clear[4];
+  _active = _scale >= 1.0f || !waterPassSupported(mode) ? WATERPASS_FULL : mode;
+  if(_active == WATERPASS_LOWRES) {
+    _rw = (GLint)(_w * _scale + 0.5f); _rw = _rw < 1 ? 1 : _rw;
+    _rh = (GLint)(_h * _scale + 0.5f); _rh = _rh < 1 ? 1 : _rh;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &_fb);
+    glGetIntegerv(GL_VIEWPORT, _vp);
+    glGetFloatv(GL_COLOR_CLEAR_VALUE, clear);
+    _depth = glIsEnabled(GL_DEPTH_TEST);
+    _blend = glIsEnabled(GL_BLEND);
+    glBindFramebuffer(GL_FRAMEBUFFER, _fbo);
+    glViewport(0, 0, _rw, _rh);
+    /* alpha nul : texel non couvert par l'eau, écarté par le filtre */
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(0, 0, _rw, _rh);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glClearColor(clear[0], clear[1], clear[2], clear[3]);
+    glDisable(GL_SCISSOR_TEST);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_BLEND);
+  }
+#ifdef GL_NV_shading_rate_image
+  else if(_active == WATERPASS_VRS) {
+    GLenum rate = shadingRate(_scale);
+    _shadingRateImagePalette(0, 0, 1, &rate);
+    _bindShadingRateImage(_rateTex);
+    glEnable(GL_SHADING_RATE_IMAGE_NV);
+  }
+#endif
+}
+
+/*!\brief termine le dessin de l'eau commencé par waterPassBegin : état
+ * GL restauré et, depuis la cible réduite, recomposition à pleine
+ * résolution de geometry (le plan d'eau) avec les mêmes matrices que
+ * son dessin */
+extern void waterPassEnd(const GLfloat * modelView, const GLfloat * projection, GLuint geometry) {
+  if(_active == WATERPASS_LOWRES) {
+    glBindFramebuffer(GL_FRAMEBUFFER, _fb);
+    glViewport(_vp[0], _vp[1], _vp[2], _vp[3]);
+    if(_depth) glEnable(GL_DEPTH_TEST);
+    if(_blend) glEnable(GL_BLEND);
+    glUseProgram(_up.id);
+    programMatrices(&_up, modelView, projection);
+    glUniform2f(_scaleLoc, _rw / (GLfloat)_w, _rh / (GLfloat)_h);
+    glUniform2i(_sizeLoc, _rw, _rh);
+    glActiveTexture(GL_TEXTURE0 + WATERPASS_UNIT);
+    glBindTexture(GL_TEXTURE_2D, _tex);
+    gl4dgDraw(geometry);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE0);
+  }
+#ifdef GL_NV_shading_rate_image
+  else if(_active == WATERPASS_VRS) {
+    glDisable(GL_SHADING_RATE_IMAGE_NV);
+    _bindShadingRateImage(0);
+  }
+#endif
+  _active = WATERPASS_FULL;
+}
+
+extern void waterPassFree(void) {
+  if(_fbo) {
+    glDeleteFramebuffers(1, &_fbo);
+    _fbo = 0;
+  }
+  resDeleteTextures(1, &_tex);
+  _tex = 0;
+  if(_rateTex) {
+    resDeleteTextures(1, &_rateTex);
+    _rateTex = 0;
+  }
+  _vrs = 0;
+  _w = _h = 0;
+}
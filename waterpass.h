@@ -0,0 +1,74 @@
+/*!\file waterpass.h
+ *
+ * \brief passe d'eau à résolution adaptative : le coût du fragment
+ * d'eau croît avec le nombre de pixels, le terrain garde la résolution
+ * de la fenêtre et seule l'eau est éclairée à une échelle réglée par
+ * frame.
+ *
+ * - WATERPASS_LOWRES : le plan d'eau est éclairé dans une cible réduite
+ *   (échelle x échelle de la fenêtre), sans test de profondeur et sans
+ *   mélange, puis redessiné à pleine résolution par un programme de
+ *   recomposition qui lit cette cible. Le test de profondeur de la
+ *   recomposition découpe l'eau contre le terrain au pixel près et le
+ *   filtre ne mélange que les texels réduits couverts par l'eau (alpha
+ *   non nul) : pas de fuite de couleur aux silhouettes ni au bord du
+ *   plan.
+ * - WATERPASS_VRS : si GL_NV_shading_rate_image est disponible, l'eau
+ *   est dessinée directement à pleine résolution avec un taux de
+ *   shading grossier (1x2 à 4x4 pixels par invocation) équivalent à
+ *   l'échelle ; la couverture et la profondeur restent par pixel.
+ *
+ * L'échelle est réglée par waterPassControl contre une durée de frame
+ * cible : baisse rapide si la durée lissée dépasse la cible, remontée
+ * après WATERPASS_PATIENCE frames dans la cible (marge comprise pour
+ * les frames calées sur la synchronisation verticale). À l'échelle 1,
+ * les deux modes reviennent au dessin direct.
+ *
+ * \author Farès BELHADJ, amsi@ai.univ-paris8.fr
+ * \date October 14 2026
+ */
+#ifndef _WATERPASS_H
+#define _WATERPASS_H
+
+#include "program.h"
+
+/*!\brief unité de texture de la cible réduite pendant la recomposition */
+#define WATERPASS_UNIT 5
+/*!\brief échelle minimale et pas de réglage */
+#define WATERPASS_MIN_SCALE 0.25f
+#define WATERPASS_STEP 0.0625f
+/*!\brief frames consécutives dans la cible avant une remontée */
+#define WATERPASS_PATIENCE 60
+/*!\brief frames entre deux baisses, le temps que la durée lissée suive */
+#define WATERPASS_SETTLE 8
+/*!\brief poids de la dernière frame dans la durée lissée */
+#define WATERPASS_SMOOTHING 0.1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  /*!\brief modes de la passe d'eau */
+  enum wpmode_t {
+    WATERPASS_FULL = 0, /* pleine résolution */
+    WATERPASS_LOWRES,   /* cible réduite et recomposition */
+    WATERPASS_VRS,      /* taux de shading variable (GL_NV_shading_rate_image) */
+    WATERPASS_MODES
+  };
+
+  extern void         waterPassInit(int w, int h);
+  extern void         waterPassResize(int w, int h);
+  extern int          waterPassSupported(int mode);
+  extern const char * waterPassName(int mode);
+  extern void         waterPassControl(GLdouble frameMs, GLdouble targetMs);
+  extern void         waterPassSetScale(GLfloat scale);
+  extern GLfloat      waterPassScale(void);
+  extern void         waterPassBegin(int mode);
+  extern void         waterPassEnd(const GLfloat * modelView, const GLfloat * projection, GLuint geometry);
+  extern void         waterPassFree(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
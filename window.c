@@ -11,18 +11,42 @@
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
 #include <time.h>
 #include <assert.h>
+#include <unistd.h>
 #include <GL4D/gl4du.h>
 #include <GL4D/gl4dg.h>
 #include <GL4D/gl4duw_SDL2.h>
 #include <SDL_image.h>
+#include "terrain.h"
+#include "program.h"
+#include "vmath.h"
+#include "heightgen.h"
+#include "gpugen.h"
+#include "tilefile.h"
+#include "jobs.h"
+#include "noise.h"
+#include "variant.h"
+#include "profiler.h"
+#include "bench.h"
+#include "waterpass.h"
+#include "snapshot.h"
+#include "gpucull.h"
+#include "clipmap.h"
+#include "resources.h"
+#include "farfield.h"
 
-/* fonctions externes dans noise.c */
-extern void initNoiseTextures(void);
-extern void useNoiseTextures(GLuint pid, int shift);
-extern void unuseNoiseTextures(int shift);
-extern void freeNoiseTextures(void);
+/* fonctions externes dans water.c */
+extern void initWater(int size);
+extern void rebuildWater(void);
+extern void setWaterPeriod(GLfloat period);
+extern void updateWater(GLfloat cycle);
+extern GLfloat waterBlend(GLfloat cycle);
+extern void useWater(int shift);
+extern void unuseWater(int shift);
+extern void freeWater(void);
 /* fonctions locales, statiques */
 static void quit(void);
 static void init(void);
@@ -31,7 +55,32 @@ static void idle(void);
 static void keydown(int keycode);
 static void keyup(int keycode);
 static void draw(void);
-static GLfloat heightMapAltitude(GLfloat x, GLfloat z);
+typedef struct fstate_t fstate_t;
+typedef struct fpart_t fpart_t;
+static void report(const fstate_t * f);
+static const char * selectionName(void);
+static void generate(void);
+static void generated(void);
+static void landscape(void);
+static int openWorld(void);
+static void stream(void);
+static void streamCancel(void);
+static void useTerrainProgram(const program_t * p, const GLfloat * modelView, const GLfloat * proj);
+static void passBegin(int pass);
+static void passEnd(void);
+static void samplesRead(void);
+static void brush(GLfloat amount);
+static void benchInit(void);
+static void benchFrame(void);
+static void prepare(unsigned int frame, GLdouble dt, int xm, int ym);
+static void frameJob(void * arg);
+static void pickJob(void * arg);
+static void selectJob(void * arg);
+static void drawLandscape(const fstate_t * f, GLuint commands);
+static void tessPrograms(void);
+static void terrainPrograms(void);
+static void clipFill(void * arg, int level, int x0, int z0, int w, int h, GLubyte * albedo, GLubyte * normal);
+static void farScene(void * arg, const GLfloat eye[3], const GLfloat * view, const GLfloat * proj, GLfloat kscreen);
 
 /*!\brief largeur de la fentre */
 static int _windowWidth = 800;
@@ -45,18 +94,181 @@ static int _landscape_h = 513;
 static GLfloat _landscape_scale_xz = 100.0f;
 /*!\brief scale en y du modle de terrain */
 static GLfloat _landscape_scale_y = 10.0f;
+/*!\brief graine de la gnration du terrain : mme graine, mme
+ * terrain */
+static unsigned int _landscape_seed = 2017;
+/*!\brief gnration de la heightMap sur GPU (1) ou CPU (0) */
+static int _landscape_gpu = 0;
 /*!\brief heightMap du terrain gnr */
 static GLfloat * _heightMap = NULL;
+/*!\brief relecture de la heightMap gnre sur GPU en cours (cf.
+ * gpuGenReadBegin) et instant de son lancement */
+static int _gen_pending = 0;
+static Uint64 _gen_t0 = 0;
+/*!\brief monde prcalcul par bakeheight (premier argument de la
+ * ligne de commande), NULL pour gnrer le terrain */
+static const char * _landscape_file = NULL;
+/*!\brief monde prcalcul ouvert, dont _heightMap est la fentre
+ * autour de la camra */
+static tilefile_t * _world = NULL;
+/*!\brief tapes du dplacement asynchrone de la fentre de _world */
+enum sstate_t {
+  STREAM_IDLE = 0,  /* fentre  jour */
+  STREAM_LOAD,      /* tuiles en cours de dcodage dans _back */
+  STREAM_PREPARE,   /* terrain en cours de prparation sur _back */
+  STREAM_UPLOAD     /* terrain en cours de transfert vers le GPU */
+};
+static int _stream_state = STREAM_IDLE;
+/*!\brief fentre en cours de chargement et dplacement qui y mne */
+static heightmap_t _back;
+static tfmove_t _move;
+/*!\brief tches en cours de l'tape de chargement */
+static SDL_atomic_t _pending;
+/*!\brief instant du dbut du dplacement en cours */
+static Uint64 _stream_t0 = 0;
+/*!\brief octets de terrain transfrs au GPU par frame pendant un
+ * dplacement */
+static GLsizeiptr _upload_budget = 2 << 20;
+/*!\brief budget (octets) du cache des tuiles dcodes de _world, second
+ * argument de la ligne de commande en Mo (cf. tilefile.h) */
+static size_t _tile_budget = 64 << 20;
 /*!\brief identifiant d'un plan (eau) */
 static GLuint _plan = 0;
-/*!\brief identifiant du terrain gnr */
-static GLuint _landscape = 0;
-/*!\brief identifiant GLSL program du terrain */
-static GLuint _landscape_pId  = 0;
+/*!\brief description de la heightMap pour le terrain */
+static heightmap_t _hm;
+/*!\brief terrain gnr, dcoup en tuiles de _landscape_tile quads */
+static terrain_t * _landscape = NULL;
+/*!\brief stockage des sommets du terrain (tmode_t) : maillage par
+ * tuile ou grille partage dplace par texture */
+static int _landscape_mode = TERRAIN_MESHES;
+/*!\brief nombre de quads par ct d'une tuile de terrain */
+static int _landscape_tile = 64;
+/*!\brief budget de triangles de terrain par frame */
+static int _landscape_budget = 500000;
+/*!\brief choix des tuiles sur GPU (cf. gpucull.h) disponible, activ */
+static int _gpu_cull_supported = 0, _gpu_cull = 0;
+/*!\brief dessin en patchs de tessellation (grille partage), sans
+ * slection de tuiles, et longueur  l'cran (pixels) d'un segment */
+static int _tess = 0;
+static GLfloat _tess_pixels = 8.0f;
+/*!\brief couleur et normale du terrain lues dans le clipmap centr sur
+ * la camra (touche m) plutt que dans le dgrad d'altitude */
+static int _clip = 1;
+static clipmap_t * _clipmap = NULL;
+/*!\brief ct des fentres du clipmap et texels du niveau 0 par
+ * chantillon de la heightMap */
+static int _clip_size = 256, _clip_scale = 2;
+/*!\brief copie RGB du dgrad d'altitude (alt.png), matriau des
+ * texels produits pour le clipmap */
+static GLubyte * _palette = NULL;
+static int _palette_n = 0;
+/*!\brief champ lointain (touche f) : au-del de _far_near (monde), le
+ * terrain est lu dans un cube captur autour de l'oeil (cf.
+ * farfield.h), recaptur quand l'oeil s'en loigne de plus de
+ * _far_threshold ; ct des faces du cube */
+static int _far = 1;
+static GLfloat _far_near = 60.0f, _far_threshold = 2.0f;
+static int _far_size = 512;
+/*!\brief plan lointain de la projection ; avec le champ lointain, la
+ * gomtrie dessine s'arrte bien avant */
+static GLfloat _far_plane = 10000.0f;
+/*!\brief programmes de capture du champ lointain (maillages et grille
+ * partage) et tuiles choisies pour la face capture */
+static program_t _landscape_far_prog, _grid_far_prog;
+static tselection_t * _far_sel = NULL;
+/*!\brief programme GLSL du terrain et emplacements de ses uniformes */
+static program_t _landscape_prog;
+/*!\brief programme GLSL du terrain en mode grille partage */
+static program_t _grid_prog;
+/*!\brief programme GLSL de l'eau */
+static program_t _water_prog;
+/*!\brief programmes de la pr-passe de profondeur du terrain (maillages
+ * et grille partage) */
+static program_t _landscape_depth_prog, _grid_depth_prog;
+/*!\brief programmes des patchs de tessellation, construits  la
+ * premire bascule (touche t) : clair et pr-passe */
+static program_t _tess_prog, _tess_depth_prog;
+/*!\brief enchanement des passes de rendu (champ _pipeline) */
+enum pipeline_t {
+  PIPELINE_FORWARD = 0, /* terrain puis eau, clairs au fil du test de profondeur */
+  PIPELINE_PREPASS      /* profondeur seule du terrain, puis passes claires
+                         * en GL_LEQUAL sans criture de profondeur */
+};
+static int _pipeline = PIPELINE_PREPASS;
+/*!\brief passes comptes par les statistiques de sur-dessin */
+enum rpass_t {
+  PASS_DEPTH = 0,
+  PASS_TERRAIN,
+  PASS_WATER,
+  PASSES
+};
+/*!\brief requtes GL_SAMPLES_PASSED des frames paires et impaires,
+ * relues une frame plus tard pour ne pas attendre le GPU ; drapeau des
+ * requtes mises */
+static GLuint _samples_queries[2][PASSES];
+static int _samples_issued[2][PASSES];
+/*!\brief fragments ayant pass le test de profondeur, par passe,  la
+ * dernire frame relue */
+static GLuint _samples[PASSES];
+/*!\brief nombre de frames dessines */
+static unsigned int _frame = 0;
+/*!\brief phases de la frame mesures par le profileur */
+enum phase_t {
+  PHASE_IDLE = 0, /* chargement et retouches du monde */
+  PHASE_BAKE,     /* prcalcul de l'eau (bruit) */
+  PHASE_SELECT,   /* attente de la prparation de la frame suivante */
+  PHASE_PREPASS,  /* pr-passe de profondeur */
+  PHASE_TERRAIN,
+  PHASE_WATER,
+  PHASE_FAR,      /* capture du champ lointain */
+  PHASES
+};
+static int _phases[PHASES];
+/*!\brief affichage des dures par phase en surimpression */
+static int _overlay = 0;
+/*!\brief fichier de l'enregistrement du profil frame par frame (CSV, ou
+ * Chrome trace si son nom se termine par .json) */
+static const char * _profile_file = "profile.json";
+static int _recording = 0;
+/*!\brief fichier des images cls de camra ajoutes par la touche k
+ * (chemins du banc d'essai, cf. bench.h) */
+static const char * _camera_file = "camera.path";
+/*!\brief frames de chauffe (compilations, premiers transferts) non
+ * mesures par le banc d'essai */
+#define BENCH_WARMUP 30
+/*!\brief banc d'essai (benchrender) : nombre de frames mesures, 0 en
+ * mode interactif */
+static int _bench_frames = 0;
+/*!\brief chemin de camra du banc d'essai, lu de _bench_path_file ou
+ * cercle par dfaut */
+static campath_t * _bench_path = NULL;
+static const char * _bench_path_file = NULL;
+/*!\brief occlusion Hi-Z du choix des tuiles sur GPU (-x) pendant le
+ * banc d'essai, retire par -j */
+static int _bench_occlusion = 1;
+/*!\brief enregistrement du profil du banc d'essai, NULL pour aucun */
+static const char * _bench_trace = NULL;
+/*!\brief cible de rendu hors cran du banc d'essai : couleur et
+ * profondeur */
+static GLuint _bench_fbo = 0, _bench_tex[2] = {0, 0};
+/*!\brief dures (ms) des frames mesures et fin de la frame prcdente */
+static GLdouble * _bench_times = NULL;
+static Uint64 _bench_t0 = 0;
 /*!\brief identifiant de la texture de dgrad de couleurs du terrain */
 static GLuint _terrain_tId = 0;
-/*!\brief dphasage du cycle */
-static GLfloat _cycle = 0.0f;
+/*!\brief rsolution de la carte de perturbation prcalcule de l'eau */
+static int _water_size = 1024;
+/*!\brief priode (en secondes) de mise  jour de la carte de l'eau,
+ * indpendante du framerate */
+static GLfloat _water_period = 1.0f / 30.0f;
+/*!\brief passe d'eau (wpmode_t) : pleine rsolution, cible rduite ou
+ * taux de shading variable,  l'chelle rgle contre
+ * _water_target_ms ; le terrain reste  la rsolution de la fentre */
+static int _water_mode = WATERPASS_LOWRES;
+static GLdouble _water_target_ms = 1000.0 / 60.0;
+/*!\brief rpertoire du cache des binaires de programmes GLSL, NULL
+ * pour toujours compiler */
+static const char * _shader_cache = "shadercache";
 
 /*!\brief indices des touches de clavier */
 enum kyes_t {
@@ -68,24 +280,163 @@ enum kyes_t {
 
 /*!\brief clavier virtuel */
 static GLuint _keys[] = {0, 0, 0, 0};
+/*!\brief affichage priodique des statistiques de rendu */
+static int _report = 0;
+/*!\brief point du terrain sous le curseur (monde) de la dernire
+ * frame dessine, valide si _picked */
+static GLfloat _pick[3] = {0, 0, 0};
+static int _picked = 0;
+/*!\brief pinceau de retouche du relief sous le curseur (touches e et
+ * u) : rayon et profondeur (monde) */
+static GLfloat _brush_radius = 3.0f;
+static GLfloat _brush_amount = 0.5f;
 
 typedef struct cam_t cam_t;
 /*!\brief structure de donnes pour la camra */
 struct cam_t {
   GLfloat x, z;
   GLfloat theta;
+  GLfloat pitch; /* abaissement du point vis, en hauteurs de fentre */
+};
+
+/*!\brief nombre maximal de parties de la slection des tuiles d'une
+ * frame (cf. terrainSelectPart) */
+#define FRAME_PARTS 16
+
+/*!\brief argument de la tche de la partie index de la slection de
+ * l'tat f */
+struct fpart_t {
+  fstate_t * f;
+  int index;
+};
+
+/*!\brief tat d'une frame : entres releves par le thread GL au dpt
+ * de sa prparation (prepare), puis simulation, vue, slection des
+ * tuiles et picking calculs par les tches de frame (frameJob,
+ * selectJob, pickJob) ; draw ne le lit qu'une fois publi (cf. snapshot.h). La
+ * camra et le cycle n'existent que dans les tats : chaque prparation
+ * les fait avancer depuis ceux de l'tat publi prcdent. */
+struct fstate_t {
+  unsigned int frame;       /* frame  dessiner */
+  GLdouble dt;              /* pas de simulation */
+  GLuint keys[4];
+  int xm, ym, w, h;         /* curseur et fentre */
+  GLfloat proj[16];
+  const fstate_t * prev;    /* tat publi d'o part la simulation, NULL au dpart */
+  GLfloat shift[2];         /* dcalage (x, z) de la camra en attente (cf. stream) */
+  cam_t cam;
+  GLfloat cycle;
+  GLfloat eye[3], view[16];
+  GLfloat vp[16];           /* projection x vue de la slection */
+  tselection_t * sel;       /* tuiles retenues, propre  l'tat */
+  int nparts;               /* parties de la slection, 0 sans slection */
+  tselection_t * part[FRAME_PARTS];
+  fpart_t args[FRAME_PARTS];
+  int picked;
+  GLfloat pick[3];
+  Uint64 t0;
+  GLdouble ms;              /* dure de la prparation */
+  SDL_atomic_t parts;       /* tches de frame non termines */
 };
 
-/*!\brief la camra */
-static cam_t _cam = {0, 0, 0};
+/*!\brief tats de frame en triple tampon : celui que draw soumet,
+ * celui que prparent les tches de frame, le dernier publi. Hors de
+ * la prparation, que draw attend avant de rendre la main aux
+ * vnements et  idle, le terrain n'est touch que par le thread GL ;
+ * celui-ci ne lit la camra que par snapshotsRead et ne la modifie que
+ * par un dcalage en attente (_cam_shift), appliqu par la prparation
+ * suivante. */
+static fstate_t _fstates[3];
+static snapshots_t _snapshots;
+/*!\brief dcalage (x, z) de la camra (monde)  transmettre  la
+ * prochaine prparation */
+static GLfloat _cam_shift[2] = {0.0f, 0.0f};
+/*!\brief tches de frame en cours */
+static SDL_atomic_t _frame_pending;
+/*!\brief parties de la slection d'une frame : une par thread de
+ * travail, dans la limite de FRAME_PARTS */
+static int _frame_parts = 1;
+/*!\brief l'tat prpar ne vaut plus (terrain remplac ou dplac,
+ * projection change) : draw le recalcule avant de dessiner */
+static int _resync = 1;
+/*!\brief dure (s) de la frame prcdente, pas de la prochaine
+ * simulation */
+static GLdouble _dt = 0.0;
+
+#ifdef BENCHMARK
+/*!\brief options du banc d'essai ; retourne 0 (usage affich) si elles
+ * sont invalides */
+static int benchArgs(int argc, char ** argv) {
+  int c;
+  _bench_frames = 600;
+  /* chelle de l'eau fixe (pleine rsolution par dfaut) : frames
+   * comparables d'une excution  l'autre */
+  _water_mode = WATERPASS_FULL;
+  while((c = getopt(argc, argv, "s:n:r:f:c:t:w:xj")) != -1) {
+    switch(c) {
+    case 's':
+      _landscape_seed = (unsigned int)strtoul(optarg, NULL, 10);
+      break;
+    case 'n':
+      _landscape_w = _landscape_h = atoi(optarg);
+      break;
+    case 'r':
+      if(sscanf(optarg, "%dx%d", &_windowWidth, &_windowHeight) != 2)
+        _windowWidth = 0;
+      break;
+    case 'f':
+      _bench_frames = atoi(optarg);
+      break;
+    case 'c':
+      _bench_path_file = optarg;
+      break;
+    case 't':
+      _bench_trace = optarg;
+      break;
+    case 'w':
+      waterPassSetScale((GLfloat)atof(optarg));
+      _water_mode = waterPassScale() < 1.0f ? WATERPASS_LOWRES : WATERPASS_FULL;
+      break;
+    case 'x':
+      _gpu_cull = 1;
+      break;
+    case 'j':
+      _bench_occlusion = 0;
+      break;
+    default:
+      _bench_frames = 0;
+    }
+  }
+  if(_bench_frames <= 0 || _windowWidth <= 0 || _windowHeight <= 0 || _landscape_w < 3 ||
+     ((_landscape_w - 1) & (_landscape_w - 2))) {
+    fprintf(stderr, "usage : %s [-s graine] [-n ct 2^k + 1] [-r LxH] [-f frames] [-c chemin] [-t profil] [-w chelle eau] [-x (tuiles sur GPU)] [-j (sans occlusion)]\n", argv[0]);
+    return 0;
+  }
+  return 1;
+}
+#endif
 
 /*!\brief cration de la fentre, paramtrage et initialisation,
  * lancement de la boucle principale */
 int main(int argc, char ** argv) {
+  Uint32 flags = SDL_WINDOW_RESIZABLE | SDL_WINDOW_SHOWN;
+#ifdef BENCHMARK
+  /* rendu hors cran dans une fentre cache, cf. benchInit */
+  if(!benchArgs(argc, argv))
+    return 1;
+  flags = SDL_WINDOW_HIDDEN;
+#else
+  if(argc > 1)
+    _landscape_file = argv[1];
+  if(argc > 2)
+    _tile_budget = (size_t)(atof(argv[2]) * (1 << 20));
+#endif
   if(!gl4duwCreateWindow(argc, argv, "Landscape", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
-                         _windowWidth, _windowHeight, SDL_WINDOW_RESIZABLE | SDL_WINDOW_SHOWN))
+                         _windowWidth, _windowHeight, flags))
     return 1;
   init();
+  if(_bench_frames)
+    benchInit();
   atexit(quit);
   gl4duwResizeFunc(resize);
   gl4duwKeyUpFunc(keyup);
@@ -99,8 +450,12 @@ int main(int argc, char ** argv) {
 /*!\brief paramtrage OpenGL et initialisation des donnes */
 static void init(void) {
   SDL_Surface * t;
-  /* pour gnrer une chaine alatoire diffrente par excution */
-  srand(time(NULL));
+  int compiled, loaded, k, samples[2];
+  /* excutions reproductibles : tout l'ala drive de la graine */
+  srand(_landscape_seed);
+  /* registre des ressources, avant toute allocation suivie */
+  resInit();
+  resSetBudget(RES_TILES, _tile_budget);
   /* paramtres GL */
   glClearColor(0.0f, 0.4f, 0.9f, 0.0f);
   glEnable(GL_DEPTH_TEST);
@@ -108,8 +463,33 @@ static void init(void) {
   glCullFace(GL_BACK);
   glEnable(GL_BLEND);
   glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-  /* chargement et compilation des shaders */
-  _landscape_pId  = gl4duCreateProgram("<vs>shaders/basic.vs", "<fs>shaders/basic.fs", NULL);
+  /* chargement et compilation des shaders : une variante de basic.fs
+   * par surface plutt qu'un branchement par fragment */
+  variantCacheDir(_shader_cache);
+  snapshotsInit(&_snapshots, &_fstates[0], &_fstates[1], &_fstates[2]);
+  _gpu_cull_supported = gpuCullInit();
+  terrainPrograms();
+  programInit(&_water_prog, variantProgram("WATER", "<vs>shaders/basic.vs", "<fs>shaders/basic.fs", NULL));
+  programInit(&_landscape_depth_prog, variantProgram("DEPTH_ONLY", "<vs>shaders/mesh.vs", "<fs>shaders/basic.fs", NULL));
+  programSampler(&_landscape_depth_prog, "nodes", TERRAIN_NODES_UNIT);
+  programInit(&_grid_depth_prog, variantProgram("DEPTH_ONLY", "<vs>shaders/terrain.vs", "<fs>shaders/basic.fs", NULL));
+  programSampler(&_grid_depth_prog, "heights", TERRAIN_HEIGHT_UNIT);
+  programSampler(&_grid_depth_prog, "normals", TERRAIN_NORMAL_UNIT);
+  programSampler(&_water_prog, "waterMap0", 1);
+  programSampler(&_water_prog, "waterMap1", 2);
+  waterPassInit(_windowWidth, _windowHeight);
+  farFieldInit(_far_size);
+  /* uniform buffer de l'tat partag par frame */
+  frameInit();
+  glGenQueries(2 * PASSES, &_samples_queries[0][0]);
+  profInit();
+  _phases[PHASE_IDLE] = profPhase("monde");
+  _phases[PHASE_BAKE] = profPhase("precalcul eau");
+  _phases[PHASE_SELECT] = profPhase("attente frame");
+  _phases[PHASE_PREPASS] = profPhase("pre-passe");
+  _phases[PHASE_TERRAIN] = profPhase("terrain");
+  _phases[PHASE_WATER] = profPhase("eau");
+  _phases[PHASE_FAR] = profPhase("champ lointain");
   /* cration des matrices de model-view et projection */
   gl4duGenMatrix(GL_FLOAT, "modelViewMatrix");
   gl4duGenMatrix(GL_FLOAT, "projectionMatrix");
@@ -117,10 +497,14 @@ static void init(void) {
   resize(_windowWidth, _windowHeight);
   /* cration de la gomtrie du plan */
   _plan = gl4dgGenQuadf();
-  /* gnration de la heightMap */
-  _heightMap = gl4dmTriangleEdge(_landscape_w, _landscape_h, 0.5);
-  /* cration de la gomtrie du terrain en fonction de la heightMap */
-  _landscape = gl4dgGenGrid2dFromHeightMapf(_landscape_w, _landscape_h, _heightMap);
+  resTrackGeometry(_plan, RES_WATER);
+  /* description de la heightMap, gnre une fois les textures de
+   * bruit cres */
+  _hm.w = _landscape_w;
+  _hm.h = _landscape_h;
+  _hm.data = NULL;
+  _hm.scale_xz = _landscape_scale_xz;
+  _hm.scale_y = _landscape_scale_y;
   /* cration, paramtrage, chargement et transfert de la texture
      contenant le dgrad de couleurs selon l'altitude (texture 1D) */
   glGenTextures(1, &_terrain_tId);
@@ -130,13 +514,37 @@ static void init(void) {
   glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
   t = IMG_Load("alt.png");
   assert(t);
+  _palette_n = t->w;
+  _palette = malloc(3 * _palette_n);
+  assert(_palette);
+  for(k = 0; k < 3 * _palette_n; k++)
+#ifdef __APPLE__
+    _palette[k] = ((GLubyte *)t->pixels)[(k / 3) * t->format->BytesPerPixel + 2 - k % 3];
+#else
+    _palette[k] = ((GLubyte *)t->pixels)[(k / 3) * t->format->BytesPerPixel + k % 3];
+#endif
 #ifdef __APPLE__
   glTexImage1D(GL_TEXTURE_1D, 0, GL_RGB, t->w, 0, t->format->BytesPerPixel == 3 ? GL_BGR : GL_BGRA, GL_UNSIGNED_BYTE, t->pixels);
 #else
   glTexImage1D(GL_TEXTURE_1D, 0, GL_RGB, t->w, 0, t->format->BytesPerPixel == 3 ? GL_RGB : GL_RGBA, GL_UNSIGNED_BYTE, t->pixels);
 #endif
+  resTrack(RES_TEXTURE, _terrain_tId, RES_SHADING, 3 * (size_t)t->w);
   SDL_FreeSurface(t);
+  /* clipmap de couleur et de normales, rempli  la premire frame */
+  samples[0] = _hm.w - 1;
+  samples[1] = _hm.h - 1;
+  _clipmap = clipmapNew(_clip_size, _clip_scale, samples, clipFill, NULL);
   initNoiseTextures();
+  /* gnration de la heightMap et des tuiles de terrain */
+  gpuGenInit(&_hm);
+  jobsInit(0);
+  if(!_landscape_file || !openWorld())
+    generate();
+  /* textures et programmes du prcalcul de l'eau */
+  initWater(_water_size);
+  setWaterPeriod(_water_period);
+  variantStats(&compiled, &loaded);
+  fprintf(stderr, "programmes GLSL : %d compils, %d lus du cache\n", compiled, loaded);
 }
 
 /*!\brief paramtrage du viewport OpenGL et de la matrice de
@@ -144,9 +552,11 @@ static void init(void) {
  * fentre */
 static void resize(int w, int h) {
   glViewport(0, 0, _windowWidth = w, _windowHeight = h);
+  waterPassResize(w, h);
+  _resync = 1;
   gl4duBindMatrix("projectionMatrix");
   gl4duLoadIdentityf();
-  gl4duFrustumf(-0.5, 0.5, -0.5 * _windowHeight / _windowWidth, 0.5 * _windowHeight / _windowWidth, 1.0, 1000.0);
+  gl4duFrustumf(-0.5, 0.5, -0.5 * _windowHeight / _windowWidth, 0.5 * _windowHeight / _windowWidth, 1.0, _far_plane);
 }
 
 /*!\brief rcupration du delta temps entre deux appels */
@@ -158,26 +568,36 @@ static double get_dt(void) {
   return dt;
 }
 
-/*!\brief simulation : modification des paramtres de la camra
- * (LookAt) en fonction de l'interaction clavier */
+/*!\brief dbut de frame : pas de temps et mises  jour du monde
+ * (chargement, retouches) ; la simulation de la camra est faite par
+ * les tches de frame (frameJob) */
 static void idle(void) {
-  double dt, dtheta = M_PI, pas = 5.0;
+  double dt;
+  /* une frame du profileur va de idle  la fin de draw */
+  profFrameBegin();
+  profBegin(_phases[PHASE_IDLE]);
   dt = get_dt();
-  _cycle += dt;
-  if(_keys[KLEFT]) {
-    _cam.theta += dt * dtheta;
-  }
-  if(_keys[KRIGHT]) {
-    _cam.theta -= dt * dtheta;
+  /* banc d'essai : pas de temps fixe */
+  if(_bench_frames)
+    dt = 1.0 / 60.0;
+  else if(_water_mode != WATERPASS_FULL)
+    waterPassControl(1000.0 * dt, _water_target_ms);
+  _dt = dt;
+  stream();
+  if(_gen_pending && gpuGenReadEnd(&_hm, 0)) {
+    _gen_pending = 0;
+    generated();
   }
-  if(_keys[KUP]) {
-    _cam.x += -dt * pas * sin(_cam.theta);
-    _cam.z += -dt * pas * cos(_cam.theta);
-  }
-  if(_keys[KDOWN]) {
-    _cam.x += dt * pas * sin(_cam.theta);
-    _cam.z += dt * pas * cos(_cam.theta);
+  /* retouches du relief de la frame, transfres en une fois */
+  if(_landscape->ndirty) {
+    Uint64 t0 = SDL_GetPerformanceCounter();
+    if(terrainFlush(_landscape)) {
+      farFieldInvalidate(0);
+      fprintf(stderr, "retouche du relief : %.1f Ko transfrs, %.3f ms\n", _landscape->edited / 1024.0,
+              (SDL_GetPerformanceCounter() - t0) * 1000.0 / SDL_GetPerformanceFrequency());
+    }
   }
+  profEnd(_phases[PHASE_IDLE]);
 }
 
 /*!\brief interception et gestion des vnements "down" clavier */
@@ -196,6 +616,137 @@ static void keydown(int keycode) {
   case SDLK_DOWN:
     _keys[KDOWN] = 1;
     break;
+  case 'c':
+    /* parcourt aucun test, frustum, horizon et les deux ; l'occlusion
+     * du choix sur GPU a sa touche (j) */
+    _landscape->culling = (_landscape->culling & TERRAIN_CULL_OCCLUSION) |
+      ((_landscape->culling + 1) & (TERRAIN_CULL_FRUSTUM | TERRAIN_CULL_HORIZON));
+    break;
+  case 'j':
+    /* bascule de l'occlusion Hi-Z du choix des tuiles sur GPU */
+    _landscape->culling ^= TERRAIN_CULL_OCCLUSION;
+    fprintf(stderr, "occlusion Hi-Z : %s%s\n", _landscape->culling & TERRAIN_CULL_OCCLUSION ? "oui" : "non",
+            _gpu_cull ? "" : " (sans effet, choix des tuiles sur CPU)");
+    break;
+  case 'x':
+    /* bascule entre choix des tuiles sur CPU et sur GPU */
+    if(!_gpu_cull_supported) {
+      fprintf(stderr, "choix des tuiles sur GPU indisponible\n");
+      break;
+    }
+    _gpu_cull = !_gpu_cull;
+    _resync = 1;
+    fprintf(stderr, "choix des tuiles : %s\n", _gpu_cull ? "GPU" : "CPU");
+    break;
+  case 'm':
+    /* bascule entre clipmap et dgrad d'altitude ; le clipmap n'est
+     * pas tenu  jour quand il ne sert pas */
+    _clip = !_clip;
+    clipmapInvalidate(_clipmap);
+    farFieldInvalidate(0);
+    terrainPrograms();
+    fprintf(stderr, "couleur du terrain : %s\n", _clip ? "clipmap" : "dgrad d'altitude");
+    break;
+  case 'f':
+    /* bascule du champ lointain ; sans lui, tout le terrain est dessin
+     * en gomtrie jusqu'au plan lointain */
+    _far = !_far;
+    farFieldInvalidate(1);
+    _resync = 1;
+    fprintf(stderr, "champ lointain : %s\n", _far ? "cube captur" : "gomtrie");
+    break;
+  case 'i':
+    _report = !_report;
+    break;
+  case 'g':
+    /* terrain suivant */
+    _landscape_seed++;
+    generate();
+    break;
+  case 'h':
+    /* bascule entre gnration CPU et GPU */
+    _landscape_gpu = !_landscape_gpu;
+    generate();
+    break;
+  case 'v':
+    /* bascule entre maillages par tuile et grille partage */
+    _landscape_mode = _landscape_mode == TERRAIN_GRID ? TERRAIN_MESHES : TERRAIN_GRID;
+    _tess = 0;
+    landscape();
+    break;
+  case 't':
+    /* bascule entre tuiles et patchs de tessellation, qui lisent la
+     * texture d'altitudes de la grille partage */
+    if(!_tess && _landscape_mode != TERRAIN_GRID) {
+      _landscape_mode = TERRAIN_GRID;
+      landscape();
+    }
+    if(!_landscape->npatches) {
+      fprintf(stderr, "tessellation indisponible\n");
+      break;
+    }
+    if(!_tess_prog.id)
+      tessPrograms();
+    _tess = !_tess;
+    _resync = 1;
+    fprintf(stderr, "terrain : %s\n", _tess ? "patchs de tessellation" : "tuiles");
+    break;
+  case 'n':
+    /* backend de bruit suivant pour l'eau et la gnration GPU */
+    setNoiseBackend((noiseBackend() + 1) % NOISE_BACKENDS);
+    rebuildWater();
+    gpuGenRebuild();
+    if(_tess_prog.id)
+      tessPrograms();
+    fprintf(stderr, "bruit : %s\n", noiseBackendName(noiseBackend()));
+    break;
+  case 'b':
+    /* dure GPU de chaque backend de bruit */
+    noiseBenchmark(1024, 16);
+    break;
+  case 'e':
+    /* cratre sous le curseur */
+    brush(-_brush_amount);
+    break;
+  case 'u':
+    /* bosse sous le curseur */
+    brush(_brush_amount);
+    break;
+  case 'o':
+    _overlay = !_overlay;
+    break;
+  case 'k': {
+    /* image cl de camra pour le banc d'essai, celle du dernier tat
+     * publi */
+    const fstate_t * f = snapshotsRead(&_snapshots);
+    GLfloat key[CAMPATH_KEY];
+    if(!f)
+      break;
+    key[0] = f->cam.x; key[1] = f->cam.z; key[2] = f->cam.theta; key[3] = f->cam.pitch;
+    if(campathAppend(_camera_file, key))
+      fprintf(stderr, "image cl (%.2f, %.2f, %.2f, %.2f) ajoute  %s\n", key[0], key[1], key[2], key[3], _camera_file);
+    break;
+  }
+  case 'r':
+    /* dbut ou fin de l'enregistrement du profil */
+    if(_recording) {
+      profRecord(NULL);
+      _recording = 0;
+      fprintf(stderr, "profil enregistr dans %s\n", _profile_file);
+    } else if(!(_recording = profRecord(_profile_file)))
+      fprintf(stderr, "%s : criture impossible\n", _profile_file);
+    break;
+  case 'l':
+    /* mode suivant de la passe d'eau parmi ceux du pilote */
+    do
+      _water_mode = (_water_mode + 1) % WATERPASS_MODES;
+    while(!waterPassSupported(_water_mode));
+    fprintf(stderr, "eau : %s\n", waterPassName(_water_mode));
+    break;
+  case 'p':
+    /* bascule entre rendu direct et pr-passe de profondeur */
+    _pipeline = _pipeline == PIPELINE_PREPASS ? PIPELINE_FORWARD : PIPELINE_PREPASS;
+    break;
   case 'w':
     glGetIntegerv(GL_POLYGON_MODE, v);
     if(v[0] == GL_FILL)
@@ -229,74 +780,914 @@ static void keyup(int keycode) {
   }
 }
 
-/*!\brief dessin de la frame */
+/*!\brief dessin de la frame  partir de son tat, prpar pendant la
+ * prcdente ; la prparation de la suivante tourne dans les threads de
+ * travail pendant la soumission */
 static void draw(void) {
   /* coordonnes de la souris */
   int xm, ym;
+  /* position de la lumire (temp et lumpos) et matrices courantes */
+  GLfloat temp[4] = {100, 100, 0, 1.0}, *mat, *proj, vp[16];
+  GLuint commands = 0;
+  fstate_t * f;
+  frame_t frame;
   SDL_PumpEvents();
   SDL_GetMouseState(&xm, &ym);
-  /* position de la lumire (temp et lumpos), altitude de la camra et matrice courante */
-  GLfloat temp[4] = {100, 100, 0, 1.0}, lumpos[4], landscape_y, *mat;
-  landscape_y = heightMapAltitude(_cam.x, _cam.z);
+  /* le banc d'essai suit son chemin et pointe le centre */
+  if(_bench_frames) {
+    xm = _windowWidth >> 1;
+    ym = _windowHeight >> 1;
+  }
+  /* au dmarrage ou si l'tat prpar ne vaut plus, il est refait tout
+   * de suite sans avancer la simulation */
+  f = snapshotsRead(&_snapshots);
+  if(_resync || !f) {
+    prepare(_frame, 0.0, xm, ym);
+    jobsWait(&_frame_pending);
+    f = snapshotsRead(&_snapshots);
+    gpuCullInvalidate();
+    _resync = 0;
+  }
+  _picked = f->picked;
+  memcpy(_pick, f->pick, sizeof _pick);
+  /* fentres du clipmap centres sur la camra de la frame dessine,
+   * en chantillons de la heightMap */
+  if(_clip)
+    clipmapUpdate(_clipmap, (f->eye[0] / _hm.scale_xz + 1.0f) * 0.5f * (_hm.w - 1),
+                  (1.0f - f->eye[2] / _hm.scale_xz) * 0.5f * (_hm.h - 1));
+  /* champ lointain captur (ou suite de la capture) depuis l'oeil de
+   * la frame dessine, avant que les tches de la suivante ne reprennent
+   * le terrain */
+  if(_far) {
+    profBegin(_phases[PHASE_FAR]);
+    farFieldUpdate(f->eye, _far_threshold, _far_plane, farScene, f);
+    profEnd(_phases[PHASE_FAR]);
+  }
+  prepare(_frame + 1, _dt, xm, ym);
+  /* prcalcul de la surface de l'eau si un pas d'animation est franchi */
+  profBegin(_phases[PHASE_BAKE]);
+  updateWater(f->cycle);
+  profEnd(_phases[PHASE_BAKE]);
 
+  if(_bench_fbo)
+    glBindFramebuffer(GL_FRAMEBUFFER, _bench_fbo);
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  gl4duBindMatrix("projectionMatrix");
+  proj = gl4duGetMatrixData();
   gl4duBindMatrix("modelViewMatrix");
   gl4duLoadIdentityf();
-  gl4duLookAtf(_cam.x, landscape_y + 2.0, _cam.z, 
-	       _cam.x - sin(_cam.theta), landscape_y + 2.0 - (ym - (_windowHeight >> 1)) / (GLfloat)_windowHeight, _cam.z - cos(_cam.theta), 
-	       0.0, 1.0,0.0);
-  /* utilisation du shader de terrain */
-  glUseProgram(_landscape_pId);
+  gl4duMultMatrixf(f->view);
   mat = gl4duGetMatrixData();
-  MMAT4XVEC4(lumpos, mat, temp);
+  /* tat partag par frame : un seul envoi pour tous les programmes */
+  memcpy(frame.viewMatrix, mat, sizeof frame.viewMatrix);
+  memcpy(frame.projectionMatrix, proj, sizeof frame.projectionMatrix);
+  MMAT4XVEC4(frame.lumpos, mat, temp);
+  frame.cycle = f->cycle;
+  frame.waterBlend = waterBlend(f->cycle);
+  frameUpdate(&frame);
+  samplesRead();
+  /* champ lointain en fond, en un draw ; sa profondeur limite l'eau et
+   * laisse passer le champ proche */
+  if(_far)
+    farFieldDraw();
   gl4duScalef(_landscape_scale_xz, _landscape_scale_y, _landscape_scale_xz);
-  gl4duSendMatrices();
-  glUniform4fv(glGetUniformLocation(_landscape_pId, "lumpos"), 1, lumpos);
-  glUniform1i(glGetUniformLocation(_landscape_pId, "degrade"), 0);
-  glUniform1i(glGetUniformLocation(_landscape_pId, "eau"), 0);
-  glUniform1f(glGetUniformLocation(_landscape_pId, "cycle"), _cycle);
+  /* choix des tuiles sur GPU : commandes de dessin indirect crites par
+   * une passe de calcul, au tau courant (pas de rgulation du budget) */
+  if(_gpu_cull && !_tess) {
+    mat4Mult(vp, f->proj, f->view);
+    commands = gpuCullRun(_landscape, f->eye, (GLfloat)f->w, _landscape->tau, vp);
+  }
+  if(_pipeline == PIPELINE_PREPASS) {
+    /* profondeur seule, tuiles d'avant en arrire : les passes suivantes
+     * n'clairent que les fragments visibles (test prcoce en
+     * GL_LEQUAL, profondeurs identiques grce  invariant) */
+    profBegin(_phases[PHASE_PREPASS]);
+    useTerrainProgram(_tess ? &_tess_depth_prog : (_landscape->mode == TERRAIN_GRID ? &_grid_depth_prog : &_landscape_depth_prog), gl4duGetMatrixData(), proj);
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    passBegin(PASS_DEPTH);
+    drawLandscape(f, commands);
+    passEnd();
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glDepthMask(GL_FALSE);
+    glDepthFunc(GL_LEQUAL);
+    profEnd(_phases[PHASE_PREPASS]);
+  }
+  /* utilisation du shader de terrain */
+  profBegin(_phases[PHASE_TERRAIN]);
+  useTerrainProgram(_tess ? &_tess_prog : (_landscape->mode == TERRAIN_GRID ? &_grid_prog : &_landscape_prog), gl4duGetMatrixData(), proj);
   glBindTexture(GL_TEXTURE_1D, _terrain_tId);
-  useNoiseTextures(_landscape_pId, 1);
-  gl4dgDraw(_landscape);
+  passBegin(PASS_TERRAIN);
+  drawLandscape(f, commands);
+  passEnd();
+  /* profondeur du seul terrain (l'eau est translucide) pour le test
+   * d'occlusion de la frame suivante */
+  if(commands)
+    gpuCullDepth(_windowWidth, _windowHeight);
+  profEnd(_phases[PHASE_TERRAIN]);
+  /* eau, limite par le test de profondeur aux pixels non couverts par
+   * le relief ; claire  l'chelle de la passe d'eau puis, depuis la
+   * cible rduite, recompose  pleine rsolution */
+  profBegin(_phases[PHASE_WATER]);
+  glUseProgram(_water_prog.id);
   gl4duRotatef(-90, 1, 0, 0);
-  gl4duSendMatrices();
-  glUniform1i(glGetUniformLocation(_landscape_pId, "eau"), 1);
+  programMatrices(&_water_prog, gl4duGetMatrixData(), proj);
+  useWater(1);
+  waterPassBegin(_water_mode);
+  passBegin(PASS_WATER);
   gl4dgDraw(_plan);
-  unuseNoiseTextures(1);
+  passEnd();
+  unuseWater(1);
+  waterPassEnd(gl4duGetMatrixData(), proj, _plan);
+  profEnd(_phases[PHASE_WATER]);
+  if(_pipeline == PIPELINE_PREPASS) {
+    glDepthMask(GL_TRUE);
+    glDepthFunc(GL_LESS);
+  }
+  /* la frame suivante est prte avant les vnements et idle, qui
+   * modifient le monde */
+  profBegin(_phases[PHASE_SELECT]);
+  jobsWait(&_frame_pending);
+  profEnd(_phases[PHASE_SELECT]);
+  _frame++;
+  report(f);
+  if(_overlay) {
+    profOverlay(10, 10, _windowWidth / 3);
+    resOverlay(_windowWidth / 3 + 30, 10, _windowWidth / 3);
+  }
+  profFrameEnd();
+  if(_bench_frames)
+    benchFrame();
+}
+
+/*!\brief prparation du banc d'essai aprs init : cible hors cran de
+ * la taille de la fentre, chemin de camra, enregistrement ventuel
+ * du profil */
+static void benchInit(void) {
+  if(_gpu_cull && !_gpu_cull_supported) {
+    fprintf(stderr, "choix des tuiles sur GPU indisponible, banc d'essai sur CPU\n");
+    _gpu_cull = 0;
+  }
+  if(!_bench_occlusion)
+    _landscape->culling &= ~TERRAIN_CULL_OCCLUSION;
+  glGenTextures(2, _bench_tex);
+  glBindTexture(GL_TEXTURE_2D, _bench_tex[0]);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, _windowWidth, _windowHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+  glBindTexture(GL_TEXTURE_2D, _bench_tex[1]);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, _windowWidth, _windowHeight, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, NULL);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  resTrack(RES_TEXTURE, _bench_tex[0], RES_OTHER, 4 * (size_t)_windowWidth * _windowHeight);
+  resTrack(RES_TEXTURE, _bench_tex[1], RES_OTHER, 4 * (size_t)_windowWidth * _windowHeight);
+  glGenFramebuffers(1, &_bench_fbo);
+  glBindFramebuffer(GL_FRAMEBUFFER, _bench_fbo);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _bench_tex[0], 0);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, _bench_tex[1], 0);
+  assert(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  /* la fentre cache ne doit pas caler les frames sur l'cran */
+  SDL_GL_SetSwapInterval(0);
+  if(!_bench_path_file || !(_bench_path = campathLoad(_bench_path_file))) {
+    if(_bench_path_file)
+      fprintf(stderr, "%s : chemin illisible, cercle par dfaut\n", _bench_path_file);
+    _bench_path = campathCircle(0.5f * _landscape_scale_xz, 0.1f, 17);
+  }
+  _bench_times = malloc(_bench_frames * sizeof *_bench_times);
+  assert(_bench_times);
+  if(_bench_trace && !profRecord(_bench_trace))
+    fprintf(stderr, "%s : criture impossible\n", _bench_trace);
+}
+
+/*!\brief fin de frame du banc d'essai : attente du GPU (la dure
+ * mesure est celle de la frame complte, CPU puis GPU), relev, et
+ * bilan puis sortie aprs la dernire frame */
+static void benchFrame(void) {
+  bstats_t s;
+  GLdouble cpu, gpu;
+  int f = (int)_frame - BENCH_WARMUP;
+  Uint64 t;
+  glFinish();
+  t = SDL_GetPerformanceCounter();
+  if(f > 0)
+    _bench_times[f - 1] = (t - _bench_t0) * 1000.0 / SDL_GetPerformanceFrequency();
+  _bench_t0 = t;
+  if(f < _bench_frames)
+    return;
+  profTimes(PROF_PHASES, &cpu, &gpu);
+  benchStats(_bench_times, _bench_frames, &s);
+  printf("benchrender : %d frames %dx%d, heightMap %dx%d, graine %u, eau %s %.3f, tuiles %s, %s\n", s.n, _windowWidth,
+         _windowHeight, _landscape_w, _landscape_h, _landscape_seed, waterPassName(_water_mode), waterPassScale(), selectionName(),
+         (const char *)glGetString(GL_RENDERER));
+  printf("frame (ms) : moyenne %.3f, p50 %.3f, p99 %.3f, min %.3f, max %.3f (%.1f images/s, GPU %.3f)\n",
+         s.avg, s.p50, s.p99, s.min, s.max, 1000.0 / s.avg, gpu);
+  profPrint(stdout);
+  exit(0);
+}
+
+/*!\brief dpt de la prparation de la frame frame, simulation sur dt,
+ * dans l'emplacement libre des tats ; (xm, ym) : curseur. Les entres
+ * sont copies : les tches ne lisent rien que le thread GL modifie
+ * pendant qu'elles tournent. Aucune tche de frame ne tourne  l'appel :
+ * l'tat de dpart est le dernier publi, que le producteur n'crit
+ * pas (cf. snapshot.h) et que le thread GL ne fait que lire. */
+static void prepare(unsigned int frame, GLdouble dt, int xm, int ym) {
+  fstate_t * f = snapshotsWrite(&_snapshots);
+  f->prev = snapshotsRead(&_snapshots);
+  f->shift[0] = _cam_shift[0]; f->shift[1] = _cam_shift[1];
+  _cam_shift[0] = _cam_shift[1] = 0.0f;
+  f->frame = frame;
+  f->dt = dt;
+  memcpy(f->keys, _keys, sizeof f->keys);
+  f->xm = xm; f->ym = ym;
+  f->w = _windowWidth; f->h = _windowHeight;
+  gl4duBindMatrix("projectionMatrix");
+  memcpy(f->proj, gl4duGetMatrixData(), sizeof f->proj);
+  gl4duBindMatrix("modelViewMatrix");
+  jobsPush(frameJob, f, &_frame_pending);
+}
+
+/*!\brief fin d'une tche de frame ; la dernire runit les parties
+ * de la slection et publie l'tat */
+static void frameDone(fstate_t * f) {
+  if(!SDL_AtomicDecRef(&f->parts))
+    return;
+  if(f->nparts)
+    terrainSelectMerge(_landscape, f->sel, f->part, f->nparts, (GLfloat)f->w);
+  f->ms = (SDL_GetPerformanceCounter() - f->t0) * 1000.0 / SDL_GetPerformanceFrequency();
+  snapshotsPublish(&_snapshots);
+}
+
+/*!\brief tche : simulation de la camra (interaction clavier, tangage
+ *  la souris, ou chemin du banc d'essai) et du cycle depuis l'tat
+ * publi prcdent, vue, puis premire partie de la slection des
+ * tuiles, les autres parties et le picking tournant en parallle dans
+ * leurs propres tches. Sans appel GL ni GL4Dummies : la vue est
+ * calcule par mat4LookAt. */
+static void frameJob(void * arg) {
+  fstate_t * f = arg;
+  cam_t * cam = &f->cam;
+  GLdouble dt = f->dt, dtheta = M_PI, pas = 5.0;
+  GLfloat c[3], up[3] = {0.0f, 1.0f, 0.0f};
+  int k;
+  f->t0 = SDL_GetPerformanceCounter();
+  if(f->prev) {
+    f->cam = f->prev->cam;
+    f->cycle = f->prev->cycle;
+  } else {
+    memset(cam, 0, sizeof *cam);
+    f->cycle = 0.0f;
+  }
+  cam->x += f->shift[0];
+  cam->z += f->shift[1];
+  if(_bench_frames) {
+    /* camra sur le chemin, immobile pendant la chauffe */
+    GLfloat key[CAMPATH_KEY];
+    int n = (int)f->frame - BENCH_WARMUP;
+    campathEval(_bench_path, _bench_frames > 1 && n > 0 ? n / (GLfloat)(_bench_frames - 1) : 0.0f, key);
+    cam->x = key[0]; cam->z = key[1]; cam->theta = key[2]; cam->pitch = key[3];
+  } else {
+    cam->pitch = (f->ym - (f->h >> 1)) / (GLfloat)f->h;
+    if(f->keys[KLEFT]) {
+      cam->theta += dt * dtheta;
+    }
+    if(f->keys[KRIGHT]) {
+      cam->theta -= dt * dtheta;
+    }
+    if(f->keys[KUP]) {
+      cam->x += -dt * pas * sin(cam->theta);
+      cam->z += -dt * pas * cos(cam->theta);
+    }
+    if(f->keys[KDOWN]) {
+      cam->x += dt * pas * sin(cam->theta);
+      cam->z += dt * pas * cos(cam->theta);
+    }
+  }
+  f->cycle += dt;
+  /* oeil  l'altitude exacte de la surface dessine sous la camra */
+  f->eye[0] = cam->x;
+  f->eye[1] = heightmapAltitude(&_hm, cam->x, cam->z) + 2.0f;
+  f->eye[2] = cam->z;
+  c[0] = cam->x - sin(cam->theta);
+  c[1] = f->eye[1] - cam->pitch;
+  c[2] = cam->z - cos(cam->theta);
+  mat4LookAt(f->view, f->eye, c, up);
+  /* choix des niveaux de dtail et visibilit des tuiles, sauf s'il est
+   * fait sur GPU ou remplac par la tessellation ; avec le frustum de
+   * resize, une unit  distance 1 couvre f->w pixels. Avec le champ
+   * lointain, le plan lointain du frustum de resize est ramen  la
+   * distance o le cube prend le relais, seuil de recapture compris */
+  f->nparts = !_gpu_cull && !_tess ? _frame_parts : 0;
+  if(f->nparts) {
+    if(_far) {
+      GLfloat proj[16];
+      mat4Frustum(proj, -0.5f, 0.5f, -0.5f * f->h / f->w, 0.5f * f->h / f->w, 1.0f, _far_near + _far_threshold);
+      mat4Mult(f->vp, proj, f->view);
+    } else
+      mat4Mult(f->vp, f->proj, f->view);
+  }
+  /* picking, parties 1 et suivantes, partie 0 ici */
+  SDL_AtomicSet(&f->parts, 1 + (f->nparts ? f->nparts : 1));
+  jobsPush(pickJob, f, &_frame_pending);
+  for(k = 1; k < f->nparts; k++)
+    jobsPush(selectJob, &f->args[k], &_frame_pending);
+  if(f->nparts)
+    terrainSelectPart(_landscape, f->part[0], 0, f->nparts, f->eye, (GLfloat)f->w, f->vp);
+  frameDone(f);
+}
+
+/*!\brief tche : partie a->index de la slection des tuiles de
+ * l'tat a->f */
+static void selectJob(void * arg) {
+  fpart_t * a = arg;
+  fstate_t * f = a->f;
+  terrainSelectPart(_landscape, f->part[a->index], a->index, f->nparts, f->eye, (GLfloat)f->w, f->vp);
+  frameDone(f);
+}
+
+/*!\brief tche : picking, rayon passant par le curseur sur le plan
+ * proche du frustum de resize, ramen de la vue au monde par la
+ * transpose de la rotation de la vue */
+static void pickJob(void * arg) {
+  fstate_t * f = arg;
+  GLfloat dv[3], dir[3], t;
+  int k;
+  dv[0] = (2.0f * f->xm / f->w - 1.0f) * 0.5f;
+  dv[1] = (1.0f - 2.0f * f->ym / f->h) * 0.5f * f->h / f->w;
+  dv[2] = -1.0f;
+  for(k = 0; k < 3; k++)
+    dir[k] = f->view[k] * dv[0] + f->view[4 + k] * dv[1] + f->view[8 + k] * dv[2];
+  if((f->picked = hpyramidRaycast(_landscape->pyramid, f->eye, dir, _far_plane, &t)))
+    for(k = 0; k < 3; k++)
+      f->pick[k] = f->eye[k] + t * dir[k];
+  frameDone(f);
+}
+
+/*!\brief dessin du terrain : patchs de tessellation, tuiles choisies
+ * sur GPU si commands est non nul, ou slection de l'tat f */
+static void drawLandscape(const fstate_t * f, GLuint commands) {
+  if(_tess)
+    terrainDrawPatches(_landscape, (GLfloat)f->w, _tess_pixels);
+  else if(commands)
+    terrainDrawIndirect(_landscape, commands, (GLfloat)f->w / _landscape->tau);
+  else
+    terrainDraw(_landscape, f->sel);
+}
+
+/*!\brief affichage, une fois par seconde si _report est lev, des
+ * tuiles de terrain de l'tat f dessines et limines */
+static void report(const fstate_t * f) {
+  static double t0 = 0;
+  double t = gl4dGetElapsedTime();
+  GLdouble n;
+  const tstats_t * s = &f->sel->stats;
+  if(!_report || t - t0 < 1000.0)
+    return;
+  t0 = t;
+  if(_tess)
+    fprintf(stderr, "terrain : %d patchs de tessellation (%d x %d chantillons, %.1f pixels par segment)\n",
+            _landscape->npatches, TERRAIN_PATCH, TERRAIN_PATCH, _tess_pixels);
+  else if(_gpu_cull)
+    fprintf(stderr, "terrain : tuiles choisies sur %s parmi %d (tau = %.2f), statistiques non relues\n",
+            selectionName(), _landscape->nnodes, _landscape->tau);
+  else
+    fprintf(stderr, "terrain : %d tuiles dessines (%d triangles, tau = %.2f), %d visites, %d hors frustum, %d sous l'horizon\n",
+            s->drawn, s->triangles, f->sel->tau, s->visited, s->frustum_culled, s->horizon_culled);
+  if(f->nparts)
+    fprintf(stderr, "frame prpare en %.3f ms (simulation, slection en %d parties et picking, threads de travail)\n",
+            f->ms, f->nparts);
+  else
+    fprintf(stderr, "frame prpare en %.3f ms (simulation et picking, threads de travail)\n", f->ms);
+  if(_picked)
+    fprintf(stderr, "curseur sur le terrain en (%.2f, %.2f, %.2f)\n", _pick[0], _pick[1], _pick[2]);
+  else
+    fprintf(stderr, "curseur hors du terrain\n");
+  /* fragments par pixel de la fentre ayant pass le test de
+   * profondeur : 1 par pixel couvert sans sur-dessin */
+  n = (GLdouble)_windowWidth * _windowHeight;
+  fprintf(stderr, "sur-dessin (%s) : terrain %.2f fragments/pixel, eau %.2f, pr-passe %.2f\n",
+          _pipeline == PIPELINE_PREPASS ? "pr-passe de profondeur" : "direct",
+          _samples[PASS_TERRAIN] / n, _samples[PASS_WATER] / n, _samples[PASS_DEPTH] / n);
+  fprintf(stderr, "eau : %s, chelle %.3f\n", waterPassName(_water_mode), waterPassScale());
+  if(_world) {
+    int tiles, hits, misses;
+    tilefileCacheStats(_world, &tiles, &hits, &misses);
+    fprintf(stderr, "cache de tuiles : %d tuiles, %d dcodages vits sur %d\n", tiles, hits, hits + misses);
+  }
+  resPrint(stderr);
+  if(_clip)
+    fprintf(stderr, "clipmap : %d niveaux de %d x %d texels (%.1f Mo), %d texels produits depuis le dernier relev\n",
+            CLIPMAP_LEVELS, _clip_size, _clip_size, 8.0 * CLIPMAP_LEVELS * _clip_size * _clip_size / (1024.0 * 1024.0),
+            _clipmap->uploaded);
+  _clipmap->uploaded = 0;
+  if(_far)
+    fprintf(stderr, "champ lointain : au-del de %.0f (seuil %.1f, plan lointain %.0f), cube de %d x %d texels, %d captures\n",
+            _far_near, _far_threshold, _far_plane, _far_size, _far_size, farFieldCaptures());
+  profPrint(stderr);
+}
+
+/*!\brief choix des tuiles courant et, sur GPU, occlusion Hi-Z, pour
+ * les relevs et le banc d'essai */
+static const char * selectionName(void) {
+  if(_tess)
+    return "aucun (patchs de tessellation)";
+  if(!_gpu_cull)
+    return "CPU";
+  return _landscape->culling & TERRAIN_CULL_OCCLUSION ? "GPU avec occlusion Hi-Z" : "GPU sans occlusion";
+}
+
+/*!\brief programme de terrain p actif avec ses matrices ; les
+ * emplacements de ses uniformes sont ceux qu'utilisera terrainDraw */
+static void useTerrainProgram(const program_t * p, const GLfloat * modelView, const GLfloat * proj) {
+  glUseProgram(p->id);
+  programMatrices(p, modelView, proj);
+  _landscape->skirtLoc = p->skirt;
+  _landscape->morphLoc = p->morph;
+  _landscape->gridLoc = p->grid;
+  _landscape->tessLoc = p->tess;
+  _landscape->boundsLoc = p->bounds;
+}
+
+/*!\brief (re)construction des programmes des patchs de tessellation
+ * avec le backend de bruit courant (dtail fBm de patch.tes) */
+static void tessPrograms(void) {
+  programInit(&_tess_prog, noiseTessProgram(_clip ? "TERRAIN " CLIPMAP_DEFINES : "TERRAIN", "<vs>shaders/patch.vs",
+                                            "<tcs>shaders/patch.tcs", "<tes>shaders/patch.tes", "<fs>shaders/basic.fs"));
+  programSampler(&_tess_prog, "degrade", 0);
+  programSampler(&_tess_prog, "heights", TERRAIN_HEIGHT_UNIT);
+  programSampler(&_tess_prog, "clipAlbedo", CLIPMAP_ALBEDO_UNIT);
+  programSampler(&_tess_prog, "clipNormal", CLIPMAP_NORMAL_UNIT);
+  programInit(&_tess_depth_prog, noiseTessProgram("DEPTH_ONLY", "<vs>shaders/patch.vs", "<tcs>shaders/patch.tcs",
+                                                  "<tes>shaders/patch.tes", "<fs>shaders/basic.fs"));
+  programSampler(&_tess_depth_prog, "heights", TERRAIN_HEIGHT_UNIT);
+  glUseProgram(0);
+}
+
+/*!\brief (re)construction des programmes clairs du terrain en
+ * maillages et en grille partage (et en patchs s'ils existent), et de
+ * leurs variantes de capture du champ lointain, avec ou sans clipmap
+ * selon _clip */
+static void terrainPrograms(void) {
+  const char * defines = _clip ? "TERRAIN " CLIPMAP_DEFINES : "TERRAIN";
+  const char * far = _clip ? "TERRAIN " CLIPMAP_DEFINES " " FARFIELD_DEFINES : "TERRAIN " FARFIELD_DEFINES;
+  programInit(&_landscape_prog, variantProgram(defines, "<vs>shaders/mesh.vs", "<fs>shaders/basic.fs", NULL));
+  /* units de texture fixes : dgrad en 0, cartes de l'eau en 1 et 2 */
+  programSampler(&_landscape_prog, "degrade", 0);
+  programSampler(&_landscape_prog, "nodes", TERRAIN_NODES_UNIT);
+  programSampler(&_landscape_prog, "clipAlbedo", CLIPMAP_ALBEDO_UNIT);
+  programSampler(&_landscape_prog, "clipNormal", CLIPMAP_NORMAL_UNIT);
+  programInit(&_grid_prog, variantProgram(defines, "<vs>shaders/terrain.vs", "<fs>shaders/basic.fs", NULL));
+  programSampler(&_grid_prog, "degrade", 0);
+  programSampler(&_grid_prog, "heights", TERRAIN_HEIGHT_UNIT);
+  programSampler(&_grid_prog, "normals", TERRAIN_NORMAL_UNIT);
+  programSampler(&_grid_prog, "clipAlbedo", CLIPMAP_ALBEDO_UNIT);
+  programSampler(&_grid_prog, "clipNormal", CLIPMAP_NORMAL_UNIT);
+  programInit(&_landscape_far_prog, variantProgram(far, "<vs>shaders/mesh.vs", "<fs>shaders/basic.fs", NULL));
+  programSampler(&_landscape_far_prog, "degrade", 0);
+  programSampler(&_landscape_far_prog, "nodes", TERRAIN_NODES_UNIT);
+  programSampler(&_landscape_far_prog, "clipAlbedo", CLIPMAP_ALBEDO_UNIT);
+  programSampler(&_landscape_far_prog, "clipNormal", CLIPMAP_NORMAL_UNIT);
+  programInit(&_grid_far_prog, variantProgram(far, "<vs>shaders/terrain.vs", "<fs>shaders/basic.fs", NULL));
+  programSampler(&_grid_far_prog, "degrade", 0);
+  programSampler(&_grid_far_prog, "heights", TERRAIN_HEIGHT_UNIT);
+  programSampler(&_grid_far_prog, "normals", TERRAIN_NORMAL_UNIT);
+  programSampler(&_grid_far_prog, "clipAlbedo", CLIPMAP_ALBEDO_UNIT);
+  programSampler(&_grid_far_prog, "clipNormal", CLIPMAP_NORMAL_UNIT);
+  if(_tess_prog.id)
+    tessPrograms();
+  glUseProgram(0);
+}
+
+/*!\brief capture d'une face du champ lointain (cf. farscene_t) :
+ * tat par frame de la face, tuiles choisies sans rgulation du budget
+ * (le tau de la vue principale reste le sien) et programme de capture,
+ * qui carte le champ proche */
+static void farScene(void * arg, const GLfloat eye[3], const GLfloat * view, const GLfloat * proj, GLfloat kscreen) {
+  const fstate_t * f = arg;
+  const program_t * p = _landscape->mode == TERRAIN_GRID ? &_grid_far_prog : &_landscape_far_prog;
+  GLfloat temp[4] = {100, 100, 0, 1.0}, scale[16] = {0}, mv[16], vp[16];
+  int budget = _landscape->budget;
+  frame_t frame;
+  memcpy(frame.viewMatrix, view, sizeof frame.viewMatrix);
+  memcpy(frame.projectionMatrix, proj, sizeof frame.projectionMatrix);
+  MMAT4XVEC4(frame.lumpos, view, temp);
+  frame.cycle = f->cycle;
+  frame.waterBlend = waterBlend(f->cycle);
+  frameUpdate(&frame);
+  mat4Mult(vp, proj, view);
+  _landscape->budget = 0;
+  terrainSelect(_landscape, _far_sel, eye, kscreen, vp);
+  _landscape->budget = budget;
+  scale[0] = scale[10] = _landscape_scale_xz;
+  scale[5] = _landscape_scale_y;
+  scale[15] = 1.0f;
+  mat4Mult(mv, view, scale);
+  useTerrainProgram(p, mv, proj);
+  glUniform1f(p->farNear, _far_near);
+  glBindTexture(GL_TEXTURE_1D, _terrain_tId);
+  terrainDraw(_landscape, _far_sel);
+}
+
+/*!\brief altitude de _hm au point (x, z) en chantillons (colonne,
+ * ligne), interpole et borne  la carte */
+static GLfloat sampleHeight(GLfloat x, GLfloat z) {
+  int i, j, w = _hm.w;
+  const GLfloat * d = _hm.data;
+  x = x < 0.0f ? 0.0f : (x > w - 1 ? w - 1 : x);
+  z = z < 0.0f ? 0.0f : (z > _hm.h - 1 ? _hm.h - 1 : z);
+  j = (int)x < w - 2 ? (int)x : w - 2;
+  i = (int)z < _hm.h - 2 ? (int)z : _hm.h - 2;
+  x -= j;
+  z -= i;
+  d += i * w + j;
+  return (d[0] * (1.0f - x) + d[1] * x) * (1.0f - z) + (d[w] * (1.0f - x) + d[w + 1] * x) * z;
+}
+
+/*!\brief production des texels du clipmap (cf. clipfill_t), au centre
+ * de chaque texel : normale (modle) par diffrences centres au pas du
+ * niveau, couleur du dgrad d'altitude, roche sur les pentes fortes
+ * du monde, et grain par texel d'amplitude dcroissante avec le
+ * niveau */
+static void clipFill(void * arg, int level, int x0, int z0, int w, int h, GLubyte * albedo, GLubyte * normal) {
+  static const GLfloat rock[3] = {115.0f, 107.0f, 97.0f};
+  GLfloat step = (1 << level) / (GLfloat)_clip_scale, x, z, a, dx, dz, l, r, g, c;
+  int i, j, k, p;
+  unsigned int u;
+  (void)arg;
+  for(i = 0; i < h; i++) {
+    z = (z0 + i + 0.5f) * step;
+    for(j = 0; j < w; j++, albedo += 4, normal += 4) {
+      x = (x0 + j + 0.5f) * step;
+      a = sampleHeight(x, z);
+      /* pentes dy/dx et dy/dz en coordonnes modle, cf. terrain.vs */
+      dx =  (sampleHeight(x + step, z) - sampleHeight(x - step, z)) * (_hm.w - 1) / (2.0f * step);
+      dz = -(sampleHeight(x, z + step) - sampleHeight(x, z - step)) * (_hm.h - 1) / (2.0f * step);
+      l = 1.0f / sqrtf(dx * dx + 1.0f + dz * dz);
+      normal[0] = (GLubyte)(127.5f * (1.0f - dx * l));
+      normal[1] = (GLubyte)(127.5f * (1.0f + l));
+      normal[2] = (GLubyte)(127.5f * (1.0f - dz * l));
+      normal[3] = 255;
+      /* roche au-del d'une pente (monde) de 0.6 */
+      r = (sqrtf(dx * dx + dz * dz) * _hm.scale_y / _hm.scale_xz - 0.6f) / 0.4f;
+      r = r < 0.0f ? 0.0f : (r > 1.0f ? 1.0f : r);
+      /* grain : hachage des indices du niveau 0, +/- 8 % au niveau 0 */
+      u = ((unsigned int)(x0 + j) << level) * 73856093u ^ ((unsigned int)(z0 + i) << level) * 19349663u;
+      u = (u ^ (u >> 13)) * 0x5bd1e995u;
+      g = 1.0f + 0.08f / (1 << level) * ((u >> 8 & 0xffff) / 32767.5f - 1.0f);
+      p = (int)(a * _palette_n);
+      p = p < _palette_n - 1 ? p : _palette_n - 1;
+      for(k = 0; k < 3; k++) {
+        c = ((1.0f - r) * _palette[3 * p + k] + r * rock[k]) * g;
+        albedo[k] = (GLubyte)(c < 255.0f ? c : 255.0f);
+      }
+      albedo[3] = 255;
+    }
+  }
+}
+
+/*!\brief dbut du comptage des fragments de la passe pass, si les
+ * statistiques sont affiches */
+static void passBegin(int pass) {
+  if(!_report)
+    return;
+  glBeginQuery(GL_SAMPLES_PASSED, _samples_queries[_frame & 1][pass]);
+  _samples_issued[_frame & 1][pass] = 1;
+}
+
+static void passEnd(void) {
+  if(_report)
+    glEndQuery(GL_SAMPLES_PASSED);
+}
+
+/*!\brief relve les comptages de la frame prcdente dj disponibles ;
+ * une passe non mise compte 0 */
+static void samplesRead(void) {
+  int p, f = (_frame + 1) & 1;
+  GLuint available;
+  for(p = 0; p < PASSES; p++) {
+    if(!_samples_issued[f][p]) {
+      _samples[p] = 0;
+      continue;
+    }
+    glGetQueryObjectuiv(_samples_queries[f][p], GL_QUERY_RESULT_AVAILABLE, &available);
+    if(available) {
+      glGetQueryObjectuiv(_samples_queries[f][p], GL_QUERY_RESULT, &_samples[p]);
+      _samples_issued[f][p] = 0;
+    }
+  }
+}
+
+/*!\brief dformation du relief de amount (monde) sous le curseur ;
+ * seules les rgions touches du terrain seront mises  jour. Sans
+ * effet pendant un dplacement de la fentre du monde (elle serait
+ * perdue  la bascule) ; une retouche du monde prcalcul ne vit que
+ * tant que sa rgion reste dans la fentre. */
+static void brush(GLfloat amount) {
+  int r[4];
+  if(!_picked || _stream_state != STREAM_IDLE)
+    return;
+  if(heightmapBrush(&_hm, _pick[0], _pick[2], _brush_radius, amount, r)) {
+    terrainDirty(_landscape, r[0], r[1], r[2], r[3]);
+    if(_clip)
+      clipmapDirty(_clipmap, r[0], r[1], r[2], r[3]);
+  }
+}
+
+/*!\brief gnration, sur GPU ou CPU selon _landscape_gpu, de la
+ * heightMap de graine _landscape_seed puis mise  jour du terrain ; la
+ * dure de chaque tape est affiche. Sur GPU, la relecture des
+ * altitudes est asynchrone (idle puis generated) ds qu'un terrain
+ * existe, le dessin continuant entre-temps avec l'ancien relief. */
+static void generate(void) {
+  int wait = !_landscape || !_heightMap;
+  GLdouble f = 1000.0 / SDL_GetPerformanceFrequency();
+  Uint64 t0 = SDL_GetPerformanceCounter(), t1;
+  /* un terrain gnr remplace le monde prcalcul */
+  if(_world) {
+    streamCancel();
+    tilefileClose(_world);
+    _world = NULL;
+    resUntrack(RES_HEAP, (uintptr_t)_back.data);
+    free(_back.data);
+    _back.data = NULL;
+  }
+  if(_landscape_gpu) {
+    if(!_heightMap) {
+      _heightMap = malloc(_landscape_w * _landscape_h * sizeof *_heightMap);
+      assert(_heightMap);
+      resTrack(RES_HEAP, (uintptr_t)_heightMap, RES_HEIGHT, _landscape_w * _landscape_h * sizeof *_heightMap);
+    }
+    _hm.data = _heightMap;
+    gpuGen(_landscape_seed, 0.5f);
+    gpuGenReadBegin();
+    _gen_t0 = SDL_GetPerformanceCounter();
+    if(!wait) {
+      _gen_pending = 1;
+      return;
+    }
+    gpuGenReadEnd(&_hm, 1);
+    _gen_pending = 0;
+    generated();
+    return;
+  } else {
+    _gen_pending = 0;
+    if(_heightMap) {
+      resUntrack(RES_HEAP, (uintptr_t)_heightMap);
+      free(_heightMap);
+    }
+    _heightMap = heightGen(_landscape_w, _landscape_h, 0.5f, _landscape_seed, 0);
+    resTrack(RES_HEAP, (uintptr_t)_heightMap, RES_HEIGHT, _landscape_w * _landscape_h * sizeof *_heightMap);
+    t1 = SDL_GetPerformanceCounter();
+    fprintf(stderr, "heightMap CPU (graine %u) : %.2f ms\n", _landscape_seed, (t1 - t0) * f);
+  }
+  _hm.data = _heightMap;
+  landscape();
+}
+
+/*!\brief fin d'une gnration sur GPU, altitudes relues dans _hm :
+ * en mode TERRAIN_GRID, le terrain existant reprend de GPU  GPU les
+ * textures d'altitudes et de normales produites ; sinon ses maillages
+ * sont reconstruits sur le CPU (landscape) */
+static void generated(void) {
+  GLdouble gh, gn, f = 1000.0 / SDL_GetPerformanceFrequency();
+  Uint64 t0 = SDL_GetPerformanceCounter(), t1;
+  gpuGenTimes(&gh, &gn);
+  fprintf(stderr, "heightMap GPU (graine %u) : %.2f ms, normales %.2f ms, relecture aprs %.2f ms\n",
+          _landscape_seed, gh, gn, (t0 - _gen_t0) * f);
+  if(!_landscape || _landscape->mode != _landscape_mode || _landscape_mode != TERRAIN_GRID) {
+    landscape();
+    return;
+  }
+  streamCancel();
+  terrainRefreshTextures(_landscape, gpuGenHeightTexture(), gpuGenNormalTexture());
+  farFieldInvalidate(1);
+  clipmapInvalidate(_clipmap);
+  _resync = 1;
+  t1 = SDL_GetPerformanceCounter();
+  fprintf(stderr, "tuiles de terrain (copie GPU) : %.2f ms\n", (t1 - t0) * f);
+}
+
+/*!\brief construction des tuiles de terrain dans le mode
+ * _landscape_mode, ou simple mise  jour si le terrain existe dj
+ * dans ce mode ; la dure et la mmoire des sommets sont affiches */
+static void landscape(void) {
+  int k, p, culling = _landscape ? _landscape->culling : -1;
+  GLdouble f = 1000.0 / SDL_GetPerformanceFrequency();
+  Uint64 t0 = SDL_GetPerformanceCounter(), t1;
+  streamCancel();
+  if(_landscape && _landscape->mode == _landscape_mode) {
+    terrainRefresh(_landscape);
+  } else {
+    if(_landscape)
+      terrainDelete(_landscape);
+    _landscape = terrainNew(&_hm, _landscape_tile, _landscape_mode);
+    _landscape->budget = _landscape_budget;
+    if(culling >= 0)
+      _landscape->culling = culling;
+    _frame_parts = jobsCount() < FRAME_PARTS ? jobsCount() : FRAME_PARTS;
+    for(k = 0; k < 3; k++) {
+      terrainSelectionDelete(_fstates[k].sel);
+      _fstates[k].sel = terrainSelectionNew(_landscape);
+      for(p = 0; p < FRAME_PARTS; p++) {
+        terrainSelectionDelete(_fstates[k].part[p]);
+        _fstates[k].part[p] = p < _frame_parts ? terrainSelectionNew(_landscape) : NULL;
+        _fstates[k].args[p].f = &_fstates[k];
+        _fstates[k].args[p].index = p;
+      }
+    }
+    terrainSelectionDelete(_far_sel);
+    _far_sel = terrainSelectionNew(_landscape);
+  }
+  farFieldInvalidate(1);
+  /* nouvelles altitudes : clipmap refait en entier */
+  clipmapInvalidate(_clipmap);
+  _resync = 1;
+  t1 = SDL_GetPerformanceCounter();
+  fprintf(stderr, "tuiles de terrain (%s) : %.2f ms, %.2f Mo de sommets, ACMR %.3f (%.3f ligne par ligne)\n",
+          _landscape_mode == TERRAIN_GRID ? "grille partage" : "maillages", (t1 - t0) * f,
+          _landscape->vbytes / (1024.0 * 1024.0), _landscape->acmr, _landscape->acmrRows);
+}
+
+/*!\brief ouverture du monde prcalcul _landscape_file et chargement
+ * de la fentre centrale dans _heightMap ; retourne 0 si le fichier est
+ * inutilisable */
+static int openWorld(void) {
+  int k;
+  GLdouble f = 1000.0 / SDL_GetPerformanceFrequency();
+  Uint64 t0 = SDL_GetPerformanceCounter(), t1;
+  if(!(_world = tilefileOpen(_landscape_file)))
+    return 0;
+  if(_world->w < _landscape_w || _world->h < _landscape_h) {
+    fprintf(stderr, "%s : monde plus petit que la fentre (%d x %d)\n", _landscape_file, _landscape_w, _landscape_h);
+    tilefileClose(_world);
+    _world = NULL;
+    return 0;
+  }
+  _heightMap = malloc(_landscape_w * _landscape_h * sizeof *_heightMap);
+  _back = _hm;
+  _back.data = malloc(_landscape_w * _landscape_h * sizeof *_back.data);
+  assert(_heightMap && _back.data);
+  resTrack(RES_HEAP, (uintptr_t)_heightMap, RES_HEIGHT, _landscape_w * _landscape_h * sizeof *_heightMap);
+  resTrack(RES_HEAP, (uintptr_t)_back.data, RES_HEIGHT, _landscape_w * _landscape_h * sizeof *_back.data);
+  _hm.data = _heightMap;
+  tilefilePlan(_world, &_hm, _world->w / 2, _world->h / 2, &_move);
+  for(k = 0; k < _move.ntiles; k++)
+    tilefileLoad(_world, &_move, k, _world->scratch, &_hm);
+  tilefileCommit(_world, &_move, &_hm);
+  t1 = SDL_GetPerformanceCounter();
+  fprintf(stderr, "monde %s : %d x %d chantillons, fentre charge en %.2f ms\n",
+          _landscape_file, _world->w, _world->h, (t1 - t0) * f);
+  landscape();
+  return 1;
+}
+
+/*!\brief tche : copie de la partie conserve de la fentre courante
+ * dans _back */
+static void keepJob(void * arg) {
+  (void)arg;
+  tilefileKeep(_world, &_move, _hm.data, &_back);
+}
+
+/*!\brief tche : dcodage dans _back de la tuile (intptr_t)arg du
+ * dplacement */
+static void loadJob(void * arg) {
+  unsigned short * scratch = malloc(_world->tile * _world->tile * sizeof *scratch);
+  assert(scratch);
+  tilefileLoad(_world, &_move, (int)(intptr_t)arg, scratch, &_back);
+  free(scratch);
+}
+
+/*!\brief tche : prparation du terrain sur _back */
+static void prepareJob(void * arg) {
+  (void)arg;
+  terrainPrepare(_landscape, _back.data);
+}
+
+/*!\brief dplacement de la fentre de _world avec la camra, sans
+ * bloquer le rendu : quand la camra s'loigne du centre, les tuiles
+ * entrantes sont dcodes dans _back puis le terrain prpar par le
+ * pool de threads, et transfr au GPU  raison de _upload_budget
+ * octets par frame. Une fois le transfert termin, _back devient la
+ * fentre courante et la camra est dcale d'autant pour rester au
+ * mme point du monde. */
+static void stream(void) {
+  const fstate_t * e;
+  int k, x, z;
+  GLfloat * d;
+  GLdouble f = 1000.0 / SDL_GetPerformanceFrequency();
+  if(!_world)
+    return;
+  switch(_stream_state) {
+  case STREAM_IDLE:
+    /* fentre centre sur la camra du dernier tat publi */
+    if(!(e = snapshotsRead(&_snapshots)))
+      return;
+    x = _world->ox + (int)((e->cam.x / _hm.scale_xz + 1.0f) * 0.5f * (_hm.w - 1));
+    z = _world->oz + (int)((1.0f - e->cam.z / _hm.scale_xz) * 0.5f * (_hm.h - 1));
+    if(!tilefilePlan(_world, &_hm, x, z, &_move))
+      return;
+    _stream_t0 = SDL_GetPerformanceCounter();
+    jobsPush(keepJob, NULL, &_pending);
+    for(k = 0; k < _move.ntiles; k++)
+      jobsPush(loadJob, (void *)(intptr_t)k, &_pending);
+    _stream_state = STREAM_LOAD;
+    return;
+  case STREAM_LOAD:
+    if(SDL_AtomicGet(&_pending))
+      return;
+    jobsPush(prepareJob, NULL, &_pending);
+    _stream_state = STREAM_PREPARE;
+    return;
+  case STREAM_PREPARE:
+    if(SDL_AtomicGet(&_pending))
+      return;
+    _stream_state = STREAM_UPLOAD;
+    /* pas de break : premier transfert dans la mme frame */
+  case STREAM_UPLOAD:
+    if(!terrainUpload(_landscape, _upload_budget))
+      return;
+    /* dcalage transmis  la prparation de resynchronisation */
+    _cam_shift[0] -= (_move.ox - _world->ox) * 2.0f * _hm.scale_xz / (_hm.w - 1);
+    _cam_shift[1] += (_move.oz - _world->oz) * 2.0f * _hm.scale_xz / (_hm.h - 1);
+    d = _hm.data;
+    _hm.data = _heightMap = _back.data;
+    _back.data = d;
+    tilefileCommit(_world, &_move, &_hm);
+    clipmapInvalidate(_clipmap);
+    farFieldInvalidate(1);
+    _resync = 1;
+    fprintf(stderr, "monde : fentre en (%d, %d), %d tuiles dcodes, %.2f ms\n",
+            _world->ox, _world->oz, _move.ntiles, (SDL_GetPerformanceCounter() - _stream_t0) * f);
+    _stream_state = STREAM_IDLE;
+    return;
+  }
+}
+
+/*!\brief abandon du dplacement en cours (les tches dj dposes
+ * sont attendues) avant toute reconstruction du terrain */
+static void streamCancel(void) {
+  jobsWait(&_pending);
+  _stream_state = STREAM_IDLE;
 }
 
 /*!\brief libration des ressources utilises */
 static void quit(void) {
+  int k, p;
+  streamCancel();
+  jobsWait(&_frame_pending);
+  for(k = 0; k < 3; k++) {
+    terrainSelectionDelete(_fstates[k].sel);
+    _fstates[k].sel = NULL;
+    for(p = 0; p < FRAME_PARTS; p++) {
+      terrainSelectionDelete(_fstates[k].part[p]);
+      _fstates[k].part[p] = NULL;
+    }
+  }
+  terrainSelectionDelete(_far_sel);
+  _far_sel = NULL;
+  farFieldFree();
+  frameFree();
+  gpuCullFree();
+  clipmapDelete(_clipmap);
+  _clipmap = NULL;
+  free(_palette);
+  _palette = NULL;
+  glDeleteQueries(2 * PASSES, &_samples_queries[0][0]);
+  profFree();
+  if(_bench_fbo) {
+    glDeleteFramebuffers(1, &_bench_fbo);
+    resDeleteTextures(2, _bench_tex);
+    _bench_fbo = 0;
+  }
+  if(_bench_path) {
+    campathFree(_bench_path);
+    _bench_path = NULL;
+  }
+  free(_bench_times);
+  _bench_times = NULL;
+  gpuGenFree();
+  waterPassFree();
+  freeWater();
   freeNoiseTextures();
+  variantFree();
+  if(_landscape) {
+    terrainDelete(_landscape);
+    _landscape = NULL;
+  }
+  if(_world) {
+    tilefileClose(_world);
+    _world = NULL;
+    resUntrack(RES_HEAP, (uintptr_t)_back.data);
+    free(_back.data);
+    _back.data = NULL;
+  }
+  jobsFree();
   if(_heightMap) {
+    resUntrack(RES_HEAP, (uintptr_t)_heightMap);
     free(_heightMap);
     _heightMap = NULL;
   }
   if(_terrain_tId) {
-    glDeleteTextures(1, &_terrain_tId);
+    resDeleteTextures(1, &_terrain_tId);
     _terrain_tId = 0;
   }
+  resFree();
   gl4duClean(GL4DU_ALL);
 }
-
-/*!\brief rcupration de l'altitude y de la camra selon son
- *  positionnement dans la heightMap. Cette fonction utilise les
- *  paramtres de scale pour faire la conversion d'un monde 
- *  l'autre. 
- *
- * Pour les tudiants souhaitant raliser un projet type randonne, il
- * faudra tendre cette fonction afin de rcuprer la position y
- * exacte quand x et z ne tombent pas exactement sur un sommet mais se
- * trouvent entre 3 sommets. Indice, un triangle possde une normale,
- * la normale (a, b, c) donnent les coefficients de l'quation du plan
- * confondu avec le triangle par : ax + by + cz + d = 0. Reste plus
- * qu' trouver d puis  chercher y pour x et z donns.
- */
-static GLfloat heightMapAltitude(GLfloat x, GLfloat z) {
-  x = (_landscape_w >> 1) + (x / _landscape_scale_xz) * (_landscape_w / 2.0); 
-  z = (_landscape_h >> 1) - (z / _landscape_scale_xz) * (_landscape_h / 2.0);
-  if(x >= 0.0 && x < _landscape_w && z >= 0.0 && z < _landscape_h)
-    return (2.0 * _heightMap[((int)x) + ((int)z) * _landscape_w] - 1) * _landscape_scale_y;
-  return 0;
-}
-